@@ -0,0 +1,187 @@
+// wavesim-batch: runs a parameter-study spec headless across all cores.
+//
+// Members of the spec (see src/Ensemble.h for the format) that share a scene are packed
+// into ensemble-lanes groups; each group (or lone member) is one task on a work-stealing
+// scheduler and runs single-threaded to its stop condition. Members write any requested
+// fields as .npy and end up as one row of <out>/summary.csv. With --checkpoint, running
+// members snapshot themselves periodically and rerunning the same command resumes them.
+
+#include "Ensemble.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage() {
+    std::cout << "Usage: wavesim-batch <spec> [options]\n"
+              << "  --out <dir>          Output directory (default batch-out)\n"
+              << "  --threads <n>        Worker threads (default hardware concurrency)\n"
+              << "  --kernel <name>      Stencil kernel for unpacked members: scalar or simd (default simd)\n"
+              << "  --lanes <mode>       Pack members sharing a scene into SIMD lanes: auto (time both\n"
+              << "                       on each scene), on or off (default auto)\n"
+              << "  --checkpoint <s>     Snapshot running members every <s> wall seconds into\n"
+              << "                       <out>/checkpoints; rerun to resume an interrupted study\n"
+              << "  --compress           Deflate checkpoint snapshots\n"
+              << "  --dry-run            List the expanded members without running them\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string specPath;
+    std::string outputDir = "batch-out";
+    int threads = 0;
+    KernelVariant variant = KernelVariant::SIMD;
+    bool dryRun = false;
+    std::string lanesMode = "auto";
+    EnsembleCheckpoints checkpoints;
+    double checkpointInterval = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--out") outputDir = next();
+        else if (arg == "--threads") threads = std::atoi(next().c_str());
+        else if (arg == "--kernel") {
+            const std::string name = next();
+            variant = KernelVariant::COUNT;
+            for (int v = 0; v < static_cast<int>(KernelVariant::COUNT); v++) {
+                if (name == kernelVariantName(static_cast<KernelVariant>(v))) variant = static_cast<KernelVariant>(v);
+            }
+            if (variant == KernelVariant::COUNT) {
+                std::cerr << "Unknown kernel " << name << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--dry-run") dryRun = true;
+        else if (arg == "--checkpoint") checkpointInterval = std::atof(next().c_str());
+        else if (arg == "--compress") checkpoints.compress = true;
+        else if (arg == "--lanes") {
+            lanesMode = next();
+            if (lanesMode != "auto" && lanesMode != "on" && lanesMode != "off") {
+                std::cerr << "Unknown lanes mode " << lanesMode << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (specPath.empty() && arg[0] != '-') specPath = arg;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (specPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<EnsembleMember> members;
+    std::string error;
+    if (!readEnsembleSpec(specPath, members, error)) {
+        std::cerr << specPath << ": " << error << std::endl;
+        return 1;
+    }
+
+    // Presets log to std::cout as they load; keep the progress output readable
+    std::ostringstream sink;
+    std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+
+    // Lanes only pay off while the interleaved ensemble stays in cache; measure each scene
+    auto useLanes = [&](const EnsembleMember& leader) {
+        return lanesMode == "auto" ? ensembleLanesPayOff(leader) : lanesMode == "on";
+    };
+    const std::vector<std::vector<size_t>> groups = groupEnsembleLanes(members, useLanes);
+    std::cout.rdbuf(old);
+
+    if (dryRun) {
+        for (const auto& m : members) {
+            std::cout << m.name << " (";
+            if (m.from.empty()) std::cout << m.preset << ", " << m.gridSize << "^2";
+            else std::cout << "from " << m.from;
+            std::cout << ", " << m.duration << " s";
+            if (m.frames > 0.0f) std::cout << ", " << colormapName(m.image.map) << " " << m.imageFormat << " every " << m.frames << " s";
+            std::cout << ")" << std::endl;
+        }
+        std::cout << members.size() << " members in " << groups.size() << " tasks" << std::endl;
+        return 0;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(outputDir, ec);
+    if (ec) {
+        std::cerr << "Cannot create " << outputDir << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    if (checkpointInterval > 0.0) {
+        checkpoints.directory = outputDir + "/checkpoints";
+        checkpoints.interval = checkpointInterval;
+        std::filesystem::create_directories(checkpoints.directory, ec);
+        if (ec) {
+            std::cerr << "Cannot create " << checkpoints.directory << ": " << ec.message() << std::endl;
+            return 1;
+        }
+    }
+
+    TaskScheduler scheduler(threads);
+    std::printf("Running %zu members (%zu tasks) on %d threads\n", members.size(), groups.size(), scheduler.size());
+    std::fflush(stdout);
+
+    std::cout.rdbuf(sink.rdbuf());
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<EnsembleResult> results(members.size());
+    std::atomic<int> completed{ 0 };
+    std::mutex printMutex;
+    std::vector<std::function<void(int)>> tasks;
+    for (const auto& group : groups) {
+        tasks.push_back([&, group](int) {
+            std::vector<EnsembleResult> groupResults;
+            if (group.size() == 1) {
+                groupResults.push_back(runEnsembleMember(members[group[0]], outputDir, variant, checkpoints));
+            } else {
+                std::vector<const EnsembleMember*> lanes;
+                for (size_t i : group) lanes.push_back(&members[i]);
+                groupResults = runEnsembleLanes(lanes, outputDir, variant);
+            }
+
+            std::lock_guard<std::mutex> lock(printMutex);
+            for (size_t k = 0; k < group.size(); k++) {
+                const EnsembleResult& r = results[group[k]] = groupResults[k];
+                const int done = ++completed;
+                const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::printf("[%d/%zu] %-48s %-8s %6.2f s  (eta %.0f s)\n", done, members.size(), r.name.c_str(),
+                            r.status.c_str(), r.seconds, elapsed / done * (members.size() - done));
+                if (!r.error.empty()) std::printf("    %s\n", r.error.c_str());
+            }
+            std::fflush(stdout);
+        });
+    }
+    scheduler.run(tasks);
+    std::cout.rdbuf(old);
+
+    const std::string summary = outputDir + "/summary.csv";
+    if (!writeEnsembleSummary(summary, members, results)) {
+        std::cerr << "Failed to write " << summary << std::endl;
+        return 1;
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int failures = 0;
+    for (const auto& r : results) {
+        if (r.status == "error" || r.status == "diverged") failures++;
+    }
+    std::cout << members.size() << " members in " << elapsed << " s, summary written to " << summary;
+    if (failures) std::cout << " (" << failures << " diverged or failed)";
+    std::cout << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+#include "Golden.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+GoldenRecord captureGolden(const std::string& preset, const GoldenRun& run, const SolverOptions& options,
+                           FieldLayout layout) {
+    Simulation sim(run.gridSize, layout);
+
+    // Presets log their name; keep the check output to one line per run
+    std::ostringstream sink;
+    std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+    loadPreset(sim, preset);
+    std::cout.rdbuf(old);
+
+    stepSimulation(sim, run.dt, run.steps, options);
+
+    GoldenRecord r;
+    r.preset = preset;
+
+    uint64_t hash = 1469598103934665603ull;
+    double sumSq = 0.0;
+    for (int y = 0; y < sim.size; y++) {
+        for (int x = 0; x < sim.size; x++) {
+            const float v = sim.u[sim.index(x, y)];
+            uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            for (int i = 0; i < 4; i++) {
+                hash ^= (bits >> (8 * i)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+            sumSq += double(v) * v;
+            r.linf = std::max(r.linf, double(std::fabs(v)));
+        }
+    }
+    r.hash = hash;
+    r.l2 = std::sqrt(sumSq);
+
+    r.width = run.gridSize / run.block;
+    r.field.assign(r.width * r.width, 0.0f);
+    for (int by = 0; by < r.width; by++) {
+        for (int bx = 0; bx < r.width; bx++) {
+            double sum = 0.0;
+            for (int y = by * run.block; y < (by + 1) * run.block; y++) {
+                for (int x = bx * run.block; x < (bx + 1) * run.block; x++) {
+                    sum += sim.u[sim.index(x, y)];
+                }
+            }
+            r.field[by * r.width + bx] = static_cast<float>(sum / (run.block * run.block));
+        }
+    }
+    return r;
+}
+
+bool writeGoldenCorpus(const std::string& path, const GoldenRun& run, const std::vector<GoldenRecord>& records) {
+    std::ofstream f(path);
+    if (!f) return false;
+
+    f << "# wavesim golden corpus v1\n";
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.17g", run.dt);
+    f << "run " << run.gridSize << " " << buf << " " << run.steps << " " << run.block << "\n";
+    for (const auto& r : records) {
+        f << "preset " << r.preset << "\n";
+        std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)r.hash);
+        f << "hash " << buf << "\n";
+        std::snprintf(buf, sizeof(buf), "%.17g %.17g", r.l2, r.linf);
+        f << "norms " << buf << "\n";
+        f << "field " << r.width << "\n";
+        for (int y = 0; y < r.width; y++) {
+            for (int x = 0; x < r.width; x++) {
+                std::snprintf(buf, sizeof(buf), "%.17g", r.field[y * r.width + x]);
+                f << (x ? " " : "") << buf;
+            }
+            f << "\n";
+        }
+    }
+    return static_cast<bool>(f);
+}
+
+bool readGoldenCorpus(const std::string& path, GoldenRun& run, std::vector<GoldenRecord>& records) {
+    std::ifstream f(path);
+    if (!f) return false;
+
+    records.clear();
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream is(line);
+        std::string key;
+        is >> key;
+        if (key == "run") {
+            is >> run.gridSize >> run.dt >> run.steps >> run.block;
+        } else if (key == "preset") {
+            GoldenRecord r;
+            r.preset = line.substr(7);
+            records.push_back(r);
+        } else if (records.empty()) {
+            return false;
+        } else if (key == "hash") {
+            std::string hex;
+            is >> hex;
+            records.back().hash = std::strtoull(hex.c_str(), nullptr, 16);
+        } else if (key == "norms") {
+            is >> records.back().l2 >> records.back().linf;
+        } else if (key == "field") {
+            GoldenRecord& r = records.back();
+            is >> r.width;
+            r.field.resize(r.width * r.width);
+            for (auto& v : r.field) {
+                if (!(f >> v)) return false;
+            }
+        }
+    }
+    return !records.empty();
+}
+
+bool compareGolden(const GoldenRecord& expected, const GoldenRecord& actual, const GoldenTolerance& tolerance,
+                   std::string& report, bool& bitExact) {
+    bitExact = expected.hash == actual.hash;
+
+    // Everything is compared relative to the reference peak amplitude
+    const double scale = std::max(expected.linf, 1e-12);
+    double worstField = 0.0;
+    int worstIndex = -1;
+    if (expected.width == actual.width) {
+        for (size_t i = 0; i < expected.field.size(); i++) {
+            double d = std::fabs(double(expected.field[i]) - actual.field[i]) / scale;
+            if (d > worstField) {
+                worstField = d;
+                worstIndex = static_cast<int>(i);
+            }
+        }
+    } else {
+        worstField = 1e30;
+    }
+    const double l2Error = std::fabs(expected.l2 - actual.l2) / std::max(expected.l2, 1e-12);
+    const double linfError = std::fabs(expected.linf - actual.linf) / scale;
+
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "L2 %.2e, Linf %.2e, field %.2e", l2Error, linfError, worstField);
+    report = buf;
+    if (worstIndex >= 0 && worstField > tolerance.relative) {
+        std::snprintf(buf, sizeof(buf), " at block (%d, %d)", worstIndex % expected.width, worstIndex / expected.width);
+        report += buf;
+    }
+    return l2Error <= tolerance.relative && linfError <= tolerance.relative && worstField <= tolerance.relative;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Solver.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Golden-field regression corpus: every preset stepped deterministically with the
+// scalar reference solver, reduced to a field hash, norms and a downsampled field.
+
+struct GoldenRun {
+    int gridSize = 256;         // presets scale with the grid; small keeps the check fast
+    float dt = 1.0f / 60.0f;    // the solver's largest substep
+    int steps = 1800;           // 30 s: long enough for reflections off every wall
+    int block = 16;             // downsampling block edge in cells
+};
+
+struct GoldenRecord {
+    std::string preset;
+    uint64_t hash = 0;          // FNV-1a of the raw float bits of u
+    double l2 = 0.0;
+    double linf = 0.0;
+    int width = 0;              // downsampled field is width x width block means
+    std::vector<float> field;
+};
+
+struct GoldenTolerance {
+    double relative;            // relative to the reference L-infinity norm
+};
+
+// Every kernel computes and stores in fp32; this allows for FMA contraction and
+// reassociation on other compilers and targets
+const GoldenTolerance GOLDEN_TOLERANCE = { 1e-4 };
+
+GoldenRecord captureGolden(const std::string& preset, const GoldenRun& run, const SolverOptions& options,
+                           FieldLayout layout = FieldLayout::ROW_MAJOR);
+
+bool writeGoldenCorpus(const std::string& path, const GoldenRun& run, const std::vector<GoldenRecord>& records);
+bool readGoldenCorpus(const std::string& path, GoldenRun& run, std::vector<GoldenRecord>& records);
+
+// Returns true when `actual` matches `expected` within tolerance. `report` describes
+// the largest deviation either way; `bitExact` tells whether the hashes agree.
+bool compareGolden(const GoldenRecord& expected, const GoldenRecord& actual, const GoldenTolerance& tolerance,
+                   std::string& report, bool& bitExact);
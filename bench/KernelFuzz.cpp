@@ -0,0 +1,291 @@
+#include "KernelFuzz.h"
+
+#include "Golden.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+
+namespace {
+
+// Pools are reused across cases; spawning threads per case would dominate the run time.
+ThreadPool* poolFor(int threads) {
+    static std::map<int, std::unique_ptr<ThreadPool>> pools;
+    if (threads <= 1) return nullptr;
+    auto& pool = pools[threads];
+    if (!pool) pool.reset(new ThreadPool(threads));
+    return pool.get();
+}
+
+Simulation buildSimulation(const FuzzCase& c, FieldLayout layout) {
+    Simulation sim(c.size, layout);
+    sim.waveSpeed = c.waveSpeed;
+    sim.damping = c.damping;
+    sim.wallReflectivity = c.reflectivity;
+    for (int y = 0; y < c.size; y++) {
+        for (int x = 0; x < c.size; x++) {
+            sim.walls[sim.index(x, y)] = c.walls[y * c.size + x];
+        }
+    }
+    for (const auto& s : c.sources) {
+        addSource(sim, s.x, s.y, s.frequency, s.amplitude);
+    }
+    if (c.fieldSeed) {
+        std::mt19937_64 rng(c.fieldSeed);
+        std::uniform_real_distribution<float> amp(-1.0f, 1.0f);
+        for (int y = 0; y < c.size; y++) {
+            for (int x = 0; x < c.size; x++) {
+                sim.u[sim.index(x, y)] = amp(rng);
+                sim.u_prev[sim.index(x, y)] = amp(rng);
+            }
+        }
+    }
+    return sim;
+}
+
+bool sameValue(float expected, float actual, double tolerance) {
+    if (std::isnan(expected) || std::isnan(actual)) return std::isnan(expected) && std::isnan(actual);
+    return std::fabs(double(expected) - actual) <= tolerance;
+}
+
+} // namespace
+
+std::vector<FuzzConfig> fuzzConfigs() {
+    std::vector<FuzzConfig> configs;
+    for (int v = 0; v < static_cast<int>(KernelVariant::COUNT); v++) {
+        for (int threads : { 1, 3 }) {
+            for (int tile : { 0, 7 }) {
+                FuzzConfig c;
+                c.variant = static_cast<KernelVariant>(v);
+                c.threads = threads;
+                c.tileWidth = tile;
+                c.name = std::string(kernelVariantName(c.variant)) + "/threads=" + std::to_string(threads);
+                if (tile) c.name += "/tile=" + std::to_string(tile);
+                configs.push_back(c);
+            }
+        }
+        FuzzConfig tiled;
+        tiled.variant = static_cast<KernelVariant>(v);
+        tiled.threads = 3;
+        tiled.layout = FieldLayout::TILED;
+        tiled.name = std::string(kernelVariantName(tiled.variant)) + "/threads=3/layout=tiled";
+        configs.push_back(tiled);
+    }
+    return configs;
+}
+
+FuzzCase randomFuzzCase(uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    auto uniform = [&](double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng); };
+    auto integer = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+    FuzzCase c;
+    // Mostly small grids, biased towards awkward widths around SIMD multiples
+    const int pick = integer(0, 9);
+    if (pick < 5) c.size = integer(3, 40);
+    else if (pick < 8) c.size = 16 * integer(1, 8) + integer(-1, 1);
+    else c.size = integer(41, 300);
+    c.size = std::max(3, c.size);
+
+    c.steps = integer(1, 24);
+    c.dt = static_cast<float>(uniform(0.001, 1.0 / 60.0));
+    c.waveSpeed = static_cast<float>(uniform(0.5, 40.0));
+    c.damping = integer(0, 3) == 0 ? 1.0f : static_cast<float>(uniform(0.98, 1.0));
+    const int refl = integer(0, 3);
+    c.reflectivity = refl == 0 ? 1.0f : refl == 1 ? 0.0f : static_cast<float>(uniform(0.0, 1.0));
+    c.fieldSeed = integer(0, 1) ? rng() | 1 : 0;
+
+    c.walls.assign(c.size * c.size, 0);
+    const double density = integer(0, 2) == 0 ? 0.0 : uniform(0.0, 0.5);
+    for (auto& w : c.walls) {
+        w = uniform(0.0, 1.0) < density ? 1 : 0;
+    }
+    // Solid rectangles exercise runs of walls, including ones touching the border
+    for (int r = integer(0, 3); r > 0; r--) {
+        int x0 = integer(0, c.size - 1), y0 = integer(0, c.size - 1);
+        int x1 = std::min(c.size, x0 + integer(1, c.size)), y1 = std::min(c.size, y0 + integer(1, c.size));
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) c.walls[y * c.size + x] = 1;
+        }
+    }
+
+    for (int s = integer(0, 6); s > 0; s--) {
+        FuzzSource src;
+        src.x = static_cast<float>(uniform(0.0, c.size));
+        src.y = static_cast<float>(uniform(0.0, c.size));
+        src.frequency = static_cast<float>(uniform(0.5, 10.0));
+        src.amplitude = static_cast<float>(uniform(0.1, 5.0));
+        c.sources.push_back(src);
+    }
+    return c;
+}
+
+FuzzCase fuzzCaseFromBytes(const uint8_t* data, size_t size) {
+    // The first eight bytes seed the generator; the rest overrides the wall mask.
+    uint64_t seed = 0;
+    std::memcpy(&seed, data, std::min(size, sizeof(seed)));
+    FuzzCase c = randomFuzzCase(seed);
+    for (size_t i = sizeof(seed); i < size; i++) {
+        size_t cell = (i - sizeof(seed)) * 8;
+        for (int bit = 0; bit < 8 && cell + bit < c.walls.size(); bit++) {
+            c.walls[cell + bit] = (data[i] >> bit) & 1;
+        }
+    }
+    return c;
+}
+
+FuzzDivergence runFuzzCase(const FuzzCase& c, const FuzzConfig& config) {
+    Simulation reference = buildSimulation(c, FieldLayout::ROW_MAJOR);
+    Simulation candidate = buildSimulation(c, config.layout);
+
+    SolverOptions refOptions;
+    refOptions.variant = KernelVariant::SCALAR;
+    SolverOptions options;
+    options.variant = config.variant;
+    options.pool = poolFor(config.threads);
+    options.tileWidth = config.tileWidth;
+    const double relative = GOLDEN_TOLERANCE.relative;
+
+    FuzzDivergence d;
+    d.config = config.name;
+    for (int step = 1; step <= c.steps; step++) {
+        stepSimulation(reference, c.dt, 1, refOptions);
+        stepSimulation(candidate, c.dt, 1, options);
+
+        float peak = 0.0f;
+        for (float v : reference.u) peak = std::max(peak, std::fabs(v));
+        const double tolerance = relative * std::max(1.0f, peak);
+
+        for (int y = 0; y < c.size; y++) {
+            for (int x = 0; x < c.size; x++) {
+                const float expected = reference.u[reference.index(x, y)];
+                const float actual = candidate.u[candidate.index(x, y)];
+                if (!sameValue(expected, actual, tolerance)) {
+                    d.found = true;
+                    d.step = step;
+                    d.x = x;
+                    d.y = y;
+                    d.expected = expected;
+                    d.actual = actual;
+                    return d;
+                }
+            }
+        }
+    }
+    return d;
+}
+
+FuzzCase minimizeFuzzCase(const FuzzCase& original, const FuzzConfig& config) {
+    FuzzCase c = original;
+    FuzzDivergence d = runFuzzCase(c, config);
+    if (!d.found) return c;
+    c.steps = d.step;
+
+    auto stillDiverges = [&](const FuzzCase& trial) { return runFuzzCase(trial, config).found; };
+
+    // Drop sources one at a time
+    for (size_t i = 0; i < c.sources.size();) {
+        FuzzCase trial = c;
+        trial.sources.erase(trial.sources.begin() + i);
+        if (stillDiverges(trial)) c = trial;
+        else i++;
+    }
+
+    // Clear wall cells in shrinking chunks
+    for (size_t chunk = c.walls.size(); chunk >= 1; chunk /= 2) {
+        for (size_t start = 0; start < c.walls.size(); start += chunk) {
+            FuzzCase trial = c;
+            bool changed = false;
+            for (size_t i = start; i < std::min(start + chunk, trial.walls.size()); i++) {
+                changed |= trial.walls[i] != 0;
+                trial.walls[i] = 0;
+            }
+            if (changed && stillDiverges(trial)) c = trial;
+        }
+        if (chunk == 1) break;
+    }
+
+    // Simplify physics
+    FuzzCase trial = c;
+    trial.damping = 1.0f;
+    if (stillDiverges(trial)) c = trial;
+    trial = c;
+    trial.reflectivity = 1.0f;
+    if (stillDiverges(trial)) c = trial;
+    trial = c;
+    trial.fieldSeed = 0;
+    if (stillDiverges(trial)) c = trial;
+
+    d = runFuzzCase(c, config);
+    if (d.found) c.steps = d.step;
+    return c;
+}
+
+bool writeFuzzCase(const std::string& path, const FuzzCase& c) {
+    std::ofstream f(path);
+    if (!f) return false;
+    char buf[128];
+    f << "# wavesim kernel fuzz case\n";
+    f << "size " << c.size << "\n";
+    f << "steps " << c.steps << "\n";
+    std::snprintf(buf, sizeof(buf), "%.9g %.9g %.9g %.9g", c.dt, c.waveSpeed, c.damping, c.reflectivity);
+    f << "physics " << buf << "\n";
+    f << "field " << c.fieldSeed << "\n";
+    for (const auto& s : c.sources) {
+        std::snprintf(buf, sizeof(buf), "%.9g %.9g %.9g %.9g", s.x, s.y, s.frequency, s.amplitude);
+        f << "source " << buf << "\n";
+    }
+    f << "walls\n";
+    for (int y = 0; y < c.size; y++) {
+        for (int x = 0; x < c.size; x++) {
+            f << (c.walls[y * c.size + x] ? '#' : '.');
+        }
+        f << "\n";
+    }
+    return static_cast<bool>(f);
+}
+
+bool readFuzzCase(const std::string& path, FuzzCase& c) {
+    std::ifstream f(path);
+    if (!f) return false;
+    c = FuzzCase();
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream is(line);
+        std::string key;
+        is >> key;
+        if (key == "size") is >> c.size;
+        else if (key == "steps") is >> c.steps;
+        else if (key == "physics") is >> c.dt >> c.waveSpeed >> c.damping >> c.reflectivity;
+        else if (key == "field") is >> c.fieldSeed;
+        else if (key == "source") {
+            FuzzSource s;
+            is >> s.x >> s.y >> s.frequency >> s.amplitude;
+            c.sources.push_back(s);
+        } else if (key == "walls") {
+            c.walls.assign(c.size * c.size, 0);
+            for (int y = 0; y < c.size && std::getline(f, line); y++) {
+                for (int x = 0; x < c.size && x < static_cast<int>(line.size()); x++) {
+                    c.walls[y * c.size + x] = line[x] == '#' ? 1 : 0;
+                }
+            }
+        }
+    }
+    return c.size >= 3 && static_cast<int>(c.walls.size()) == c.size * c.size;
+}
+
+std::string describeDivergence(const FuzzDivergence& d) {
+    if (!d.found) return d.config + ": no divergence";
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%s: step %d, cell (%d, %d): expected %.9g, got %.9g",
+                  d.config.c_str(), d.step, d.x, d.y, d.expected, d.actual);
+    return buf;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Solver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Differential fuzzing of stencil variants against the scalar reference.
+// A case is fully explicit (mask and sources included) so it can be minimized
+// and written out as a reproducer.
+
+struct FuzzSource {
+    float x, y, frequency, amplitude;
+};
+
+struct FuzzCase {
+    int size = 16;
+    int steps = 8;
+    float dt = 1.0f / 60.0f;
+    float waveSpeed = 6.0f;
+    float damping = 0.9995f;
+    float reflectivity = 1.0f;
+    uint64_t fieldSeed = 0;         // nonzero: random initial u and u_prev
+    std::vector<uint8_t> walls;     // size * size
+    std::vector<FuzzSource> sources;
+};
+
+struct FuzzConfig {
+    std::string name;               // e.g. "simd/threads=3"
+    KernelVariant variant = KernelVariant::SCALAR;
+    int threads = 1;
+    int tileWidth = 0;
+    FieldLayout layout = FieldLayout::ROW_MAJOR;
+};
+
+struct FuzzDivergence {
+    bool found = false;
+    std::string config;
+    int step = 0;
+    int x = 0;
+    int y = 0;
+    float expected = 0.0f;
+    float actual = 0.0f;
+};
+
+// Every optimized configuration worth comparing: all variants, one and several threads,
+// whole rows and narrow column strips, row-major and tiled storage.
+std::vector<FuzzConfig> fuzzConfigs();
+
+// Random case from a seed (odd and non-multiple-of-SIMD sizes included).
+FuzzCase randomFuzzCase(uint64_t seed);
+// Case decoded from arbitrary bytes, for libFuzzer.
+FuzzCase fuzzCaseFromBytes(const uint8_t* data, size_t size);
+
+// Steps the reference and `config` side by side; reports the first divergent cell.
+FuzzDivergence runFuzzCase(const FuzzCase& c, const FuzzConfig& config);
+
+// Greedily shrinks a diverging case (steps, sources, walls, physics) while it still diverges.
+FuzzCase minimizeFuzzCase(const FuzzCase& c, const FuzzConfig& config);
+
+bool writeFuzzCase(const std::string& path, const FuzzCase& c);
+bool readFuzzCase(const std::string& path, FuzzCase& c);
+std::string describeDivergence(const FuzzDivergence& d);
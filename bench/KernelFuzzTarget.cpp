@@ -0,0 +1,21 @@
+// libFuzzer entry point for the differential kernel fuzzer. Build with
+// -DWAVESIM_BUILD_FUZZER=ON using clang; any divergence aborts with the case details.
+
+#include "KernelFuzz.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 8) return 0;
+    const FuzzCase c = fuzzCaseFromBytes(data, size);
+    for (const auto& config : fuzzConfigs()) {
+        FuzzDivergence d = runFuzzCase(c, config);
+        if (d.found) {
+            std::fprintf(stderr, "%s\n", describeDivergence(d).c_str());
+            writeFuzzCase("wavesim-fuzz-case.txt", minimizeFuzzCase(c, config));
+            std::abort();
+        }
+    }
+    return 0;
+}
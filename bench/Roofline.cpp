@@ -0,0 +1,226 @@
+#include "Roofline.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Large enough to defeat every cache level on current hardware (64 MB per array).
+const int STREAM_ELEMENTS = 16 * 1024 * 1024;
+const int FMA_LANES = 32;
+const int FMA_ITERATIONS = 1 << 20;
+
+volatile float g_sink = 0.0f;
+
+// Best-of timing: repeats fn until minTime has elapsed and returns the fastest run.
+template <typename Fn>
+double bestSeconds(double minTime, Fn fn) {
+    double best = 1e30;
+    double total = 0.0;
+    int runs = 0;
+    while (total < minTime || runs < 3) {
+        auto start = Clock::now();
+        fn();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = std::min(best, seconds);
+        total += seconds;
+        runs++;
+    }
+    return best;
+}
+
+float fmaChains(float m, float a) {
+    float acc[FMA_LANES];
+    for (int j = 0; j < FMA_LANES; j++) acc[j] = static_cast<float>(j) * 1e-3f;
+    for (int i = 0; i < FMA_ITERATIONS; i++) {
+        for (int j = 0; j < FMA_LANES; j++) {
+            acc[j] = acc[j] * m + a;
+        }
+    }
+    float sum = 0.0f;
+    for (int j = 0; j < FMA_LANES; j++) sum += acc[j];
+    return sum;
+}
+
+double logPos(double value, double lo, double hi, double pixels) {
+    return (std::log10(value) - std::log10(lo)) / (std::log10(hi) - std::log10(lo)) * pixels;
+}
+
+} // namespace
+
+MachineCeilings measureCeilings(ThreadPool& pool, double minTime) {
+    MachineCeilings c;
+    c.threads = pool.size();
+
+    std::unique_ptr<float[]> a(new float[STREAM_ELEMENTS]);
+    std::unique_ptr<float[]> b(new float[STREAM_ELEMENTS]);
+    std::unique_ptr<float[]> s(new float[STREAM_ELEMENTS]);
+    float* pa = a.get();
+    float* pb = b.get();
+    float* ps = s.get();
+
+    // First touch with the same band split the probes use
+    pool.parallelFor(0, STREAM_ELEMENTS, [&](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            pa[i] = 0.0f;
+            pb[i] = 1.0f;
+            ps[i] = 2.0f;
+        }
+    });
+
+    const double bytes = double(STREAM_ELEMENTS) * sizeof(float);
+    double copy = bestSeconds(minTime, [&] {
+        pool.parallelFor(0, STREAM_ELEMENTS, [&](int i0, int i1) {
+            std::copy(pb + i0, pb + i1, pa + i0);
+        });
+    });
+    c.copyGBs = 2.0 * bytes / copy * 1e-9;
+
+    const float scalar = 3.0f;
+    double triad = bestSeconds(minTime, [&] {
+        pool.parallelFor(0, STREAM_ELEMENTS, [&](int i0, int i1) {
+            for (int i = i0; i < i1; i++) {
+                pa[i] = pb[i] + scalar * ps[i];
+            }
+        });
+    });
+    c.triadGBs = 3.0 * bytes / triad * 1e-9;
+
+    // Multipliers come from a volatile so the chains cannot be folded away
+    volatile float mv = 0.999999f;
+    volatile float av = 1e-7f;
+    const float m = mv;
+    const float add = av;
+    std::vector<float> results(pool.size());
+    double fma = bestSeconds(minTime, [&] {
+        pool.parallelFor(0, pool.size(), [&](int t0, int t1) {
+            for (int t = t0; t < t1; t++) {
+                results[t] = fmaChains(m, add);
+            }
+        });
+        for (float r : results) g_sink = g_sink + r;
+    });
+    c.peakGflops = 2.0 * FMA_LANES * double(FMA_ITERATIONS) * pool.size() / fma * 1e-9;
+    return c;
+}
+
+void placeOnRoofline(RooflinePoint& point, const MachineCeilings& ceilings) {
+    point.attainable = std::min(ceilings.peakGflops, point.intensity * ceilings.triadGBs);
+}
+
+void printRooflineTable(const std::vector<MachineCeilings>& ceilings, const std::vector<RooflinePoint>& points) {
+    char line[256];
+    std::cout << "\nMachine ceilings" << std::endl;
+    std::snprintf(line, sizeof(line), "%8s %12s %12s %12s %12s", "threads", "copy GB/s", "triad GB/s", "peak GFLOP/s", "ridge F/B");
+    std::cout << line << std::endl;
+    for (const auto& c : ceilings) {
+        std::snprintf(line, sizeof(line), "%8d %12.2f %12.2f %12.2f %12.2f",
+                      c.threads, c.copyGBs, c.triadGBs, c.peakGflops, c.peakGflops / c.triadGBs);
+        std::cout << line << std::endl;
+    }
+
+    std::cout << "\nRoofline" << std::endl;
+    std::snprintf(line, sizeof(line), "%-24s %8s %10s %12s %12s %9s  %s",
+                  "kernel", "threads", "F/B", "GFLOP/s", "attainable", "of roof", "bound");
+    std::cout << line << std::endl;
+    for (const auto& p : points) {
+        const MachineCeilings* c = nullptr;
+        for (const auto& m : ceilings) {
+            if (m.threads == p.threads) c = &m;
+        }
+        std::snprintf(line, sizeof(line), "%-24s %8d %10.3f %12.2f %12.2f %8.1f%%  %s",
+                      p.name.c_str(), p.threads, p.intensity, p.gflops, p.attainable, 100.0 * p.fraction(),
+                      c ? (p.memoryBound(*c) ? "memory" : "compute") : "?");
+        std::cout << line << std::endl;
+    }
+}
+
+bool writeRooflineCsv(const std::string& path, const std::vector<MachineCeilings>& ceilings,
+                      const std::vector<RooflinePoint>& points) {
+    std::ofstream f(path);
+    if (!f) return false;
+    f << "kind,name,threads,intensity_flop_per_byte,gflops,attainable_gflops,fraction,copy_gbs,triad_gbs,peak_gflops\n";
+    for (const auto& c : ceilings) {
+        f << "ceiling,machine," << c.threads << ",,,,," << c.copyGBs << "," << c.triadGBs << "," << c.peakGflops << "\n";
+    }
+    for (const auto& p : points) {
+        f << "kernel," << p.name << "," << p.threads << "," << p.intensity << "," << p.gflops << ","
+          << p.attainable << "," << p.fraction() << ",,,\n";
+    }
+    return static_cast<bool>(f);
+}
+
+bool writeRooflineSvg(const std::string& path, const std::vector<MachineCeilings>& ceilings,
+                      const std::vector<RooflinePoint>& points) {
+    std::ofstream f(path);
+    if (!f) return false;
+
+    const double W = 720, H = 480, left = 70, bottom = 50, right = 20, top = 20;
+    const double plotW = W - left - right, plotH = H - top - bottom;
+    const double xLo = 0.01, xHi = 100.0;
+    double yHi = 1.0, yLo = 1e9;
+    for (const auto& c : ceilings) yHi = std::max(yHi, c.peakGflops * 2.0);
+    for (const auto& c : ceilings) yLo = std::min(yLo, c.triadGBs * xLo);
+    for (const auto& p : points) yLo = std::min(yLo, p.gflops / 2.0);
+    yLo = std::pow(10.0, std::floor(std::log10(std::max(yLo, 1e-3))));
+    yHi = std::pow(10.0, std::ceil(std::log10(yHi)));
+
+    auto px = [&](double x) { return left + logPos(x, xLo, xHi, plotW); };
+    auto py = [&](double y) { return top + plotH - logPos(y, yLo, yHi, plotH); };
+    const char* colors[] = { "#1f77b4", "#d62728", "#2ca02c", "#9467bd", "#ff7f0e", "#8c564b" };
+
+    f << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << W << "\" height=\"" << H
+      << "\" font-family=\"sans-serif\" font-size=\"11\">\n";
+    f << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+    f << "<rect x=\"" << left << "\" y=\"" << top << "\" width=\"" << plotW << "\" height=\"" << plotH
+      << "\" fill=\"none\" stroke=\"#444\"/>\n";
+
+    // Decade grid and labels
+    for (double x = xLo; x <= xHi * 1.001; x *= 10.0) {
+        f << "<line x1=\"" << px(x) << "\" y1=\"" << top << "\" x2=\"" << px(x) << "\" y2=\"" << top + plotH
+          << "\" stroke=\"#ddd\"/>\n";
+        f << "<text x=\"" << px(x) << "\" y=\"" << top + plotH + 15 << "\" text-anchor=\"middle\">" << x << "</text>\n";
+    }
+    for (double y = yLo; y <= yHi * 1.001; y *= 10.0) {
+        f << "<line x1=\"" << left << "\" y1=\"" << py(y) << "\" x2=\"" << left + plotW << "\" y2=\"" << py(y)
+          << "\" stroke=\"#ddd\"/>\n";
+        f << "<text x=\"" << left - 5 << "\" y=\"" << py(y) + 4 << "\" text-anchor=\"end\">" << y << "</text>\n";
+    }
+    f << "<text x=\"" << left + plotW / 2 << "\" y=\"" << H - 10 << "\" text-anchor=\"middle\">Arithmetic intensity (FLOP/byte)</text>\n";
+    f << "<text x=\"15\" y=\"" << top + plotH / 2 << "\" text-anchor=\"middle\" transform=\"rotate(-90 15 "
+      << top + plotH / 2 << ")\">GFLOP/s</text>\n";
+
+    // Ceilings: bandwidth slope up to the ridge point, then the compute roof
+    for (size_t i = 0; i < ceilings.size(); i++) {
+        const MachineCeilings& c = ceilings[i];
+        const double ridge = c.peakGflops / c.triadGBs;
+        const char* color = colors[i % 6];
+        f << "<polyline fill=\"none\" stroke=\"" << color << "\" stroke-width=\"2\" points=\""
+          << px(xLo) << "," << py(c.triadGBs * xLo) << " " << px(ridge) << "," << py(c.peakGflops) << " "
+          << px(xHi) << "," << py(c.peakGflops) << "\"/>\n";
+        f << "<text x=\"" << px(xHi) - 5 << "\" y=\"" << py(c.peakGflops) - 5 << "\" text-anchor=\"end\" fill=\""
+          << color << "\">" << c.threads << " thread(s): " << c.triadGBs << " GB/s, " << c.peakGflops << " GFLOP/s</text>\n";
+    }
+
+    // Kernels, coloured like the ceiling of their thread count
+    for (const auto& p : points) {
+        const char* color = "#000";
+        for (size_t i = 0; i < ceilings.size(); i++) {
+            if (ceilings[i].threads == p.threads) color = colors[i % 6];
+        }
+        f << "<circle cx=\"" << px(p.intensity) << "\" cy=\"" << py(p.gflops) << "\" r=\"4\" fill=\"" << color << "\"/>\n";
+        f << "<text x=\"" << px(p.intensity) + 6 << "\" y=\"" << py(p.gflops) + 4 << "\">" << p.name << " ("
+          << static_cast<int>(100.0 * p.fraction() + 0.5) << "%)</text>\n";
+    }
+    f << "</svg>\n";
+    return static_cast<bool>(f);
+}
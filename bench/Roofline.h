@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Machine ceilings measured by the built-in probes.
+struct MachineCeilings {
+    int threads = 1;
+    double copyGBs = 0.0;        // STREAM copy,  a[i] = b[i]
+    double triadGBs = 0.0;       // STREAM triad, a[i] = b[i] + s * c[i]
+    double peakGflops = 0.0;     // independent multiply-add chains
+};
+
+// One solver configuration placed on the roofline.
+struct RooflinePoint {
+    std::string name;
+    int threads = 1;
+    double intensity = 0.0;      // FLOP per byte of modelled (or measured) traffic
+    double gflops = 0.0;         // attained
+    double attainable = 0.0;     // min(peak, intensity * bandwidth)
+    double fraction() const { return attainable > 0.0 ? gflops / attainable : 0.0; }
+    bool memoryBound(const MachineCeilings& c) const { return intensity * c.triadGBs < c.peakGflops; }
+};
+
+// Runs the bandwidth and FMA probes on `pool` (all of its threads).
+MachineCeilings measureCeilings(ThreadPool& pool, double minTime);
+
+// Fills in attainable performance for a point against the given ceilings.
+void placeOnRoofline(RooflinePoint& point, const MachineCeilings& ceilings);
+
+void printRooflineTable(const std::vector<MachineCeilings>& ceilings, const std::vector<RooflinePoint>& points);
+bool writeRooflineCsv(const std::string& path, const std::vector<MachineCeilings>& ceilings,
+                      const std::vector<RooflinePoint>& points);
+bool writeRooflineSvg(const std::string& path, const std::vector<MachineCeilings>& ceilings,
+                      const std::vector<RooflinePoint>& points);
@@ -0,0 +1,767 @@
+// wavesim-bench: microbenchmarks for the solver and editing hot paths.
+//
+// Every benchmark reports ns/op (mean and standard deviation over samples), cells/s and
+// an effective bandwidth derived from a per-op traffic model. Results are printed as a
+// table and written to a JSON file so runs can be compared across builds.
+
+#include "AutoTune.h"
+#include "Brush.h"
+#include "EnsembleLanes.h"
+#include "Golden.h"
+#include "KernelFuzz.h"
+#include "PerfCounters.h"
+#include "Roofline.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BenchOptions {
+    std::vector<int> sizes = { 256, 512, 1024, 2048, 4096, 8192 };
+    std::vector<int> threads;                     // empty = 1, 2, 4, ... hardware
+    std::vector<float> wallDensities = { 0.0f, 0.05f, 0.25f };
+    std::vector<int> sourceCounts = { 1, 10, 100, 1000, 10000 };
+    double minTime = 0.25;                        // seconds of samples per benchmark
+    std::string filter;
+    std::string jsonPath = "wavesim-bench.json";
+    bool listOnly = false;
+    std::string rooflinePrefix;                   // non-empty = roofline mode
+    std::string goldenRecord;                     // non-empty = write golden corpus
+    std::string goldenCheck;                      // non-empty = verify against golden corpus
+    double fuzzSeconds = 0.0;                     // > 0 = differential kernel fuzzing
+    uint64_t fuzzSeed = 0;                        // 0 = seed from the clock
+    std::string fuzzOutput = "wavesim-fuzz-case.txt";
+    std::string fuzzReplay;                       // non-empty = replay a reproducer
+    bool tune = false;                            // auto-tune sweep over --sizes
+    int rooflineSize = 2048;
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+    int samples = 0;
+    double nsMean = 0.0;
+    double nsStddev = 0.0;
+    double cellsPerOp = 0.0;
+    double bytesPerOp = 0.0;
+    KernelStats counters;
+    bool hasCounters = false;
+
+    double cellsPerSecond() const { return nsMean > 0.0 ? cellsPerOp / (nsMean * 1e-9) : 0.0; }
+    double gbPerSecond() const { return nsMean > 0.0 ? bytesPerOp / nsMean : 0.0; }
+};
+
+using Params = std::vector<std::pair<std::string, std::string>>;
+using Clock = std::chrono::steady_clock;
+
+BenchOptions g_options;
+std::vector<BenchResult> g_results;
+KernelProfiler g_profiler;
+
+std::string fullName(const std::string& name, const Params& params) {
+    std::string s = name;
+    for (const auto& p : params) {
+        s += "/" + p.first + "=" + p.second;
+    }
+    return s;
+}
+
+template <typename T>
+std::string str(T value) {
+    std::ostringstream os;
+    os << value;
+    return os.str();
+}
+
+bool selected(const std::string& id) {
+    return g_options.filter.empty() || id.find(g_options.filter) != std::string::npos;
+}
+
+// Runs op() repeatedly and records timing statistics. Ops that are shorter than
+// ~1 ms are batched so clock overhead stays negligible.
+void runBench(const std::string& name, const Params& params, double cellsPerOp, double bytesPerOp,
+              const std::function<void()>& op) {
+    const std::string id = fullName(name, params);
+    if (!selected(id)) return;
+    if (g_options.listOnly) {
+        std::cout << id << std::endl;
+        return;
+    }
+
+    // Warm up and size the batch
+    auto t0 = Clock::now();
+    op();
+    double single = std::chrono::duration<double>(Clock::now() - t0).count();
+    int batch = std::max(1, static_cast<int>(1e-3 / std::max(single, 1e-9)));
+
+    const int kernel = g_profiler.registerKernel(id);
+    std::vector<double> nsPerOp;
+    double elapsed = 0.0;
+    while ((elapsed < g_options.minTime || nsPerOp.size() < 5) && nsPerOp.size() < 1000) {
+        g_profiler.begin(kernel);
+        auto start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            op();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        g_profiler.end(kernel, static_cast<uint64_t>(cellsPerOp * batch));
+        nsPerOp.push_back(seconds * 1e9 / batch);
+        elapsed += seconds;
+    }
+
+    BenchResult r;
+    r.name = name;
+    r.params = params;
+    r.samples = static_cast<int>(nsPerOp.size());
+    double sum = 0.0;
+    for (double v : nsPerOp) sum += v;
+    r.nsMean = sum / nsPerOp.size();
+    double var = 0.0;
+    for (double v : nsPerOp) var += (v - r.nsMean) * (v - r.nsMean);
+    r.nsStddev = nsPerOp.size() > 1 ? std::sqrt(var / (nsPerOp.size() - 1)) : 0.0;
+    r.cellsPerOp = cellsPerOp;
+    r.bytesPerOp = bytesPerOp;
+    if (const KernelStats* k = g_profiler.find(id)) {
+        r.counters = *k;
+        r.hasCounters = g_profiler.countersAvailable() && k->total.cycles > 0;
+    }
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-58s %12.1f ns/op %6.1f%% %10.1f Mcells/s %8.2f GB/s",
+                  id.c_str(), r.nsMean, r.nsMean > 0.0 ? 100.0 * r.nsStddev / r.nsMean : 0.0,
+                  r.cellsPerSecond() * 1e-6, r.gbPerSecond());
+    std::cout << line;
+    if (r.hasCounters) {
+        std::snprintf(line, sizeof(line), "  IPC %.2f  %.1f B/cell  L1D %.1f  LLC %.2f MPKI",
+                      r.counters.ipc(), r.counters.bytesPerCell(), r.counters.l1Mpki(), r.counters.llcMpki());
+        std::cout << line;
+    }
+    std::cout << std::endl;
+    g_results.push_back(r);
+}
+
+void randomizeWalls(Simulation& sim, float density, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (int y = 0; y < sim.size; y++) {
+        for (int x = 0; x < sim.size; x++) {
+            sim.walls[sim.index(x, y)] = uniform(rng) < density ? 1 : 0;
+        }
+    }
+}
+
+void randomizeField(Simulation& sim, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (int y = 0; y < sim.size; y++) {
+        for (int x = 0; x < sim.size; x++) {
+            sim.u_prev[sim.index(x, y)] = uniform(rng);
+            sim.u_prev2[sim.index(x, y)] = uniform(rng);
+        }
+    }
+}
+
+std::vector<int> threadCounts() {
+    if (!g_options.threads.empty()) return g_options.threads;
+    const int hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int t = 1; t < hw; t *= 2) counts.push_back(t);
+    counts.push_back(hw);
+    return counts;
+}
+
+void benchStencil() {
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    for (int threads : threadCounts()) {
+        pools.emplace_back(new ThreadPool(threads));
+    }
+
+    // SIMD runs in both storage layouts; the tiled/row-major pairs are compared at the end
+    struct Pair { size_t rowMajor, tiled; };
+    std::vector<Pair> pairs;
+
+    for (int size : g_options.sizes) {
+        std::unique_ptr<Simulation> sims[2];
+        for (float density : g_options.wallDensities) {
+            for (auto& sim : sims) {
+                if (sim) randomizeWalls(*sim, density, 2);
+            }
+            for (int v = 0; v < static_cast<int>(KernelVariant::COUNT); v++) {
+                const KernelVariant variant = static_cast<KernelVariant>(v);
+                for (auto& pool : pools) {
+                    size_t rowMajorResult = SIZE_MAX;
+                    for (int l = 0; l < 2; l++) {
+                        const FieldLayout layout = static_cast<FieldLayout>(l);
+                        if (layout == FieldLayout::TILED && variant != KernelVariant::SIMD) continue;
+                        Params params = { { "kernel", kernelVariantName(variant) }, { "layout", fieldLayoutName(layout) },
+                                          { "size", str(size) }, { "walls", str(density) },
+                                          { "threads", str(pool->size()) } };
+                        if (!selected(fullName("stencil", params))) continue;
+                        // Large grids are only allocated when one of their benchmarks runs
+                        auto& sim = sims[l];
+                        if (!g_options.listOnly && !sim) {
+                            sim.reset(new Simulation(size, layout));
+                            firstTouchFields(*sim, pools.back().get());
+                            randomizeField(*sim, 1);
+                            randomizeWalls(*sim, density, 2);
+                        }
+                        const double cells = double(size - 2) * double(size - 2);
+                        const float c2_dt2 = 0.1f;
+                        runBench("stencil", params, cells, cells * STENCIL_BYTES_PER_CELL, [&] {
+                            updateStencil(*sim, c2_dt2, variant, pool.get());
+                        });
+                        if (g_options.listOnly) continue;
+                        if (layout == FieldLayout::ROW_MAJOR) rowMajorResult = g_results.size() - 1;
+                        else if (rowMajorResult != SIZE_MAX) pairs.push_back({ rowMajorResult, g_results.size() - 1 });
+                    }
+                }
+            }
+        }
+    }
+
+    for (const auto& p : pairs) {
+        const BenchResult& row = g_results[p.rowMajor];
+        const BenchResult& tiled = g_results[p.tiled];
+        const double speedup = row.nsMean / tiled.nsMean;
+        char line[256];
+        std::snprintf(line, sizeof(line), "layout %-40s tiled %s row-major (%.2fx)",
+                      fullName("", { row.params[2], row.params[3], row.params[4] }).substr(1).c_str(),
+                      speedup > 1.0 ? "beats" : "trails", speedup);
+        std::cout << line << std::endl;
+    }
+}
+
+// ENSEMBLE_LANES scenes with one wall mask: one lane sweep against one single-threaded
+// SIMD sweep per scene. Both report scene-cells, so Mcells/s compare directly.
+void benchLanes() {
+    struct Pair { size_t single, lanes; };
+    std::vector<Pair> pairs;
+
+    for (int size : g_options.sizes) {
+        // The ensemble holds ENSEMBLE_LANES full scenes twice over; keep it to sweep-sized grids
+        if (size > 1024) continue;
+        std::vector<Simulation> scenes;
+        LaneEnsemble lanes;
+        for (float density : g_options.wallDensities) {
+            Params params = { { "size", str(size) }, { "walls", str(density) } };
+            Params singleParams = params, laneParams = params;
+            singleParams.insert(singleParams.begin(), { "kernel", "single" });
+            laneParams.insert(laneParams.begin(), { "kernel", "lanes" });
+            if (!selected(fullName("lanes", singleParams)) && !selected(fullName("lanes", laneParams))) continue;
+
+            if (!g_options.listOnly) {
+                scenes.clear();
+                scenes.reserve(ENSEMBLE_LANES);
+                std::vector<const Simulation*> pointers;
+                for (int k = 0; k < ENSEMBLE_LANES; k++) {
+                    scenes.emplace_back(size);
+                    randomizeField(scenes.back(), 1 + k);
+                    randomizeWalls(scenes.back(), density, 2);
+                    scenes.back().damping = 1.0f - 0.0005f * k;
+                    pointers.push_back(&scenes.back());
+                }
+                std::string error;
+                packLanes(pointers, lanes, error);
+            }
+
+            const double cells = double(ENSEMBLE_LANES) * double(size - 2) * double(size - 2);
+            const float c2_dt2 = 0.1f;
+            runBench("lanes", singleParams, cells, cells * STENCIL_BYTES_PER_CELL, [&] {
+                for (auto& sim : scenes) updateStencil(sim, c2_dt2, KernelVariant::SIMD, nullptr);
+            });
+            const size_t single = g_results.size() - 1;
+            runBench("lanes", laneParams, cells, cells * (3.0 * sizeof(float) + 1.0 / ENSEMBLE_LANES), [&] {
+                stepLanes(lanes, 1.0f / 60.0f, 1);
+            });
+            if (!g_options.listOnly && single + 2 == g_results.size()) pairs.push_back({ single, g_results.size() - 1 });
+        }
+    }
+
+    for (const auto& p : pairs) {
+        const BenchResult& single = g_results[p.single];
+        const BenchResult& lanes = g_results[p.lanes];
+        const double speedup = single.nsMean / lanes.nsMean;
+        char line[256];
+        std::snprintf(line, sizeof(line), "lanes %-41s lanes %s single (%.2fx)",
+                      fullName("", { single.params[1], single.params[2] }).substr(1).c_str(),
+                      speedup > 1.0 ? "beat" : "trail", speedup);
+        std::cout << line << std::endl;
+    }
+}
+
+void benchSources() {
+    Simulation sim(GRID_SIZE);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> pos(8.0f, GRID_SIZE - 8.0f);
+    for (int count : g_options.sourceCounts) {
+        sim.sources.clear();
+        for (int i = 0; i < count; i++) {
+            addSource(sim, pos(rng), pos(rng), 3.0f, 1.0f);
+        }
+        sim.time = 0.37f;
+        // 69 cells of the 9x9 window lie inside the radius-5 Gaussian footprint
+        const double cells = 69.0 * count;
+        runBench("sources", { { "count", str(count) } }, cells, cells * (2 * sizeof(float) + 1), [&] {
+            injectSources(sim);
+        });
+    }
+}
+
+void benchRendering() {
+    for (int size : { GRID_SIZE, 2048 }) {
+        Simulation sim(size);
+        randomizeWalls(sim, 0.1f, 4);
+        std::vector<float> texture;
+        const double cells = double(size) * size;
+        runBench("walls_to_texture", { { "size", str(size) } }, cells, cells * (1 + sizeof(float)), [&] {
+            wallsToTexture(sim, texture);
+        });
+    }
+}
+
+void benchInteraction() {
+    Simulation sim(GRID_SIZE);
+    const int c = GRID_SIZE / 2;
+    const double rippleCells = 31.0 * 31.0;
+    runBench("ripple", { { "size", str(GRID_SIZE) } }, rippleCells, rippleCells * (sizeof(float) * 2 + 1), [&] {
+        applyRipple(sim, c, c);
+    });
+
+    // Brushes only store cells that change, so each call flips the walls to keep the
+    // cells actually written
+    bool wall = false;
+    runBench("set_wall", { { "size", str(GRID_SIZE) } }, 25.0, 25.0, [&] {
+        stampBrush(sim, c, c, Brush(), wall = !wall);
+    });
+
+    struct Stroke { const char* name; int x0, y0, x1, y1; };
+    const Stroke strokes[] = {
+        { "horizontal", 64, c, GRID_SIZE - 64, c },
+        { "vertical", c, 64, c, GRID_SIZE - 64 },
+        { "diagonal", 64, 64, GRID_SIZE - 64, GRID_SIZE - 64 },
+        { "shallow", 64, c - 40, GRID_SIZE - 64, c + 40 },
+    };
+    for (const auto& s : strokes) {
+        const int steps = std::max(std::abs(s.x1 - s.x0), std::abs(s.y1 - s.y0)) + 1;
+        const double cells = 25.0 * steps;
+        runBench("draw_line", { { "stroke", s.name } }, cells, cells, [&] {
+            strokeBrush(sim, s.x0, s.y0, s.x1, s.y1, Brush(), wall = !wall);
+        });
+    }
+    Brush round;
+    round.shape = BrushShape::ROUND;
+    round.radius = 8;
+    for (const auto& s : strokes) {
+        const int steps = std::max(std::abs(s.x1 - s.x0), std::abs(s.y1 - s.y0)) + 1;
+        const double cells = 17.0 * steps;
+        runBench("draw_line", { { "stroke", s.name }, { "brush", "round8" } }, cells, cells, [&] {
+            strokeBrush(sim, s.x0, s.y0, s.x1, s.y1, round, wall = !wall);
+        });
+    }
+
+    // The whole (empty) grid, filled and emptied in turn
+    clearWalls(sim);
+    wall = false;
+    const double gridCells = double(GRID_SIZE) * GRID_SIZE;
+    runBench("flood_fill", { { "size", str(GRID_SIZE) } }, gridCells, 2.0 * gridCells, [&] {
+        floodFillWalls(sim, c, c, wall = !wall);
+    });
+}
+
+void benchPresets() {
+    Simulation sim(GRID_SIZE);
+    const double cells = double(GRID_SIZE) * GRID_SIZE;
+    // loadPreset logs every load; keep the table readable
+    std::ostringstream sink;
+    auto load = [&](const std::string& name) {
+        std::streambuf* old = std::cout.rdbuf(sink.rdbuf());
+        loadPreset(sim, name);
+        std::cout.rdbuf(old);
+        sink.str(std::string());
+    };
+    for (const auto& name : presetNames()) {
+        // Clearing swaps in fresh, untouched fields, so the traffic is the wall cells the
+        // rasterizer sets plus the sources (x, y, frequency, amplitude, active, name id)
+        load(name);
+        double wallCells = 0.0;
+        for (int y = 0; y < sim.size; y++) {
+            for (int x = 0; x < sim.size; x++) wallCells += sim.walls[sim.index(x, y)];
+        }
+        const double sourceBytes = double(sim.sources.size()) * (4 * sizeof(float) + 1 + sizeof(uint32_t));
+        runBench("preset", { { "name", name } }, cells, wallCells + sourceBytes, [&] {
+            load(name);
+        });
+    }
+}
+
+// Measures machine ceilings and places each stencil configuration on the roofline.
+int runRoofline() {
+    const int hw = std::max(1u, std::thread::hardware_concurrency());
+    const double probeTime = std::max(0.2, g_options.minTime);
+
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    pools.emplace_back(new ThreadPool(1));
+    if (hw > 1) pools.emplace_back(new ThreadPool(hw));
+
+    std::vector<MachineCeilings> ceilings;
+    for (auto& pool : pools) {
+        std::cout << "Probing bandwidth and FMA throughput on " << pool->size() << " thread(s)..." << std::endl;
+        ceilings.push_back(measureCeilings(*pool, probeTime));
+    }
+
+    struct Config { const char* name; KernelVariant variant; ThreadPool* pool; };
+    const std::vector<Config> configs = {
+        { "scalar", KernelVariant::SCALAR, pools.front().get() },
+        { "simd", KernelVariant::SIMD, pools.front().get() },
+        { "threaded", KernelVariant::SIMD, pools.back().get() },
+    };
+
+    // Open geometry: every cell performs the full stencil update
+    const int size = g_options.rooflineSize;
+    Simulation sim(size);
+    randomizeField(sim, 1);
+    const double cells = double(size - 2) * double(size - 2);
+
+    std::vector<RooflinePoint> points;
+    for (const auto& config : configs) {
+        Params params = { { "kernel", config.name }, { "size", str(size) }, { "threads", str(config.pool->size()) } };
+        runBench("roofline", params, cells, cells * STENCIL_BYTES_PER_CELL, [&] {
+            updateStencil(sim, 0.1f, config.variant, config.pool);
+        });
+        const BenchResult& r = g_results.back();
+
+        RooflinePoint p;
+        p.name = config.name;
+        p.threads = config.pool->size();
+        // Prefer measured DRAM traffic; fall back to the compulsory-traffic model
+        double bytesPerCell = STENCIL_BYTES_PER_CELL;
+        if (r.hasCounters && r.counters.bytesPerCell() > 0.0) {
+            bytesPerCell = r.counters.bytesPerCell();
+        }
+        p.intensity = STENCIL_FLOPS_PER_CELL / bytesPerCell;
+        p.gflops = r.cellsPerSecond() * STENCIL_FLOPS_PER_CELL * 1e-9;
+        for (const auto& c : ceilings) {
+            if (c.threads == p.threads) placeOnRoofline(p, c);
+        }
+        points.push_back(p);
+    }
+
+    printRooflineTable(ceilings, points);
+
+    const std::string csv = g_options.rooflinePrefix + ".csv";
+    const std::string svg = g_options.rooflinePrefix + ".svg";
+    if (!writeRooflineCsv(csv, ceilings, points) || !writeRooflineSvg(svg, ceilings, points)) {
+        std::cerr << "Failed to write roofline output" << std::endl;
+        return 1;
+    }
+    std::cout << "Roofline written to " << csv << " and " << svg << std::endl;
+    return 0;
+}
+
+// Records the golden corpus with the scalar reference solver on one thread.
+int recordGolden(const std::string& path) {
+    GoldenRun run;
+    std::vector<GoldenRecord> records;
+    SolverOptions reference;
+    reference.variant = KernelVariant::SCALAR;
+    for (const auto& name : presetNames()) {
+        records.push_back(captureGolden(name, run, reference));
+        std::cout << "recorded " << name << std::endl;
+    }
+    if (!writeGoldenCorpus(path, run, records)) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return 1;
+    }
+    std::cout << "Golden corpus written to " << path << std::endl;
+    return 0;
+}
+
+// Checks every kernel variant, single and multi-threaded, against the golden corpus.
+int checkGolden(const std::string& path) {
+    GoldenRun run;
+    std::vector<GoldenRecord> expected;
+    if (!readGoldenCorpus(path, run, expected)) {
+        std::cerr << "Failed to read golden corpus " << path << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    pools.emplace_back(nullptr);
+    const int hw = std::max(1u, std::thread::hardware_concurrency());
+    pools.emplace_back(new ThreadPool(std::max(2, hw)));
+
+    // Every variant row-major; the tiled layout only has its own kernel for SIMD
+    struct Config { KernelVariant variant; FieldLayout layout; };
+    std::vector<Config> configs;
+    for (int v = 0; v < static_cast<int>(KernelVariant::COUNT); v++) {
+        configs.push_back({ static_cast<KernelVariant>(v), FieldLayout::ROW_MAJOR });
+    }
+    configs.push_back({ KernelVariant::SIMD, FieldLayout::TILED });
+
+    int failures = 0;
+    for (const auto& golden : expected) {
+        for (const auto& config : configs) {
+            for (auto& pool : pools) {
+                SolverOptions options;
+                options.variant = config.variant;
+                options.pool = pool.get();
+                std::string id = "golden/" + golden.preset + "/" + kernelVariantName(options.variant) +
+                                 "/threads=" + str(pool ? pool->size() : 1);
+                if (config.layout != FieldLayout::ROW_MAJOR) id += std::string("/layout=") + fieldLayoutName(config.layout);
+                if (!selected(id)) continue;
+
+                GoldenRecord actual = captureGolden(golden.preset, run, options, config.layout);
+                std::string report;
+                bool bitExact = false;
+                bool ok = compareGolden(golden, actual, GOLDEN_TOLERANCE, report, bitExact);
+                if (!ok) failures++;
+
+                char line[256];
+                std::snprintf(line, sizeof(line), "%-52s %-4s %s%s", id.c_str(), ok ? "ok" : "FAIL",
+                              report.c_str(), bitExact ? " (bit-exact)" : "");
+                std::cout << line << std::endl;
+            }
+        }
+    }
+
+    std::cout << (failures ? "Golden check FAILED: " + str(failures) + " mismatches" : "Golden check passed") << std::endl;
+    return failures ? 1 : 0;
+}
+
+// Runs random cases against every kernel configuration for a bounded time. The first
+// divergence is minimized and written out as a reproducer.
+int fuzzKernels() {
+    const uint64_t seed = g_options.fuzzSeed ? g_options.fuzzSeed
+                                             : static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::cout << "Fuzzing kernel variants for " << g_options.fuzzSeconds << " s, seed " << seed << std::endl;
+
+    const auto configs = fuzzConfigs();
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t cases = 0;
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < g_options.fuzzSeconds) {
+        const uint64_t caseSeed = seed + cases++;
+        const FuzzCase c = randomFuzzCase(caseSeed);
+        for (const auto& config : configs) {
+            FuzzDivergence d = runFuzzCase(c, config);
+            if (!d.found) continue;
+
+            std::cout << "DIVERGENCE in case seed " << caseSeed << " (" << c.size << "x" << c.size << ")" << std::endl;
+            std::cout << "  " << describeDivergence(d) << std::endl;
+            const FuzzCase minimal = minimizeFuzzCase(c, config);
+            std::cout << "  minimized: " << describeDivergence(runFuzzCase(minimal, config)) << std::endl;
+            if (writeFuzzCase(g_options.fuzzOutput, minimal)) {
+                std::cout << "  reproducer written to " << g_options.fuzzOutput
+                          << " (replay with --fuzz-replay)" << std::endl;
+            }
+            return 1;
+        }
+    }
+    std::cout << cases << " cases x " << configs.size() << " configurations, no divergence" << std::endl;
+    return 0;
+}
+
+int replayFuzzCase(const std::string& path) {
+    FuzzCase c;
+    if (!readFuzzCase(path, c)) {
+        std::cerr << "Failed to read fuzz case " << path << std::endl;
+        return 1;
+    }
+    int failures = 0;
+    for (const auto& config : fuzzConfigs()) {
+        FuzzDivergence d = runFuzzCase(c, config);
+        if (d.found) failures++;
+        std::cout << describeDivergence(d) << std::endl;
+    }
+    return failures ? 1 : 0;
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+            out += buf;
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+bool writeJson(const std::string& path) {
+    std::ofstream f(path);
+    if (!f) return false;
+
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    f << "{\n";
+    f << "  \"meta\": {\n";
+    f << "    \"timestamp\": \"" << stamp << "\",\n";
+    f << "    \"cpu\": \"" << jsonEscape(hostCpuModel()) << "\",\n";
+    f << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    f << "    \"hardware_counters\": " << (g_profiler.countersAvailable() ? "true" : "false") << ",\n";
+    f << "    \"counter_status\": \"" << jsonEscape(g_profiler.countersStatus()) << "\"\n";
+    f << "  },\n";
+    f << "  \"results\": [\n";
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const BenchResult& r = g_results[i];
+        f << "    {\"name\": \"" << jsonEscape(r.name) << "\", \"params\": {";
+        for (size_t p = 0; p < r.params.size(); p++) {
+            f << (p ? ", " : "") << "\"" << jsonEscape(r.params[p].first) << "\": \""
+              << jsonEscape(r.params[p].second) << "\"";
+        }
+        f << "}, \"samples\": " << r.samples
+          << ", \"ns_per_op\": " << r.nsMean
+          << ", \"ns_per_op_stddev\": " << r.nsStddev
+          << ", \"cells_per_s\": " << r.cellsPerSecond()
+          << ", \"gb_per_s\": " << r.gbPerSecond();
+        if (r.hasCounters) {
+            f << ", \"ipc\": " << r.counters.ipc()
+              << ", \"dram_bytes_per_cell\": " << r.counters.bytesPerCell()
+              << ", \"l1d_mpki\": " << r.counters.l1Mpki()
+              << ", \"llc_mpki\": " << r.counters.llcMpki()
+              << ", \"stalled_fraction\": " << r.counters.stalledFraction();
+        }
+        f << "}" << (i + 1 < g_results.size() ? "," : "") << "\n";
+    }
+    f << "  ]\n";
+    f << "}\n";
+    return static_cast<bool>(f);
+}
+
+template <typename T>
+std::vector<T> parseList(const std::string& s) {
+    std::vector<T> values;
+    std::istringstream is(s);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        std::istringstream v(item);
+        T value;
+        if (v >> value) values.push_back(value);
+    }
+    return values;
+}
+
+void printUsage() {
+    std::cout << "Usage: wavesim-bench [options]\n"
+              << "  --filter <text>      Only run benchmarks whose name contains <text>\n"
+              << "  --sizes <list>       Stencil grid sizes (default 256,512,1024,2048,4096,8192)\n"
+              << "  --threads <list>     Stencil thread counts (default 1,2,4,...,hardware)\n"
+              << "  --walls <list>       Stencil wall densities (default 0,0.05,0.25)\n"
+              << "  --sources <list>     Source counts (default 1,10,100,1000,10000)\n"
+              << "  --min-time <sec>     Sampling time per benchmark (default 0.25)\n"
+              << "  --json <path>        JSON output file (default wavesim-bench.json, '' = none)\n"
+              << "  --list               List benchmark names without running them\n"
+              << "  --roofline <prefix>  Measure machine ceilings and write <prefix>.csv/.svg roofline\n"
+              << "  --roofline-size <n>  Grid size used for roofline kernels (default 2048)\n"
+              << "  --golden-record <f>  Record the preset golden corpus with the scalar reference solver\n"
+              << "  --golden-check <f>   Verify every kernel variant against a golden corpus (exit 1 on mismatch)\n"
+              << "  --fuzz-kernels <sec> Differentially fuzz kernel variants against the scalar reference\n"
+              << "  --fuzz-seed <n>      Seed for --fuzz-kernels (default: clock)\n"
+              << "  --fuzz-output <f>    Minimized reproducer path (default wavesim-fuzz-case.txt)\n"
+              << "  --fuzz-replay <f>    Replay a reproducer against every kernel configuration\n"
+              << "  --tune               Run the solver auto-tuner for each --sizes entry (tuning file untouched)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--filter") g_options.filter = next();
+        else if (arg == "--sizes") g_options.sizes = parseList<int>(next());
+        else if (arg == "--threads") g_options.threads = parseList<int>(next());
+        else if (arg == "--walls") g_options.wallDensities = parseList<float>(next());
+        else if (arg == "--sources") g_options.sourceCounts = parseList<int>(next());
+        else if (arg == "--min-time") g_options.minTime = std::atof(next().c_str());
+        else if (arg == "--json") g_options.jsonPath = next();
+        else if (arg == "--list") g_options.listOnly = true;
+        else if (arg == "--roofline") g_options.rooflinePrefix = next();
+        else if (arg == "--roofline-size") g_options.rooflineSize = std::atoi(next().c_str());
+        else if (arg == "--golden-record") g_options.goldenRecord = next();
+        else if (arg == "--golden-check") g_options.goldenCheck = next();
+        else if (arg == "--fuzz-kernels") g_options.fuzzSeconds = std::atof(next().c_str());
+        else if (arg == "--fuzz-seed") g_options.fuzzSeed = std::strtoull(next().c_str(), nullptr, 10);
+        else if (arg == "--fuzz-output") g_options.fuzzOutput = next();
+        else if (arg == "--fuzz-replay") g_options.fuzzReplay = next();
+        else if (arg == "--tune") g_options.tune = true;
+        else {
+            printUsage();
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    if (!g_options.goldenRecord.empty()) {
+        return recordGolden(g_options.goldenRecord);
+    }
+    if (!g_options.goldenCheck.empty()) {
+        return checkGolden(g_options.goldenCheck);
+    }
+    if (!g_options.fuzzReplay.empty()) {
+        return replayFuzzCase(g_options.fuzzReplay);
+    }
+    if (g_options.fuzzSeconds > 0.0) {
+        return fuzzKernels();
+    }
+
+    if (!g_options.listOnly) {
+        std::cout << "CPU: " << hostCpuModel() << ", " << std::thread::hardware_concurrency() << " threads" << std::endl;
+        std::cout << "Hardware counters: " << g_profiler.countersStatus() << std::endl;
+    }
+
+    if (!g_options.rooflinePrefix.empty()) {
+        return runRoofline();
+    }
+    if (g_options.tune) {
+        for (int size : g_options.sizes) {
+            std::cout << "Tuning " << size << "x" << size << std::endl;
+            TuneResult best = autoTune(size, std::max(1.0, g_options.minTime * 8), &std::cout);
+            std::cout << "best: " << kernelVariantName(best.variant) << ", tile " << best.tileWidth << ", "
+                      << best.threads << " threads, " << best.nsPerCell << " ns/cell" << std::endl;
+        }
+        return 0;
+    }
+
+    benchStencil();
+    benchLanes();
+    benchSources();
+    benchRendering();
+    benchInteraction();
+    benchPresets();
+
+    if (!g_options.listOnly && !g_options.jsonPath.empty()) {
+        if (!writeJson(g_options.jsonPath)) {
+            std::cerr << "Failed to write " << g_options.jsonPath << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << g_options.jsonPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+// wavesim-domain: steps one large grid across several processes on this host.
+//
+// The grid is split into blocks (see src/Domain.h); each rank is a forked process that owns
+// one block, optionally pinned to its share of the CPUs so its memory stays on one NUMA
+// node, and trades halo rows/columns with its neighbours through shared memory. The parent
+// builds the scene once before forking, so ranks read their block from copy-on-write pages.
+
+#include "Domain.h"
+#include "Npy.h"
+#include "Scene.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct DomainOptions {
+    int size = 4096;
+    int ranks = 4;
+    int threads = 1;                // pool threads per rank
+    float duration = 1.0f;          // simulated seconds
+    float dt = 1.0f / 60.0f;
+    std::string preset = "Double Slit";
+    bool pin = false;
+    bool verify = false;
+    std::string output;             // .npy of the final u
+};
+
+void printUsage() {
+    std::cout << "Usage: wavesim-domain [options]\n"
+              << "  --size <n>           Global grid edge (default 4096)\n"
+              << "  --ranks <n>          Processes (default 4)\n"
+              << "  --threads <n>        Threads per rank (default 1)\n"
+              << "  --preset <name>      Preset or .scene file (default \"Double Slit\")\n"
+              << "  --duration <s>       Simulated seconds (default 1)\n"
+              << "  --dt <s>             Substep length (default 1/60)\n"
+              << "  --pin                Pin each rank to its own block of CPUs\n"
+              << "  --verify             Compare against a single-process run (small grids)\n"
+              << "  --out <file.npy>     Write the final displacement field\n";
+}
+
+// Rank r gets CPUs [r * n / ranks, (r + 1) * n / ranks); neighbouring CPU numbers usually
+// share a node, so this keeps each rank's first-touched memory local
+void pinRank(int rank, int ranks) {
+#ifdef __linux__
+    const int cpus = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    const int first = rank * cpus / ranks;
+    const int last = std::max(first + 1, (rank + 1) * cpus / ranks);
+    for (int c = first; c < last && c < cpus; c++) CPU_SET(c, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)rank;
+    (void)ranks;
+#endif
+}
+
+int runRank(const DomainOptions& options, const Simulation& global, const DomainDecomposition& domain,
+            ShmHaloTransport& transport, int rank, float* gathered) {
+    transport.bind(rank);
+    if (options.pin) pinRank(rank, domain.ranks());
+
+    Subdomain sub;
+    extractSubdomain(global, domain, rank, sub);
+    std::unique_ptr<ThreadPool> pool;
+    if (options.threads > 1) pool.reset(new ThreadPool(options.threads));
+
+    const int steps = static_cast<int>(std::ceil(options.duration / options.dt - 1e-6));
+    transport.barrier();
+    const auto start = std::chrono::steady_clock::now();
+    stepSubdomain(sub, transport, options.dt, steps, pool.get());
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (gathered) storeSubdomain(sub, gathered);
+
+    // Report in rank order
+    for (int r = 0; r < domain.ranks(); r++) {
+        if (r == rank) {
+            const double cells = double(sub.width) * sub.height * steps;
+            std::printf("rank %2d  [%d,%d)x[%d,%d)  %.3f s  %8.1f Mcells/s  halo wait %4.1f%%\n", rank, sub.x0, sub.x1,
+                        sub.y0, sub.y1, seconds, cells / seconds * 1e-6, 100.0 * sub.haloWaitSeconds / seconds);
+            std::fflush(stdout);
+        }
+        transport.barrier();
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DomainOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--size") options.size = std::atoi(next().c_str());
+        else if (arg == "--ranks") options.ranks = std::atoi(next().c_str());
+        else if (arg == "--threads") options.threads = std::atoi(next().c_str());
+        else if (arg == "--preset") options.preset = next();
+        else if (arg == "--duration") options.duration = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--dt") options.dt = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--pin") options.pin = true;
+        else if (arg == "--verify") options.verify = true;
+        else if (arg == "--out") options.output = next();
+        else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    DomainDecomposition domain;
+    std::string error;
+    SceneSpec scene;
+    if (!findScene(options.preset, scene, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    if (options.size < 16 || options.dt <= 0.0f || !decomposeDomain(options.size, options.ranks, domain, error)) {
+        std::cerr << (error.empty() ? "Invalid size or dt" : error) << std::endl;
+        return 1;
+    }
+    std::unique_ptr<ShmHaloTransport> transport = ShmHaloTransport::create(domain.ranks(), domain.maxHalo(), error);
+    if (!transport) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    Simulation global(options.size);
+    {
+        // The pool is gone again before the ranks fork
+        ThreadPool loader;
+        SceneOptions sceneOptions;
+        sceneOptions.pool = &loader;
+        if (!loadScene(global, scene, PresetParams(), sceneOptions, nullptr, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    // Ranks write their final block here when the field is needed afterwards
+    float* gathered = nullptr;
+    const size_t gatherBytes = size_t(options.size) * options.size * sizeof(float);
+    if (options.verify || !options.output.empty()) {
+        void* p = mmap(nullptr, gatherBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            std::cerr << "Cannot map the gather buffer: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        gathered = static_cast<float*>(p);
+    }
+
+    std::printf("%d^2 grid on %d ranks (%dx%d blocks), %d threads each\n", options.size, domain.ranks(), domain.ranksX,
+                domain.ranksY, options.threads);
+    std::fflush(stdout);
+
+    std::vector<pid_t> children;
+    for (int rank = 0; rank < domain.ranks(); rank++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "fork failed: " << std::strerror(errno) << std::endl;
+            for (pid_t c : children) kill(c, SIGTERM);
+            return 1;
+        }
+        if (pid == 0) {
+            std::_Exit(runRank(options, global, domain, *transport, rank, gathered));
+        }
+        children.push_back(pid);
+    }
+
+    // A rank that dies leaves its neighbours waiting on halos; take the rest down with it
+    int failures = 0;
+    for (size_t remaining = children.size(); remaining > 0; remaining--) {
+        int status = 0;
+        const pid_t pid = wait(&status);
+        if (pid < 0) break;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            if (failures++ == 0) std::cerr << "rank process " << pid << " failed; stopping the others" << std::endl;
+            for (pid_t c : children) {
+                if (c != pid) kill(c, SIGTERM);
+            }
+        }
+    }
+    if (failures) return 1;
+
+    int result = 0;
+    if (!options.output.empty()) {
+        if (writeNpy(options.output, gathered, { size_t(options.size), size_t(options.size) })) {
+            std::cout << "Field written to " << options.output << std::endl;
+        } else {
+            std::cerr << "Failed to write " << options.output << std::endl;
+            result = 1;
+        }
+    }
+
+    if (options.verify) {
+        SolverOptions solver;
+        solver.variant = KernelVariant::SIMD;
+        const int steps = static_cast<int>(std::ceil(options.duration / options.dt - 1e-6));
+        stepSimulation(global, options.dt, steps, solver);
+
+        size_t mismatches = 0;
+        for (int y = 0; y < options.size; y++) {
+            for (int x = 0; x < options.size; x++) {
+                const float a = gathered[size_t(y) * options.size + x];
+                const float b = global.u[global.index(x, y)];
+                if (std::memcmp(&a, &b, sizeof(float)) != 0) {
+                    if (mismatches++ < 5) std::printf("  mismatch at (%d, %d): %.9g vs %.9g\n", x, y, a, b);
+                }
+            }
+        }
+        if (mismatches) {
+            std::printf("verify: %zu cells differ from the single-process run\n", mismatches);
+            result = 1;
+        } else {
+            std::printf("verify: bit-identical to the single-process run\n");
+        }
+    }
+
+    if (gathered) munmap(gathered, gatherBytes);
+    return result;
+}
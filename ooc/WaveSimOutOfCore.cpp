@@ -0,0 +1,201 @@
+// wavesim-ooc: steps a grid stored in a memory-mapped file (see src/FieldStore.h).
+//
+// The store can be far larger than RAM: the solver streams through it in row bands, reading
+// ahead of itself and writing finished bands back behind it. The run resumes from whatever
+// step the store is at, so repeated invocations continue one simulation. The GUI can watch
+// a store while it runs with `WaveSimulator --view-store <file>`.
+
+#include "FieldStore.h"
+#include "Npy.h"
+#include "Scene.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct OutOfCoreOptions {
+    std::string store;
+    bool create = false;
+    int size = 8192;
+    std::string preset = "Double Slit";
+    std::string sceneCache;         // compiled scenes for --create; empty = none
+    float duration = 1.0f;          // simulated seconds
+    float dt = 1.0f / 60.0f;
+    int threads = 1;
+    int bandRows = 0;               // 0 = store default
+    int prefetchBands = 2;
+    std::string overview;           // .npy of a downsampled u
+    int overviewSize = 1024;
+    bool verify = false;
+};
+
+void printUsage() {
+    std::cout << "Usage: wavesim-ooc <store> [options]\n"
+              << "  --create             Create the store from a preset (overwrites <store>)\n"
+              << "  --size <n>           Grid edge for --create (default 8192)\n"
+              << "  --preset <name>      Preset or .scene file for --create (default \"Double Slit\")\n"
+              << "  --scene-cache <dir>  Keep compiled scenes here; a repeated --create maps the walls\n"
+              << "  --duration <s>       Simulated seconds to advance (default 1)\n"
+              << "  --dt <s>             Substep length (default 1/60)\n"
+              << "  --threads <n>        Threads per band (default 1)\n"
+              << "  --band-rows <n>      Rows per streamed band (default ~1 MB per field)\n"
+              << "  --prefetch <n>       Bands read ahead (default 2)\n"
+              << "  --overview <file>    Write a downsampled displacement field as .npy\n"
+              << "  --overview-size <n>  Edge of the overview (default 1024)\n"
+              << "  --verify             Compare against an in-memory run (with --create, small grids)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    OutOfCoreOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--create") options.create = true;
+        else if (arg == "--size") options.size = std::atoi(next().c_str());
+        else if (arg == "--preset") options.preset = next();
+        else if (arg == "--scene-cache") options.sceneCache = next();
+        else if (arg == "--duration") options.duration = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--dt") options.dt = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--threads") options.threads = std::atoi(next().c_str());
+        else if (arg == "--band-rows") options.bandRows = std::atoi(next().c_str());
+        else if (arg == "--prefetch") options.prefetchBands = std::atoi(next().c_str());
+        else if (arg == "--overview") options.overview = next();
+        else if (arg == "--overview-size") options.overviewSize = std::atoi(next().c_str());
+        else if (arg == "--verify") options.verify = true;
+        else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (!arg.empty() && arg[0] != '-' && options.store.empty()) {
+            options.store = arg;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (options.store.empty() || options.dt <= 0.0f || options.overviewSize < 1) {
+        printUsage();
+        return 1;
+    }
+    if (options.verify && !options.create) {
+        std::cerr << "--verify needs --create (the reference run starts from the preset)" << std::endl;
+        return 1;
+    }
+
+    std::string error;
+    std::unique_ptr<FieldStore> store;
+    // Kept for --verify; otherwise released once imported
+    std::unique_ptr<Simulation> scene;
+    if (options.create) {
+        SceneSpec spec;
+        if (!findScene(options.preset, spec, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        // Simulation::index() is an int
+        if (options.size < 16 || int64_t(fieldPitch(options.size)) * options.size > INT32_MAX) {
+            std::cerr << "--size must be between 16 and 46000" << std::endl;
+            return 1;
+        }
+        // Fresh fields are untouched mappings, so only the preset's walls take memory here
+        scene.reset(new Simulation(options.size));
+        {
+            // Walls of a huge grid rasterize on every core, whatever --threads says
+            ThreadPool loader;
+            SceneOptions sceneOptions;
+            sceneOptions.pool = &loader;
+            sceneOptions.cacheDirectory = options.sceneCache;
+            if (!loadScene(*scene, spec, PresetParams(), sceneOptions, nullptr, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        }
+        store = FieldStore::create(options.store, options.size, error);
+        if (!store || !store->importScene(*scene, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        if (!options.verify) scene.reset();
+    } else {
+        store = FieldStore::open(options.store, true, error);
+        if (!store) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.bandRows > 0) store->setBandRows(options.bandRows);
+    store->setPrefetchBands(options.prefetchBands);
+    std::unique_ptr<ThreadPool> pool;
+    if (options.threads > 1) pool.reset(new ThreadPool(options.threads));
+
+    const int n = store->size();
+    const int steps = static_cast<int>(std::ceil(options.duration / options.dt - 1e-6));
+    std::printf("%d^2 store %s at step %llu, advancing %d steps\n", n, options.store.c_str(),
+                static_cast<unsigned long long>(store->header().step), steps);
+    std::fflush(stdout);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        store->step(options.dt, 1, pool.get());
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("\rstep %llu  t=%.3f s  %.1f Mcells/s", static_cast<unsigned long long>(store->header().step),
+                    store->header().time, double(n - 2) * (n - 2) * (s + 1) / seconds * 1e-6);
+        std::fflush(stdout);
+    }
+    store->flush();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%s%d steps in %.2f s\n", steps ? "\n" : "", steps, seconds);
+
+    int result = 0;
+    if (!options.overview.empty()) {
+        const int m = std::min(options.overviewSize, n);
+        std::vector<float> field(size_t(m) * m);
+        store->overview(m, field.data());
+        if (writeNpy(options.overview, field.data(), { size_t(m), size_t(m) })) {
+            std::cout << "Overview written to " << options.overview << std::endl;
+        } else {
+            std::cerr << "Failed to write " << options.overview << std::endl;
+            result = 1;
+        }
+    }
+
+    if (options.verify) {
+        SolverOptions solver;
+        solver.variant = KernelVariant::SIMD;
+        stepSimulation(*scene, options.dt, steps, solver);
+
+        std::vector<float> field(size_t(n) * n);
+        store->readField(field.data());
+        size_t mismatches = 0;
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                const float a = field[size_t(y) * n + x];
+                const float b = scene->u[scene->index(x, y)];
+                if (std::memcmp(&a, &b, sizeof(float)) != 0) {
+                    if (mismatches++ < 5) std::printf("  mismatch at (%d, %d): %.9g vs %.9g\n", x, y, a, b);
+                }
+            }
+        }
+        if (mismatches) {
+            std::printf("verify: %zu cells differ from the in-memory run\n", mismatches);
+            result = 1;
+        } else {
+            std::printf("verify: bit-identical to the in-memory run\n");
+        }
+    }
+    return result;
+}
@@ -0,0 +1,301 @@
+// wavesim-rec: records a preset into a streaming field recording (see src/Recording.h),
+// and inspects, exports or renders existing recordings.
+//
+// `record` steps the solver on this thread and hands every Nth field to the recorder,
+// which quantizes, delta-codes and deflates it on its own thread pool. With --pace the
+// solver runs at a fixed frame rate like the app does, and any frame the encoder cannot
+// keep up with is dropped and counted instead of stalling the solver.
+//
+// `render` colors frames with the CPU port of the app's shader (src/Colormap.h) on a
+// thread pool and encodes them as PNG/PPM on a second pool, or into one .y4m video.
+
+#include "Colormap.h"
+#include "ImageWriter.h"
+#include "Recording.h"
+#include "Scene.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void printUsage() {
+    std::cout << "Usage: wavesim-rec record <out.wsrec> [options]\n"
+              << "         --preset <name>      Preset or .scene file to record (default \"Double Slit\")\n"
+              << "         --size <n>           Grid edge (default 1024)\n"
+              << "         --duration <s>       Simulated seconds (default 5)\n"
+              << "         --dt <s>             Substep length (default 1/60)\n"
+              << "         --every <n>          Record every n-th substep (default 1)\n"
+              << "         --keyframes <n>      Frames per keyframe (default 30)\n"
+              << "         --quantum <v>        Quantization step (default 1/1024)\n"
+              << "         --threads <n>        Encoder threads (default hardware concurrency)\n"
+              << "         --pace <fps>         Step at a fixed rate, dropping frames the encoder\n"
+              << "                              cannot keep up with (default: as fast as possible,\n"
+              << "                              waiting for the encoder)\n"
+              << "       wavesim-rec info <file.wsrec>\n"
+              << "       wavesim-rec export <file.wsrec> <out.npy> [--first <i>] [--last <i>] [--stride <n>]\n"
+              << "       wavesim-rec render <file.wsrec> <out> [options]\n"
+              << "         <out>                A directory for numbered images, or a .y4m video\n"
+              << "         --format <f>         Image format in a directory: png or ppm (default png)\n"
+              << "         --colormap <name>    energy, rainbow, grayscale or cyan-yellow (default rainbow)\n"
+              << "         --contrast <v>       As the app's contrast slider (default 1.5)\n"
+              << "         --first/--last/--stride  Frame range, as for export\n"
+              << "         --threads <n>        Render and encoder threads (default hardware concurrency)\n"
+              << "         --fps <n>            Frame rate of a .y4m video (default 30)\n";
+}
+
+int record(int argc, char** argv) {
+    std::string path;
+    std::string preset = "Double Slit";
+    int size = 1024;
+    float duration = 5.0f;
+    float dt = 1.0f / 60.0f;
+    float pace = 0.0f;
+    RecordingOptions options;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--preset") preset = next();
+        else if (arg == "--size") size = std::atoi(next().c_str());
+        else if (arg == "--duration") duration = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--dt") dt = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--every") options.every = std::atoi(next().c_str());
+        else if (arg == "--keyframes") options.keyframeInterval = std::atoi(next().c_str());
+        else if (arg == "--quantum") options.quantum = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--threads") options.threads = std::atoi(next().c_str());
+        else if (arg == "--pace") pace = static_cast<float>(std::atof(next().c_str()));
+        else if (path.empty() && !arg.empty() && arg[0] != '-') path = arg;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (path.empty() || size < 16 || dt <= 0.0f || options.every < 1) {
+        printUsage();
+        return 1;
+    }
+    Simulation sim(size);
+    SceneSpec scene;
+    std::string error;
+    if (!findScene(preset, scene, error) || !loadScene(sim, scene, PresetParams(), SceneOptions(), nullptr, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    options.dropWhenBusy = pace > 0.0f;
+
+    std::unique_ptr<FieldRecorder> recorder = FieldRecorder::create(path, size, options, error);
+    if (!recorder) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    SolverOptions solver;
+    solver.variant = KernelVariant::SIMD;
+    const int steps = static_cast<int>(std::ceil(duration / dt - 1e-6));
+    const auto start = std::chrono::steady_clock::now();
+    auto frameDue = start;
+    double solverSeconds = 0.0;
+    for (int s = 1; s <= steps; s++) {
+        const auto t0 = std::chrono::steady_clock::now();
+        stepSimulation(sim, dt, 1, solver);
+        solverSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (s % options.every == 0) recorder->capture(sim, s);
+        if (pace > 0.0f) {
+            frameDue += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / pace));
+            std::this_thread::sleep_until(frameDue);
+        }
+    }
+    const double stepping = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!recorder->close(error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    const double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const int frames = recorder->framesWritten();
+    const double raw = double(size) * size * sizeof(float) * frames;
+    std::printf("%d steps (%.2f s in the solver), %d frames written, %d dropped\n", steps, solverSeconds, frames,
+                recorder->framesDropped());
+    std::printf("%.1f frames/s recorded (%.2f s stepping, %.2f s draining the encoder)\n", frames / total, stepping,
+                total - stepping);
+    std::printf("%.1f MB on disk, %.1fx smaller than float32\n", recorder->bytesWritten() / 1e6,
+                raw / std::max<double>(1.0, double(recorder->bytesWritten())));
+    return 0;
+}
+
+int info(const std::string& path) {
+    std::string error;
+    std::unique_ptr<RecordingReader> reader = RecordingReader::open(path, error);
+    if (!reader) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    const RecordingHeader& h = reader->header();
+    int keyframes = 0;
+    for (int i = 0; i < reader->frameCount(); i++) keyframes += reader->frame(i).keyframe ? 1 : 0;
+    std::printf("%d^2, %d frames (%d keyframes), every %u steps, quantum %g%s\n", reader->size(),
+                reader->frameCount(), keyframes, h.every, h.quantum,
+                h.indexOffset ? "" : " (not closed; index rebuilt from the frames)");
+    if (reader->frameCount()) {
+        const RecordingFrameInfo& first = reader->frame(0);
+        const RecordingFrameInfo& last = reader->frame(reader->frameCount() - 1);
+        std::printf("steps %llu..%llu, t = %.3f..%.3f s\n", static_cast<unsigned long long>(first.step),
+                    static_cast<unsigned long long>(last.step), first.time, last.time);
+    }
+    return 0;
+}
+
+int exportNpy(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage();
+        return 1;
+    }
+    int first = 0, last = INT32_MAX, stride = 1;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--first") first = std::atoi(next().c_str());
+        else if (arg == "--last") last = std::atoi(next().c_str());
+        else if (arg == "--stride") stride = std::atoi(next().c_str());
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    std::string error;
+    std::unique_ptr<RecordingReader> reader = RecordingReader::open(argv[2], error);
+    if (!reader || !exportRecordingNpy(*reader, argv[3], first, last, stride, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::cout << "Exported to " << argv[3] << std::endl;
+    return 0;
+}
+
+int render(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage();
+        return 1;
+    }
+    const std::string out = argv[3];
+    int first = 0, last = INT32_MAX, stride = 1, threads = 0, fps = 30;
+    std::string format = "png";
+    ColormapOptions colors;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--first") first = std::atoi(next().c_str());
+        else if (arg == "--last") last = std::atoi(next().c_str());
+        else if (arg == "--stride") stride = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--threads") threads = std::atoi(next().c_str());
+        else if (arg == "--fps") fps = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--format") format = next();
+        else if (arg == "--contrast") colors.contrast = static_cast<float>(std::atof(next().c_str()));
+        else if (arg == "--colormap") {
+            const std::string name = next();
+            if (!parseColormap(name, colors.map)) {
+                std::cerr << "Unknown colormap " << name << std::endl;
+                return 1;
+            }
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (format != "png" && format != "ppm") {
+        std::cerr << "Unknown format " << format << std::endl;
+        return 1;
+    }
+
+    std::string error;
+    std::unique_ptr<RecordingReader> reader = RecordingReader::open(argv[2], error);
+    if (!reader) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    last = std::min(last, reader->frameCount() - 1);
+    first = std::max(first, 0);
+    if (last < first) {
+        std::cerr << "no frames to render" << std::endl;
+        return 1;
+    }
+    const bool video = out.size() >= 4 && out.compare(out.size() - 4, 4, ".y4m") == 0;
+    const int n = reader->size();
+    Y4mWriter y4m;
+    if (video) {
+        if (!y4m.open(out, n, n, fps, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    } else {
+        std::error_code ec;
+        std::filesystem::create_directories(out, ec);
+        if (ec) {
+            std::cerr << "Cannot create " << out << ": " << ec.message() << std::endl;
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threads);
+    ImageWriter writer(pool.size());
+    std::vector<float> u(size_t(n) * n);
+    std::vector<uint8_t> walls(size_t(n) * n);
+    const auto start = std::chrono::steady_clock::now();
+    int frames = 0;
+    for (int f = first; f <= last; f += stride, frames++) {
+        if (!reader->readFrame(f, u.data(), walls.data(), error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        Image image;
+        image.width = image.height = n;
+        image.channels = 3;
+        image.bottomUp = true;
+        image.pixels.resize(size_t(n) * n * 3);
+        renderColormap(u.data(), walls.data(), n, colors, image.pixels.data(), &pool);
+        if (video) {
+            if (!y4m.write(image)) {
+                std::cerr << "Failed to write " << out << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%06d.", f);
+        image.path = out + name + format;
+        // Keep a couple of frames per encoder in flight
+        writer.wait(2 * pool.size());
+        writer.submit(std::move(image));
+    }
+    writer.wait();
+    int failures = 0;
+    for (const ImageResult& r : writer.finished()) failures += r.ok ? 0 : 1;
+    if (video && !y4m.close()) failures++;
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%d frames rendered to %s in %.2f s (%.1f frames/s)\n", frames, out.c_str(), seconds, frames / seconds);
+    if (failures) std::printf("%d images failed to write\n", failures);
+    return failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (command == "record") return record(argc, argv);
+    if (command == "info" && argc == 3) return info(argv[2]);
+    if (command == "export") return exportNpy(argc, argv);
+    if (command == "render") return render(argc, argv);
+    printUsage();
+    return command == "--help" || command == "-h" ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+#include "AutoTune.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+namespace {
+
+struct Candidate {
+    KernelVariant variant;
+    int tileWidth;
+    int threads;
+};
+
+int hardwareThreads() {
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+KernelVariant variantFromName(const std::string& name) {
+    for (int v = 0; v < static_cast<int>(KernelVariant::COUNT); v++) {
+        if (name == kernelVariantName(static_cast<KernelVariant>(v))) return static_cast<KernelVariant>(v);
+    }
+    return KernelVariant::COUNT;
+}
+
+// Best-of-batches stencil cost in ns per cell. Batches are short so that a
+// descheduled batch only costs one sample.
+double timeCandidate(Simulation& sim, const Candidate& c, ThreadPool* pool, double seconds) {
+    using Clock = std::chrono::steady_clock;
+    const float c2_dt2 = 0.1f;
+    const double cells = double(sim.size - 2) * (sim.size - 2);
+
+    updateStencil(sim, c2_dt2, c.variant, pool, c.tileWidth);  // warm caches and page tables
+    double best = 1e30;
+    const auto start = Clock::now();
+    do {
+        const auto t0 = Clock::now();
+        for (int i = 0; i < 4; i++) {
+            updateStencil(sim, c2_dt2, c.variant, pool, c.tileWidth);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / 4;
+        best = std::min(best, ns / cells);
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < seconds);
+    return best;
+}
+
+} // namespace
+
+std::string hostCpuModel() {
+#if defined(__APPLE__)
+    char brand[256];
+    size_t length = sizeof(brand);
+    if (sysctlbyname("machdep.cpu.brand_string", brand, &length, nullptr, 0) == 0) return brand;
+#else
+    std::ifstream f("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) return line.substr(colon + 2);
+        }
+    }
+#endif
+    return "unknown";
+}
+
+std::string tuningFilePath() {
+    if (const char* path = std::getenv("WAVESIM_TUNING_FILE")) return path;
+    if (const char* cache = std::getenv("XDG_CACHE_HOME")) return std::string(cache) + "/wavesim/tuning.txt";
+    if (const char* home = std::getenv("HOME")) return std::string(home) + "/.cache/wavesim/tuning.txt";
+    return "wavesim-tuning.txt";
+}
+
+// One entry per line: grid size, hardware threads, variant, tile width, solver threads,
+// ns/cell, CPU model (rest of the line). The first three fields and the CPU model form the key.
+bool loadTuning(const std::string& path, int gridSize, TuneResult& result) {
+    std::ifstream f(path);
+    if (!f) return false;
+
+    const std::string cpu = hostCpuModel();
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream is(line);
+        int size = 0, hw = 0, tile = 0, threads = 0;
+        double ns = 0.0;
+        std::string variant, model;
+        if (!(is >> size >> hw >> variant >> tile >> threads >> ns)) continue;
+        std::getline(is >> std::ws, model);
+        if (size != gridSize || hw != hardwareThreads() || model != cpu) continue;
+
+        const KernelVariant v = variantFromName(variant);
+        if (v == KernelVariant::COUNT || threads < 1) continue;
+        result.variant = v;
+        result.tileWidth = std::max(0, tile);
+        result.threads = threads;
+        result.nsPerCell = ns;
+        result.cached = true;
+        return true;
+    }
+    return false;
+}
+
+bool saveTuning(const std::string& path, int gridSize, const TuneResult& result) {
+    const std::string cpu = hostCpuModel();
+    std::vector<std::string> lines;
+    {
+        // Keep entries for other hosts and grid sizes
+        std::ifstream f(path);
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream is(line);
+            int size = 0, hw = 0;
+            std::string variant, model;
+            int tile = 0, threads = 0;
+            double ns = 0.0;
+            if (is >> size >> hw >> variant >> tile >> threads >> ns) {
+                std::getline(is >> std::ws, model);
+                if (size == gridSize && hw == hardwareThreads() && model == cpu) continue;
+            }
+            lines.push_back(line);
+        }
+    }
+
+    char entry[512];
+    std::snprintf(entry, sizeof(entry), "%d %d %s %d %d %.4f %s", gridSize, hardwareThreads(),
+                  kernelVariantName(result.variant), result.tileWidth, result.threads, result.nsPerCell, cpu.c_str());
+    lines.push_back(entry);
+
+    std::error_code ec;
+    const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+
+    std::ofstream f(path);
+    if (!f) return false;
+    f << "# wavesim tuning: grid hw_threads variant tile_width threads ns_per_cell cpu_model\n";
+    for (const auto& line : lines) {
+        f << line << "\n";
+    }
+    return static_cast<bool>(f);
+}
+
+TuneResult autoTune(int gridSize, double budgetSeconds, std::ostream* log) {
+    // A representative field: a few percent of walls so the scalar branch is exercised
+    Simulation sim(gridSize);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (int y = 0; y < gridSize; y++) {
+        for (int x = 0; x < gridSize; x++) {
+            sim.walls[sim.index(x, y)] = uniform(rng) < 0.05f ? 1 : 0;
+            sim.u_prev[sim.index(x, y)] = uniform(rng) - 0.5f;
+        }
+    }
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < hardwareThreads(); t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(hardwareThreads());
+
+    std::vector<int> tiles = { 0 };
+    for (int tile : { 64, 128, 256, 512 }) {
+        if (tile < gridSize - 2) tiles.push_back(tile);
+    }
+
+    std::vector<Candidate> candidates;
+    for (int v = 0; v < static_cast<int>(KernelVariant::COUNT); v++) {
+        for (int tile : tiles) {
+            for (int threads : threadCounts) {
+                candidates.push_back({ static_cast<KernelVariant>(v), tile, threads });
+            }
+        }
+    }
+    const double perCandidate = std::max(0.01, budgetSeconds / candidates.size());
+
+    TuneResult best;
+    best.nsPerCell = 1e30;
+    std::unique_ptr<ThreadPool> pool;
+    for (const auto& c : candidates) {
+        if (c.threads > 1 && (!pool || pool->size() != c.threads)) {
+            pool.reset(new ThreadPool(c.threads));
+        }
+        const double ns = timeCandidate(sim, c, c.threads > 1 ? pool.get() : nullptr, perCandidate);
+        if (log) {
+            char line[128];
+            std::snprintf(line, sizeof(line), "  %-6s tile %-4d threads %-3d %8.3f ns/cell",
+                          kernelVariantName(c.variant), c.tileWidth, c.threads, ns);
+            *log << line << std::endl;
+        }
+        if (ns < best.nsPerCell) {
+            best.variant = c.variant;
+            best.tileWidth = c.tileWidth;
+            best.threads = c.threads;
+            best.nsPerCell = ns;
+        }
+    }
+    return best;
+}
+
+TuneResult tunedConfiguration(int gridSize, bool retune, std::ostream* log) {
+    const std::string path = tuningFilePath();
+    TuneResult result;
+    if (!retune && loadTuning(path, gridSize, result)) {
+        return result;
+    }
+
+    if (log) *log << "Tuning stencil for " << gridSize << "x" << gridSize << " on " << hostCpuModel() << std::endl;
+    result = autoTune(gridSize, 2.0, log);
+    if (!saveTuning(path, gridSize, result) && log) {
+        *log << "Failed to write tuning file " << path << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Solver.h"
+
+#include <iosfwd>
+#include <string>
+
+// Picks the fastest stencil configuration (kernel variant, column tile width and thread
+// count) for this machine and grid size by timing candidates, and caches the winner in a
+// per-host tuning file so later launches skip the measurement.
+
+struct TuneResult {
+    KernelVariant variant = KernelVariant::SIMD;
+    int tileWidth = 0;          // 0 = whole rows
+    int threads = 1;
+    double nsPerCell = 0.0;     // measured stencil cost of the winner
+    bool cached = false;        // loaded from the tuning file rather than measured
+};
+
+// CPU model string ("unknown" when it cannot be determined).
+std::string hostCpuModel();
+
+// $WAVESIM_TUNING_FILE, else $XDG_CACHE_HOME/wavesim/tuning.txt, else ~/.cache/wavesim/tuning.txt.
+std::string tuningFilePath();
+
+// Cached entry for this host and grid size, if any.
+bool loadTuning(const std::string& path, int gridSize, TuneResult& result);
+// Adds or replaces the entry for this host and grid size.
+bool saveTuning(const std::string& path, int gridSize, const TuneResult& result);
+
+// Times every candidate for about `budgetSeconds` in total. Progress goes to `log` if set.
+TuneResult autoTune(int gridSize, double budgetSeconds = 2.0, std::ostream* log = nullptr);
+
+// Cached result if present (unless `retune`), otherwise tunes and stores the result.
+TuneResult tunedConfiguration(int gridSize, bool retune = false, std::ostream* log = nullptr);
@@ -0,0 +1,136 @@
+#include "Brush.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Half widths of the brush in each of its 2r + 1 rows, top to bottom
+void brushRows(const Brush& brush, std::vector<int>& rows) {
+    const int r = std::max(0, brush.radius);
+    rows.assign(2 * r + 1, r);
+    if (brush.shape == BrushShape::ROUND) {
+        for (int dy = -r; dy <= r; dy++) {
+            int h = static_cast<int>(std::sqrt(static_cast<float>(r * r - dy * dy)));
+            while (h * h + dy * dy > r * r) h--;
+            while ((h + 1) * (h + 1) + dy * dy <= r * r) h++;
+            rows[dy + r] = h;
+        }
+    }
+}
+
+// Sets cells x0..x1 of row y (inside the grid) to `value`. The row is stored in contiguous
+// runs (the whole row, or one tile's row when tiled); each run is scanned for cells that
+// differ and written only between the first and last of them.
+void writeSpan(Simulation& sim, int y, int x0, int x1, uint8_t value, DirtyRect& dirty) {
+    const int tileMask = sim.layout == FieldLayout::TILED ? FIELD_TILE - 1 : INT_MAX;
+    for (int x = x0; x <= x1;) {
+        const int end = std::min(x1, x | tileMask);
+        uint8_t* run = &sim.walls[sim.index(x, y)];
+        int first = -1, last = -1;
+        for (int i = 0; i <= end - x; i++) {
+            if (run[i] == value) continue;
+            if (first < 0) first = i;
+            last = i;
+        }
+        if (first >= 0) {
+            std::memset(run + first, value, last - first + 1);
+            dirty.include(DirtyRect{ x + first, y, x + last + 1, y + 1 });
+        }
+        x = end + 1;
+    }
+}
+
+} // namespace
+
+DirtyRect stampBrush(Simulation& sim, int x, int y, const Brush& brush, bool wall) {
+    return strokeBrush(sim, x, y, x, y, brush, wall);
+}
+
+DirtyRect strokeBrush(Simulation& sim, int x0, int y0, int x1, int y1, const Brush& brush, bool wall) {
+    // Strokes come with every cursor event; keep the scratch rows between calls
+    thread_local std::vector<int> halfWidth, runLeft, runRight;
+    brushRows(brush, halfWidth);
+    const int r = static_cast<int>(halfWidth.size()) / 2;
+    const int lineTop = std::min(y0, y1), lineBottom = std::max(y0, y1);
+    const int top = std::max(0, lineTop - r);
+    const int bottom = std::min(sim.size - 1, lineBottom + r);
+    DirtyRect dirty;
+    if (top > bottom) return dirty;
+
+    // The Bresenham steps on each line row form one run of x
+    runLeft.assign(lineBottom - lineTop + 1, INT_MAX);
+    runRight.assign(lineBottom - lineTop + 1, INT_MIN);
+    const int dx = std::abs(x1 - x0), dy = std::abs(y1 - y0);
+    const int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+    int err = dx - dy;
+    for (int x = x0, y = y0;;) {
+        runLeft[y - lineTop] = std::min(runLeft[y - lineTop], x);
+        runRight[y - lineTop] = std::max(runRight[y - lineTop], x);
+        if (x == x1 && y == y1) break;
+        const int e2 = 2 * err;
+        if (e2 > -dy) {
+            err -= dy;
+            x += sx;
+        }
+        if (e2 < dx) {
+            err += dx;
+            y += sy;
+        }
+    }
+
+    // A grid row is covered by the dabs of the line rows within r of it. The line moves at
+    // most one cell per step and the brush rows are centred, so those dabs overlap or
+    // touch and their union is one span.
+    const uint8_t value = wall ? 1 : 0;
+    for (int row = top; row <= bottom; row++) {
+        int left = INT_MAX, right = INT_MIN;
+        for (int y = std::max(lineTop, row - r); y <= std::min(lineBottom, row + r); y++) {
+            const int h = halfWidth[row - y + r];
+            left = std::min(left, runLeft[y - lineTop] - h);
+            right = std::max(right, runRight[y - lineTop] + h);
+        }
+        left = std::max(0, left);
+        right = std::min(sim.size - 1, right);
+        if (left <= right) writeSpan(sim, row, left, right, value, dirty);
+    }
+    return dirty;
+}
+
+DirtyRect floodFillWalls(Simulation& sim, int x, int y, bool wall) {
+    DirtyRect dirty;
+    const int n = sim.size;
+    if (x < 0 || x >= n || y < 0 || y >= n) return dirty;
+    const uint8_t value = wall ? 1 : 0;
+    const uint8_t target = sim.walls[sim.index(x, y)];
+    if (target == value) return dirty;
+
+    auto matches = [&](int cx, int cy) { return sim.walls[sim.index(cx, cy)] == target; };
+    // Seeds are cells of the region; each one grows into its row's whole run, which is
+    // filled, and then seeds the runs above and below it. Filled cells no longer match,
+    // so seeds of runs that were reached another way are dropped.
+    std::vector<std::pair<int, int>> seeds{ { x, y } };
+    while (!seeds.empty()) {
+        const auto [sx, sy] = seeds.back();
+        seeds.pop_back();
+        if (!matches(sx, sy)) continue;
+        int x0 = sx, x1 = sx;
+        while (x0 > 0 && matches(x0 - 1, sy)) x0--;
+        while (x1 < n - 1 && matches(x1 + 1, sy)) x1++;
+        writeSpan(sim, sy, x0, x1, value, dirty);
+        for (int ny : { sy - 1, sy + 1 }) {
+            if (ny < 0 || ny >= n) continue;
+            for (int cx = x0; cx <= x1; cx++) {
+                if (!matches(cx, ny)) continue;
+                seeds.emplace_back(cx, ny);
+                while (cx < x1 && matches(cx + 1, ny)) cx++;
+            }
+        }
+    }
+    return dirty;
+}
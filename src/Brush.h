@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Simulation.h"
+
+// Wall brushes. Every operation is written as horizontal spans of cells, each cell at most
+// once, and only the cells whose value changes are stored (so erasing open water leaves
+// its pages untouched). Each returns the bounding box of the cells it changed, which is
+// empty when the walls already looked like that; the app uploads just that part of the
+// wall texture.
+
+enum class BrushShape { SQUARE, ROUND };
+
+struct Brush {
+    BrushShape shape = BrushShape::SQUARE;
+    // Cells from the centre to the edge: SQUARE covers (2r + 1)^2 cells, ROUND the cells
+    // within r of the centre. SQUARE 2 is the 5x5 brush the app always had.
+    int radius = 2;
+};
+
+// One dab of the brush centred on (x, y), clipped to the grid
+DirtyRect stampBrush(Simulation& sim, int x, int y, const Brush& brush, bool wall);
+
+// Every cell the brush covers while its centre walks the 8-connected line from (x0, y0) to
+// (x1, y1): a thick line for SQUARE, a capsule for ROUND. The covered cells of each row
+// are worked out first, so a row is written as one span however many dabs overlap it.
+DirtyRect strokeBrush(Simulation& sim, int x0, int y0, int x1, int y1, const Brush& brush, bool wall);
+
+// Scanline fill: sets the 4-connected region of cells that match the one at (x, y) to
+// `wall` (closing a room with walls, or clearing a wall shape in one click)
+DirtyRect floodFillWalls(Simulation& sim, int x, int y, bool wall);
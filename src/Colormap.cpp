@@ -0,0 +1,209 @@
+#include "Colormap.h"
+
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// GLSL mix()
+inline float mix(float x, float y, float a) {
+    return x * (1.0f - a) + y * a;
+}
+
+inline float clamp01(float v) {
+    return std::min(std::max(v, 0.0f), 1.0f);
+}
+
+// Float to unorm8, as GL stores into an RGBA8 target (round to nearest; the truncating
+// conversion floors here since the value is non-negative, and vectorizes)
+inline uint8_t unorm8(float v) {
+    return static_cast<uint8_t>(static_cast<int>(clamp01(v) * 255.0f + 0.5f));
+}
+
+const float WALL_GRAY = 0.15f;
+
+// Branch-free exp2/log2 so the color loops vectorize (libm calls do not). Both are accurate
+// to a few float ulps, far below one 8-bit step.
+inline float exp2Poly(float x) {
+    x = std::min(std::max(x, -126.0f), 127.0f);
+    // Round to nearest through the float mantissa (|x| < 2^22)
+    const float k = (x + 12582912.0f) - 12582912.0f;
+    const float f = x - k;
+    const float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f +
+                    f * (0.00961813f + f * (0.00133336f + f * 0.00015404f)))));
+    const int32_t bits = (static_cast<int32_t>(k) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// log2 of a positive normal float (0 gives -127, which exp2Poly() takes to ~0)
+inline float log2Poly(float x) {
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    int32_t e = (bits >> 23) - 127;
+    const int32_t mantissa = (bits & 0x007fffff) | 0x3f800000;
+    float m;
+    std::memcpy(&m, &mantissa, sizeof(m));
+    // Centre the mantissa on 1 so the series below converges fast: m in [0.707, 1.414)
+    const bool high = m > 1.41421356f;
+    m = high ? m * 0.5f : m;
+    e = high ? e + 1 : e;
+    // ln(m) = 2 atanh(s), s = (m - 1) / (m + 1), |s| < 0.172
+    const float s = (m - 1.0f) / (m + 1.0f);
+    const float s2 = s * s;
+    const float ln = 2.0f * s * (1.0f + s2 * (1.0f / 3.0f + s2 * (0.2f + s2 * (1.0f / 7.0f + s2 * (1.0f / 9.0f)))));
+    return static_cast<float>(e) + ln * 1.44269504f;
+}
+
+// tanh as GL implementations commonly expand it, (e^2x - 1) / (e^2x + 1), saturating
+// where float tanh is already +-1
+inline float tanhPoly(float x) {
+    x = std::min(std::max(x, -10.0f), 10.0f);
+    const float e = exp2Poly(2.0f * 1.44269504f * x);
+    return (e - 1.0f) / (e + 1.0f);
+}
+
+} // namespace
+
+const char* colormapName(Colormap map) {
+    switch (map) {
+        case Colormap::ENERGY: return "energy";
+        case Colormap::RAINBOW: return "rainbow";
+        case Colormap::GRAYSCALE: return "grayscale";
+        case Colormap::CYAN_YELLOW: return "cyan-yellow";
+        default: return "unknown";
+    }
+}
+
+bool parseColormap(const std::string& name, Colormap& map) {
+    for (int m = 0; m < static_cast<int>(Colormap::COUNT); m++) {
+        if (name == colormapName(static_cast<Colormap>(m))) {
+            map = static_cast<Colormap>(m);
+            return true;
+        }
+    }
+    return false;
+}
+
+void colormapRow(const float* u, const uint8_t* walls, int count, const ColormapOptions& options, uint8_t* rgb) {
+    // One pass per stage over planar rows, so every loop but the last vectorizes: the
+    // contrast curve, the mode's color channels, the 8-bit conversion, then interleaving.
+    // The color passes are branch-free; GCC if-converts their selects only with
+    // -fno-trapping-math, which CMakeLists.txt sets for this file.
+    thread_local std::vector<float> scratch;
+    thread_local std::vector<uint8_t> bytes;
+    scratch.resize(size_t(4) * count);
+    bytes.resize(size_t(3) * count);
+    float* __restrict h = scratch.data();
+    float* __restrict r = h + count;
+    float* __restrict g = r + count;
+    float* __restrict b = g + count;
+
+    const Colormap map = options.map;
+    if (map == Colormap::ENERGY) {
+        for (int i = 0; i < count; i++) h[i] = u[i] * u[i];
+    } else {
+        const float contrast = options.contrast;
+        for (int i = 0; i < count; i++) h[i] = tanhPoly(u[i] * contrast) * 0.9f;
+    }
+
+    switch (map) {
+        case Colormap::ENERGY:
+            for (int i = 0; i < count; i++) {
+                const float energy = h[i];
+                const float t = clamp01(energy * 2.0f);
+                // Dark red to orange below t = 0.5, yellow to blue above
+                const float lo = t * 2.0f, hi = (t - 0.5f) * 2.0f;
+                const bool low = t < 0.5f;
+                const float cr = low ? mix(0.3f, 1.0f, lo) : mix(1.0f, 0.0f, hi);
+                const float cg = low ? mix(0.0f, 0.3f, lo) : mix(0.8f, 0.5f, hi);
+                const float cb = low ? mix(0.0f, 0.0f, lo) : mix(0.0f, 1.0f, hi);
+                // Darken low energy areas
+                const bool dark = energy < 0.05f;
+                const float w = energy * 20.0f;
+                r[i] = dark ? mix(0.05f, cr, w) : cr;
+                g[i] = dark ? mix(0.05f, cg, w) : cg;
+                b[i] = dark ? mix(0.1f, cb, w) : cb;
+            }
+            break;
+        case Colormap::RAINBOW:
+            for (int i = 0; i < count; i++) {
+                // hsv2rgb(vec3(0.65 - h * 0.5, 0.85, 0.4 + abs(h) * 0.6)); hue + k > 0 since
+                // |h| < 0.9, so truncation is the floor() in fract()
+                const float hue = 0.65f - h[i] * 0.5f;
+                const float sat = 0.85f;
+                const float val = 0.4f + std::fabs(h[i]) * 0.6f;
+                const float xr = hue + 1.0f, xg = hue + 2.0f / 3.0f, xb = hue + 1.0f / 3.0f;
+                const float pr = std::fabs((xr - static_cast<float>(static_cast<int>(xr))) * 6.0f - 3.0f);
+                const float pg = std::fabs((xg - static_cast<float>(static_cast<int>(xg))) * 6.0f - 3.0f);
+                const float pb = std::fabs((xb - static_cast<float>(static_cast<int>(xb))) * 6.0f - 3.0f);
+                r[i] = val * mix(1.0f, clamp01(pr - 1.0f), sat);
+                g[i] = val * mix(1.0f, clamp01(pg - 1.0f), sat);
+                b[i] = val * mix(1.0f, clamp01(pb - 1.0f), sat);
+            }
+            break;
+        case Colormap::GRAYSCALE:
+            for (int i = 0; i < count; i++) r[i] = g[i] = b[i] = 0.3f + h[i] * 0.7f;
+            break;
+        default:
+            for (int i = 0; i < count; i++) {
+                // Cyan-yellow: toward yellow above 0.05, toward deep blue below -0.05
+                const bool up = h[i] > 0.05f, down = h[i] < -0.05f;
+                const float t = exp2Poly(0.8f * log2Poly(clamp01(std::fabs(h[i]) * 1.8f)));
+                r[i] = up ? mix(0.1f, 1.0f, t) : down ? mix(0.1f, 0.0f, t) : 0.05f;
+                g[i] = up ? mix(0.4f, 0.95f, t) : down ? mix(0.4f, 0.15f, t) : 0.3f;
+                b[i] = up ? mix(0.6f, 0.2f, t) : down ? mix(0.6f, 0.3f, t) : 0.5f;
+            }
+            break;
+    }
+
+    uint8_t* __restrict q = bytes.data();
+    for (int i = 0; i < 3 * count; i++) q[i] = unorm8(r[i]);
+
+    // Stride-3 byte stores do not vectorize without shuffles, but this is a small share
+    const uint8_t gray = unorm8(WALL_GRAY);
+    for (int i = 0; i < count; i++) {
+        const bool wall = walls && walls[i];
+        rgb[3 * i] = wall ? gray : q[i];
+        rgb[3 * i + 1] = wall ? gray : q[count + i];
+        rgb[3 * i + 2] = wall ? gray : q[2 * count + i];
+    }
+}
+
+void renderColormap(const float* u, const uint8_t* walls, int size, const ColormapOptions& options, uint8_t* rgb,
+                    ThreadPool* pool) {
+    auto rows = [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            const size_t row = size_t(y) * size;
+            colormapRow(u + row, walls ? walls + row : nullptr, size, options, rgb + 3 * row);
+        }
+    };
+    if (pool) pool->parallelFor(0, size, rows);
+    else rows(0, size);
+}
+
+void renderColormap(const Simulation& sim, const ColormapOptions& options, std::vector<uint8_t>& rgb,
+                    ThreadPool* pool) {
+    const int n = sim.size;
+    rgb.resize(size_t(n) * n * 3);
+    if (sim.layout == FieldLayout::ROW_MAJOR) {
+        // Rows are contiguous in place
+        auto rows = [&](int y0, int y1) {
+            for (int y = y0; y < y1; y++) {
+                const size_t row = size_t(y) * sim.pitch;
+                colormapRow(sim.u.data() + row, sim.walls.data() + row, n, options, rgb.data() + size_t(y) * n * 3);
+            }
+        };
+        if (pool) pool->parallelFor(0, n, rows);
+        else rows(0, n);
+        return;
+    }
+    std::vector<float> u(size_t(n) * n);
+    std::vector<uint8_t> walls(size_t(n) * n);
+    packRowMajor(sim, sim.u, u.data());
+    packRowMajor(sim, sim.walls, walls.data());
+    renderColormap(u.data(), walls.data(), n, options, rgb.data(), pool);
+}
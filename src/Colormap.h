@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// CPU port of the wave fragment shader (initOpenGL in WaveSim.cpp) for rendering images
+// without a GL context. Each cell is colored with the shader's float math at grid
+// resolution, where the GPU's linear filtering samples exact texel values, and converted
+// to 8 bits the way GL converts to a unorm target. Drivers approximate tanh and pow
+// slightly differently, so a channel can differ from a GPU capture by one step.
+
+// The shader's colorMode values (AppState::ColorMode in the app)
+enum class Colormap { ENERGY, RAINBOW, GRAYSCALE, CYAN_YELLOW, COUNT };
+
+const char* colormapName(Colormap map);
+// Accepts the names above ("energy", "rainbow", "grayscale", "cyan-yellow")
+bool parseColormap(const std::string& name, Colormap& map);
+
+struct ColormapOptions {
+    Colormap map = Colormap::RAINBOW;
+    float contrast = 1.5f;          // the shader's uContrast
+};
+
+// Colors `count` cells as RGB triples; walls (nonzero) get the shader's wall gray.
+void colormapRow(const float* u, const uint8_t* walls, int count, const ColormapOptions& options, uint8_t* rgb);
+
+// Renders a dense row-major size x size field. Rows come out in grid order, y = 0 first,
+// which is the bottom of the screen: store the result as a bottom-up Image.
+void renderColormap(const float* u, const uint8_t* walls, int size, const ColormapOptions& options, uint8_t* rgb,
+                    ThreadPool* pool = nullptr);
+// Same for a simulation in either layout; `rgb` is resized to size * size * 3.
+void renderColormap(const Simulation& sim, const ColormapOptions& options, std::vector<uint8_t>& rgb,
+                    ThreadPool* pool = nullptr);
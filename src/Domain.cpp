@@ -0,0 +1,210 @@
+#include "Domain.h"
+
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+
+namespace {
+
+// Cells [begin, end) of `count` split into `parts` near-equal blocks
+int blockStart(int count, int parts, int block) {
+    return static_cast<int>(int64_t(count) * block / parts);
+}
+
+StencilView view(Subdomain& sub) {
+    StencilView v;
+    v.u = sub.u.data();
+    v.u_prev = sub.u_prev.data();
+    v.u_prev2 = sub.u_prev2.data();
+    v.walls = sub.walls.data();
+    v.pitch = sub.pitch;
+    return v;
+}
+
+// Edge of the owned block next to `side`, as (start index, stride, count) into a field
+void edge(const Subdomain& sub, HaloSide side, bool halo, size_t& start, size_t& stride, int& count) {
+    switch (side) {
+        case HaloSide::NORTH:
+            start = sub.index(1, halo ? 0 : 1);
+            stride = 1;
+            count = sub.width;
+            break;
+        case HaloSide::SOUTH:
+            start = sub.index(1, halo ? sub.height + 1 : sub.height);
+            stride = 1;
+            count = sub.width;
+            break;
+        case HaloSide::WEST:
+            start = sub.index(halo ? 0 : 1, 1);
+            stride = sub.pitch;
+            count = sub.height;
+            break;
+        default:
+            start = sub.index(halo ? sub.width + 1 : sub.width, 1);
+            stride = sub.pitch;
+            count = sub.height;
+            break;
+    }
+}
+
+} // namespace
+
+void DomainDecomposition::bounds(int rank, int& x0, int& x1, int& y0, int& y1) const {
+    const int bx = rank % ranksX;
+    const int by = rank / ranksX;
+    x0 = blockStart(size, ranksX, bx);
+    x1 = blockStart(size, ranksX, bx + 1);
+    y0 = blockStart(size, ranksY, by);
+    y1 = blockStart(size, ranksY, by + 1);
+}
+
+int DomainDecomposition::neighbour(int rank, HaloSide side) const {
+    const int bx = rank % ranksX;
+    const int by = rank / ranksX;
+    switch (side) {
+        case HaloSide::NORTH: return by > 0 ? rank - ranksX : -1;
+        case HaloSide::SOUTH: return by < ranksY - 1 ? rank + ranksX : -1;
+        case HaloSide::WEST: return bx > 0 ? rank - 1 : -1;
+        case HaloSide::EAST: return bx < ranksX - 1 ? rank + 1 : -1;
+        default: return -1;
+    }
+}
+
+size_t DomainDecomposition::maxHalo() const {
+    // Blocks differ by at most one cell; the first is never the smaller one
+    return size_t(std::max(blockStart(size, ranksX, 1), blockStart(size, ranksY, 1))) + 1;
+}
+
+bool decomposeDomain(int size, int ranks, DomainDecomposition& domain, std::string& error) {
+    if (ranks < 1) {
+        error = "need at least one rank";
+        return false;
+    }
+    int ranksX = 1;
+    for (int x = 1; x * x <= ranks; x++) {
+        if (ranks % x == 0) ranksX = x;
+    }
+    domain.size = size;
+    domain.ranksX = ranksX;
+    domain.ranksY = ranks / ranksX;
+    if (size / domain.ranksY < 3) {
+        error = std::to_string(ranks) + " ranks split a " + std::to_string(size) + "^2 grid into blocks under 3 cells";
+        return false;
+    }
+    return true;
+}
+
+void extractSubdomain(const Simulation& global, const DomainDecomposition& domain, int rank, Subdomain& sub) {
+    sub.domain = domain;
+    sub.rank = rank;
+    domain.bounds(rank, sub.x0, sub.x1, sub.y0, sub.y1);
+    sub.width = sub.x1 - sub.x0;
+    sub.height = sub.y1 - sub.y0;
+    sub.pitch = fieldPitch(sub.width + 2);
+
+    const size_t cells = size_t(sub.pitch) * (sub.height + 2);
+    sub.u.assign(cells, 0.0f);
+    sub.u_prev.assign(cells, 0.0f);
+    sub.u_prev2.assign(cells, 0.0f);
+    sub.walls.assign(cells, 0);
+    for (int y = sub.y0; y < sub.y1; y++) {
+        for (int x = sub.x0; x < sub.x1; x++) {
+            const size_t g = global.index(x, y);
+            const size_t l = sub.index(x - sub.x0 + 1, y - sub.y0 + 1);
+            sub.u[l] = global.u[g];
+            sub.u_prev[l] = global.u_prev[g];
+            sub.u_prev2[l] = global.u_prev2[g];
+            sub.walls[l] = global.walls[g];
+        }
+    }
+
+    sub.sources = global.sources;
+    sub.time = global.time;
+    sub.waveSpeed = global.waveSpeed;
+    sub.damping = global.damping;
+    sub.wallReflectivity = global.wallReflectivity;
+    sub.step = 0;
+    sub.haloWaitSeconds = 0.0;
+    sub.haloBuffer.assign(domain.maxHalo(), 0.0f);
+}
+
+void storeSubdomain(const Subdomain& sub, float* field) {
+    for (int y = sub.y0; y < sub.y1; y++) {
+        for (int x = sub.x0; x < sub.x1; x++) {
+            field[size_t(y) * sub.domain.size + x] = sub.u[sub.index(x - sub.x0 + 1, y - sub.y0 + 1)];
+        }
+    }
+}
+
+void stepSubdomain(Subdomain& sub, HaloTransport& transport, float dt, int steps, ThreadPool* pool) {
+    using Clock = std::chrono::steady_clock;
+    const float c2_dt2 = sub.waveSpeed * sub.waveSpeed * dt * dt;
+    const int size = sub.domain.size;
+
+    // Cells to update, in local coordinates: the owned block minus the global border
+    const int ux0 = std::max(sub.x0, 1) - sub.x0 + 1;
+    const int ux1 = std::min(sub.x1, size - 1) - sub.x0 + 1;
+    const int uy0 = std::max(sub.y0, 1) - sub.y0 + 1;
+    const int uy1 = std::min(sub.y1, size - 1) - sub.y0 + 1;
+    // The part of it whose neighbours are all owned
+    const int ix0 = std::max(ux0, 2), ix1 = std::min(ux1, sub.width);
+    const int iy0 = std::max(uy0, 2), iy1 = std::min(uy1, sub.height);
+
+    int peers[4];
+    for (int s = 0; s < 4; s++) peers[s] = sub.domain.neighbour(sub.rank, static_cast<HaloSide>(s));
+
+    for (int s = 0; s < steps; ++s) {
+        sub.time += dt;
+        sub.step++;
+        std::swap(sub.u_prev2, sub.u_prev);
+        std::swap(sub.u_prev, sub.u);
+        const StencilView v = view(sub);
+
+        // Post this rank's edges of u_prev; each lands in the neighbour's opposite halo
+        for (int side = 0; side < 4; side++) {
+            if (peers[side] < 0) continue;
+            size_t start, stride;
+            int count;
+            edge(sub, static_cast<HaloSide>(side), false, start, stride, count);
+            for (int i = 0; i < count; i++) sub.haloBuffer[i] = sub.u_prev[start + i * stride];
+            transport.send(peers[side], oppositeSide(static_cast<HaloSide>(side)), sub.haloBuffer.data(), count,
+                           sub.step);
+        }
+
+        // Interior while the halos travel
+        auto rows = [&](int y0, int y1) {
+            updateStencilRect(v, c2_dt2, sub.damping, sub.wallReflectivity, y0, y1, ix0, ix1);
+        };
+        if (iy1 > iy0) {
+            if (pool) {
+                pool->parallelFor(iy0, iy1, rows);
+            } else {
+                rows(iy0, iy1);
+            }
+        }
+
+        const auto waitStart = Clock::now();
+        for (int side = 0; side < 4; side++) {
+            if (peers[side] < 0) continue;
+            size_t start, stride;
+            int count;
+            edge(sub, static_cast<HaloSide>(side), true, start, stride, count);
+            transport.receive(peers[side], static_cast<HaloSide>(side), sub.haloBuffer.data(), count, sub.step);
+            for (int i = 0; i < count; i++) sub.u_prev[start + i * stride] = sub.haloBuffer[i];
+        }
+        sub.haloWaitSeconds += std::chrono::duration<double>(Clock::now() - waitStart).count();
+
+        // The one-cell ring that reads the halo
+        auto rect = [&](int y0, int y1, int x0, int x1) {
+            if (y1 > y0) updateStencilRect(v, c2_dt2, sub.damping, sub.wallReflectivity, y0, y1, x0, x1);
+        };
+        if (uy0 == 1) rect(1, 2, ux0, ux1);
+        if (uy1 == sub.height + 1 && sub.height > 1) rect(sub.height, sub.height + 1, ux0, ux1);
+        if (ux0 == 1) rect(iy0, iy1, 1, 2);
+        if (ux1 == sub.width + 1 && sub.width > 1) rect(iy0, iy1, sub.width, sub.width + 1);
+
+        injectSourcesRect(sub.u.data(), sub.walls.data(), sub.pitch, sub.x0 - 1, sub.y0 - 1, sub.x0, sub.x1, sub.y0,
+                          sub.y1, size, sub.sources, sub.time);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "HaloTransport.h"
+#include "Simulation.h"
+
+#include <vector>
+
+class ThreadPool;
+
+// Domain decomposition for grids too large for one process: the global grid is split into
+// a ranksX x ranksY array of blocks, each owned by one rank (a process, typically pinned
+// to one NUMA node). A rank stores its block plus a one-cell halo ring and exchanges the
+// ring with its four neighbours every step through a HaloTransport. Results are
+// bit-identical to stepping the whole grid with the SIMD kernel.
+
+struct DomainDecomposition {
+    int size = 0;       // global grid is size x size cells
+    int ranksX = 1;
+    int ranksY = 1;
+
+    int ranks() const { return ranksX * ranksY; }
+    // Owned global cells [x0, x1) x [y0, y1) of `rank`; ranks are numbered row by row
+    void bounds(int rank, int& x0, int& x1, int& y0, int& y1) const;
+    // Rank across `side` (NORTH = lower y, WEST = lower x), or -1 at the grid edge
+    int neighbour(int rank, HaloSide side) const;
+    // Longest halo any rank sends, in cells
+    size_t maxHalo() const;
+};
+
+// Picks the most square ranksX x ranksY factorization of `ranks`. Returns false with
+// `error` set when blocks would be narrower than 3 cells.
+bool decomposeDomain(int size, int ranks, DomainDecomposition& domain, std::string& error);
+
+struct Subdomain {
+    DomainDecomposition domain;
+    int rank = 0;
+    int x0 = 0, x1 = 0, y0 = 0, y1 = 0;   // owned global cells
+    int width = 0, height = 0;            // owned cells per row / column
+    // Local storage is (width + 2) x (height + 2) with pitch `pitch`:
+    // local (lx, ly) holds global (x0 - 1 + lx, y0 - 1 + ly)
+    int pitch = 0;
+    FieldVector<float> u;
+    FieldVector<float> u_prev;
+    FieldVector<float> u_prev2;
+    FieldVector<uint8_t> walls;
+    SourceStore sources;                  // global coordinates, every source of the scene
+
+    float time = 0.0f;
+    float waveSpeed = 6.0f;
+    float damping = 0.9995f;
+    float wallReflectivity = 1.0f;
+
+    uint64_t step = 0;
+    double haloWaitSeconds = 0.0;         // time spent blocked on neighbours' halos
+    std::vector<float> haloBuffer;
+
+    size_t index(int lx, int ly) const { return size_t(ly) * pitch + lx; }
+};
+
+// Copies `rank`'s block of `global` (fields, walls, sources, physics) into `sub`.
+void extractSubdomain(const Simulation& global, const DomainDecomposition& domain, int rank, Subdomain& sub);
+// Writes the owned cells of u into a dense row-major size x size field.
+void storeSubdomain(const Subdomain& sub, float* field);
+
+// Advances the rank by `steps` substeps of length dt. Each step posts this rank's edges,
+// updates the cells that need no halo while they travel, then waits for the neighbours'
+// edges and finishes the one-cell ring. Every rank must call this with the same steps.
+void stepSubdomain(Subdomain& sub, HaloTransport& transport, float dt, int steps, ThreadPool* pool = nullptr);
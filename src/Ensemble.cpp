@@ -0,0 +1,623 @@
+#include "Ensemble.h"
+
+#include "EnsembleLanes.h"
+#include "ImageWriter.h"
+#include "Npy.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace {
+
+struct Setting {
+    std::string key;
+    std::vector<std::string> values;
+};
+
+std::string formatNumber(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%g", v);
+    return buf;
+}
+
+bool parseNumber(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return end && end != text.c_str() && *end == '\0';
+}
+
+// Splits a directive into key=value settings; quoted values are taken literally.
+bool tokenize(const std::string& line, std::vector<Setting>& settings, std::string& error) {
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) i++;
+        if (i >= line.size() || line[i] == '#') break;
+
+        const size_t eq = line.find('=', i);
+        if (eq == std::string::npos) {
+            error = "expected key=value near '" + line.substr(i) + "'";
+            return false;
+        }
+        Setting s;
+        s.key = line.substr(i, eq - i);
+        i = eq + 1;
+        if (i < line.size() && line[i] == '"') {
+            const size_t close = line.find('"', i + 1);
+            if (close == std::string::npos) {
+                error = "unterminated quote for " + s.key;
+                return false;
+            }
+            s.values.push_back(line.substr(i + 1, close - i - 1));
+            i = close + 1;
+        } else {
+            size_t end = i;
+            while (end < line.size() && !std::isspace(static_cast<unsigned char>(line[end]))) end++;
+            const std::string raw = line.substr(i, end - i);
+            i = end;
+
+            std::vector<std::string> parts;
+            std::stringstream ss(raw);
+            std::string part;
+            while (std::getline(ss, part, ',')) parts.push_back(part);
+
+            for (const auto& p : parts) {
+                // start:stop:step expands to an inclusive range
+                double a, b, step;
+                const size_t c1 = p.find(':');
+                const size_t c2 = c1 == std::string::npos ? c1 : p.find(':', c1 + 1);
+                if (c2 != std::string::npos && parseNumber(p.substr(0, c1), a) &&
+                    parseNumber(p.substr(c1 + 1, c2 - c1 - 1), b) && parseNumber(p.substr(c2 + 1), step) && step > 0) {
+                    const int count = static_cast<int>(std::floor((b - a) / step + 1e-6)) + 1;
+                    for (int k = 0; k < count; k++) s.values.push_back(formatNumber(a + k * step));
+                } else {
+                    s.values.push_back(p);
+                }
+            }
+        }
+        if (s.values.empty()) {
+            error = "no value for " + s.key;
+            return false;
+        }
+        settings.push_back(s);
+    }
+    return true;
+}
+
+bool applySetting(EnsembleMember& m, const std::string& key, const std::string& value, std::string& error) {
+    if (key == "name") {
+        m.name = value;
+        return true;
+    }
+    if (key == "preset") {
+        SceneSpec scene;
+        if (!findScene(value, scene, error)) return false;
+        m.preset = value;
+        return true;
+    }
+    if (key == "from") {
+        if (!std::ifstream(value)) {
+            error = "cannot open snapshot '" + value + "'";
+            return false;
+        }
+        m.from = value;
+        return true;
+    }
+    if (key == "fields") {
+        m.fields.clear();
+        std::stringstream ss(value);
+        std::string field;
+        while (std::getline(ss, field, '+')) {
+            if (field != "u" && field != "walls") {
+                error = "unknown field '" + field + "' (expected u or walls)";
+                return false;
+            }
+            m.fields.push_back(field);
+        }
+        return true;
+    }
+    if (key == "colormap") {
+        if (!parseColormap(value, m.image.map)) {
+            error = "unknown colormap '" + value + "'";
+            return false;
+        }
+        return true;
+    }
+    if (key == "imageFormat") {
+        if (value != "png" && value != "ppm") {
+            error = "unknown image format '" + value + "' (expected png or ppm)";
+            return false;
+        }
+        m.imageFormat = value;
+        return true;
+    }
+
+    double v;
+    if (!parseNumber(value, v)) {
+        error = "expected a number for " + key + ", got '" + value + "'";
+        return false;
+    }
+    const float f = static_cast<float>(v);
+    if (key == "size") m.gridSize = static_cast<int>(v);
+    else if (key == "duration") m.duration = f;
+    else if (key == "settle") m.settle = f;
+    else if (key == "dt") m.dt = f;
+    else if (key == "frames") m.frames = f;
+    else if (key == "contrast") m.image.contrast = f;
+    else if (key == "frequency") { m.frequency = f; m.hasFrequency = true; }
+    else if (key == "amplitude") { m.amplitude = f; m.hasAmplitude = true; }
+    else if (key == "waveSpeed") { m.waveSpeed = f; m.hasWaveSpeed = true; }
+    else if (key == "damping") { m.damping = f; m.hasDamping = true; }
+    else if (key == "reflectivity") { m.reflectivity = f; m.hasReflectivity = true; }
+    else if (key == "slitCount" || key == "slitSpacing" || key == "slitWidth" || key == "slitSeparation") m.geometry.set(key, f);
+    else {
+        error = "unknown key '" + key + "'";
+        return false;
+    }
+    if (m.gridSize < 16 || m.dt <= 0.0f || m.duration < 0.0f || m.frames < 0.0f) {
+        error = "invalid " + key + " " + value;
+        return false;
+    }
+    return true;
+}
+
+std::string sanitize(std::string s) {
+    for (char& c : s) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_' && c != '=') c = '-';
+    }
+    return s;
+}
+
+double fieldEnergy(const Simulation& sim, double& linf) {
+    double energy = 0.0;
+    linf = 0.0;
+    for (int y = 0; y < sim.size; y++) {
+        for (int x = 0; x < sim.size; x++) {
+            const double v = sim.u[sim.index(x, y)];
+            energy += v * v;
+            linf = std::max(linf, std::fabs(v));
+        }
+    }
+    return energy;
+}
+
+// fieldEnergy() of one lane, summed in the same order
+double laneEnergy(const LaneEnsemble& e, int lane, double& linf) {
+    double energy = 0.0;
+    linf = 0.0;
+    for (size_t cell = 0; cell < size_t(e.size) * e.size; cell++) {
+        const double v = e.u[cell * ENSEMBLE_LANES + lane];
+        energy += v * v;
+        linf = std::max(linf, std::fabs(v));
+    }
+    return energy;
+}
+
+bool setupMember(const EnsembleMember& member, Simulation& sim, std::string& error) {
+    if (member.from.empty()) {
+        SceneSpec scene;
+        if (!findScene(member.preset, scene, error) ||
+            !loadScene(sim, scene, member.geometry, SceneOptions(), nullptr, error)) {
+            return false;
+        }
+    } else {
+        SnapshotInfo info;
+        if (!loadSnapshot(member.from, sim, info, error)) return false;
+    }
+    for (size_t i = 0; i < sim.sources.size(); i++) {
+        if (member.hasFrequency) sim.sources.setFrequency(i, member.frequency);
+        if (member.hasAmplitude) sim.sources.setAmplitude(i, member.amplitude);
+    }
+    if (member.hasWaveSpeed) sim.waveSpeed = member.waveSpeed;
+    if (member.hasDamping) sim.damping = member.damping;
+    if (member.hasReflectivity) sim.wallReflectivity = member.reflectivity;
+    return true;
+}
+
+int totalSteps(const EnsembleMember& member) {
+    return static_cast<int>(std::ceil(member.duration / member.dt - 1e-6));
+}
+
+// Steps per stop-condition check: one simulated second
+int chunkSteps(const EnsembleMember& member) {
+    return std::max(1, static_cast<int>(std::lround(1.0 / member.dt)));
+}
+
+// Applies the stop conditions after a chunk; returns true when the member is finished.
+bool checkStop(const EnsembleMember& member, EnsembleResult& r, double& previous) {
+    if (!std::isfinite(r.energy)) {
+        r.status = "diverged";
+        return true;
+    }
+    if (member.settle > 0.0f && previous >= 0.0 &&
+        std::fabs(r.energy - previous) <= member.settle * std::max(previous, 1e-30)) {
+        r.status = "settled";
+        return true;
+    }
+    previous = r.energy;
+    return false;
+}
+
+// Steps between rendered images (0: none)
+int frameSteps(const EnsembleMember& member) {
+    return member.frames > 0.0f ? std::max(1, static_cast<int>(std::lround(member.frames / member.dt))) : 0;
+}
+
+bool writeFrame(const EnsembleMember& member, const Simulation& sim, int step, const std::string& outputDir,
+                std::string& error) {
+    const std::string directory = outputDir + "/" + member.name;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    char name[32];
+    std::snprintf(name, sizeof(name), "/frame_%06d.", step / frameSteps(member));
+    Image image;
+    image.path = directory + name + member.imageFormat;
+    image.width = image.height = sim.size;
+    image.channels = 3;
+    image.bottomUp = true;
+    renderColormap(sim, member.image, image.pixels);
+    if (!writeImage(image)) {
+        error = "failed to write " + image.path;
+        return false;
+    }
+    return true;
+}
+
+// Steps from `step` to `step + count`, stopping at every image on the way
+bool stepMember(const EnsembleMember& member, Simulation& sim, int step, int count, const SolverOptions& options,
+                const std::string& outputDir, std::string& error) {
+    const int every = frameSteps(member);
+    if (every == 0) {
+        stepSimulation(sim, member.dt, count, options);
+        return true;
+    }
+    while (count > 0) {
+        const int n = std::min(count, every - step % every);
+        stepSimulation(sim, member.dt, n, options);
+        step += n;
+        count -= n;
+        if (step % every == 0 && !writeFrame(member, sim, step, outputDir, error)) return false;
+    }
+    return true;
+}
+
+void writeFields(const EnsembleMember& member, const Simulation& sim, const std::string& outputDir, EnsembleResult& r) {
+    for (const auto& field : member.fields) {
+        const std::string path = outputDir + "/" + member.name + "." + field + ".npy";
+        const std::vector<size_t> shape = { size_t(sim.size), size_t(sim.size) };
+        bool ok;
+        if (field == "u") {
+            std::vector<float> dense(size_t(sim.size) * sim.size);
+            packRowMajor(sim, sim.u, dense.data());
+            ok = writeNpy(path, dense.data(), shape);
+        } else {
+            std::vector<uint8_t> dense(size_t(sim.size) * sim.size);
+            packRowMajor(sim, sim.walls, dense.data());
+            ok = writeNpy(path, dense.data(), shape);
+        }
+        if (!ok) {
+            r.status = "error";
+            r.error = "failed to write " + path;
+        }
+    }
+}
+
+} // namespace
+
+bool parseEnsembleSpec(std::istream& in, std::vector<EnsembleMember>& members, std::string& error) {
+    std::vector<Setting> defaults;
+    std::set<std::string> usedNames;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::istringstream is(line);
+        std::string directive;
+        if (!(is >> directive) || directive[0] == '#') continue;
+
+        std::vector<Setting> settings;
+        std::string rest;
+        std::getline(is, rest);
+        if (!tokenize(rest, settings, error)) {
+            error = "line " + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+
+        if (directive == "defaults") {
+            for (const auto& s : settings) {
+                auto it = std::find_if(defaults.begin(), defaults.end(), [&](const Setting& d) { return d.key == s.key; });
+                if (it != defaults.end()) *it = s;
+                else defaults.push_back(s);
+            }
+            continue;
+        }
+        if (directive != "sweep" && directive != "run") {
+            error = "line " + std::to_string(lineNumber) + ": unknown directive '" + directive + "'";
+            return false;
+        }
+
+        // Line settings override defaults
+        std::vector<Setting> merged = defaults;
+        for (const auto& s : settings) {
+            auto it = std::find_if(merged.begin(), merged.end(), [&](const Setting& d) { return d.key == s.key; });
+            if (it != merged.end()) *it = s;
+            else merged.push_back(s);
+        }
+
+        // Cartesian product as a mixed-radix counter
+        std::vector<size_t> digit(merged.size(), 0);
+        while (true) {
+            EnsembleMember m;
+            std::string suffix;
+            for (size_t k = 0; k < merged.size(); k++) {
+                const std::string& key = merged[k].key;
+                const std::string& value = merged[k].values[digit[k]];
+                if (!applySetting(m, key, value, error)) {
+                    error = "line " + std::to_string(lineNumber) + ": " + error;
+                    return false;
+                }
+                if (key == "name") continue;
+                m.params.push_back({ key, value });
+                if (merged[k].values.size() > 1) suffix += "_" + key + "=" + value;
+            }
+            // Preset names have no extension; scene files and snapshots go by their stem
+            const std::string base = !m.name.empty() ? m.name
+                                     : std::filesystem::path(m.from.empty() ? m.preset : m.from).stem().string();
+            std::string name = sanitize(base + suffix);
+            std::string unique = name;
+            for (int n = 2; usedNames.count(unique); n++) unique = name + "_" + std::to_string(n);
+            usedNames.insert(unique);
+            m.name = unique;
+            members.push_back(m);
+
+            size_t k = 0;
+            for (; k < merged.size(); k++) {
+                if (++digit[k] < merged[k].values.size()) break;
+                digit[k] = 0;
+            }
+            if (k == merged.size()) break;
+        }
+    }
+    return true;
+}
+
+bool readEnsembleSpec(const std::string& path, std::vector<EnsembleMember>& members, std::string& error) {
+    std::ifstream f(path);
+    if (!f) {
+        error = "cannot open " + path;
+        return false;
+    }
+    return parseEnsembleSpec(f, members, error);
+}
+
+EnsembleResult runEnsembleMember(const EnsembleMember& member, const std::string& outputDir, KernelVariant variant,
+                                 const EnsembleCheckpoints& checkpoints) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    EnsembleResult r;
+    r.name = member.name;
+    r.status = "done";
+
+    Simulation sim(member.gridSize);
+    double previous = -1.0;
+    bool finished = false;
+    const std::string checkpoint =
+        checkpoints.directory.empty() ? std::string() : checkpoints.directory + "/" + member.name + ".wsnap";
+    if (!checkpoint.empty() && std::filesystem::exists(checkpoint)) {
+        SnapshotInfo info;
+        if (!loadSnapshot(checkpoint, sim, info, r.error) || info.owner != member.name) {
+            r.status = "error";
+            if (r.error.empty()) r.error = checkpoint + " belongs to " + info.owner;
+            return r;
+        }
+        r.steps = static_cast<int>(info.steps);
+        previous = info.stopReference;
+        if (!info.status.empty()) {
+            r.status = info.status;
+            finished = true;
+        }
+        r.energy = fieldEnergy(sim, r.linf);
+    } else if (!setupMember(member, sim, r.error)) {
+        r.status = "error";
+        return r;
+    }
+
+    SolverOptions options;
+    options.variant = variant;
+    if (r.steps == 0 && frameSteps(member) > 0 && !writeFrame(member, sim, 0, outputDir, r.error)) {
+        r.status = "error";
+        return r;
+    }
+
+    // Step in chunks so the stop conditions are checked regularly
+    const int steps = totalSteps(member);
+    const int chunk = chunkSteps(member);
+    SnapshotWriter writer;
+    SnapshotOptions snapshotOptions;
+    snapshotOptions.compress = checkpoints.compress;
+    auto lastCheckpoint = Clock::now();
+    while (!finished && r.steps < steps) {
+        const int n = std::min(chunk, steps - r.steps);
+        bool ok;
+        if (writer.busy()) {
+            // The writer copies the fields while the first step runs
+            ok = stepMember(member, sim, r.steps, 1, options, outputDir, r.error);
+            writer.settle();
+            ok = ok && stepMember(member, sim, r.steps + 1, n - 1, options, outputDir, r.error);
+        } else {
+            ok = stepMember(member, sim, r.steps, n, options, outputDir, r.error);
+        }
+        r.steps += n;
+        if (!ok) {
+            r.status = "error";
+            break;
+        }
+
+        r.energy = fieldEnergy(sim, r.linf);
+        if (checkStop(member, r, previous)) break;
+
+        if (!checkpoint.empty() && std::chrono::duration<double>(Clock::now() - lastCheckpoint).count() >= checkpoints.interval &&
+            !writer.busy()) {
+            std::string error;
+            if (!writer.finish(error)) r.error = "checkpoint: " + error;
+            SnapshotInfo info;
+            info.steps = r.steps;
+            info.stopReference = previous;
+            info.owner = member.name;
+            writer.begin(checkpoint, sim, info, snapshotOptions);
+            lastCheckpoint = Clock::now();
+        }
+    }
+    r.simTime = sim.time;
+    writeFields(member, sim, outputDir, r);
+
+    if (!checkpoint.empty()) {
+        std::string error;
+        SnapshotInfo info;
+        info.steps = r.steps;
+        info.stopReference = previous;
+        info.owner = member.name;
+        info.status = r.status;
+        if (!writer.finish(error) || !saveSnapshot(checkpoint, sim, info, snapshotOptions, error)) {
+            r.error = "checkpoint: " + error;
+        }
+    }
+
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return r;
+}
+
+std::vector<std::vector<size_t>> groupEnsembleLanes(const std::vector<EnsembleMember>& members,
+                                                    const std::function<bool(const EnsembleMember&)>& useLanes) {
+    auto sameScene = [](const EnsembleMember& a, const EnsembleMember& b) {
+        return a.frames == 0.0f && b.frames == 0.0f && a.preset == b.preset && a.from == b.from && a.gridSize == b.gridSize && a.dt == b.dt && a.duration == b.duration &&
+               a.geometry.variables == b.geometry.variables;
+    };
+
+    std::vector<std::vector<size_t>> groups;
+    std::vector<bool> grouped(members.size(), false);
+    for (size_t i = 0; i < members.size(); i++) {
+        if (grouped[i]) continue;
+        std::vector<size_t> group = { i };
+        grouped[i] = true;
+        for (size_t j = i + 1; j < members.size() && group.size() < size_t(ENSEMBLE_LANES); j++) {
+            if (!grouped[j] && sameScene(members[i], members[j])) group.push_back(j);
+        }
+        if (group.size() > 1 && !useLanes(members[i])) group.resize(1);
+        for (size_t j : group) grouped[j] = true;
+        groups.push_back(group);
+    }
+    return groups;
+}
+
+bool ensembleLanesPayOff(const EnsembleMember& member) {
+    Simulation sim(member.gridSize);
+    std::string error;
+    return setupMember(member, sim, error) && lanesOutperformSingle(sim);
+}
+
+std::vector<EnsembleResult> runEnsembleLanes(const std::vector<const EnsembleMember*>& members,
+                                             const std::string& outputDir, KernelVariant variant) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    std::vector<Simulation> sims;
+    std::vector<const Simulation*> scenes;
+    sims.reserve(members.size());
+    bool loaded = true;
+    std::string error;
+    for (const EnsembleMember* m : members) {
+        sims.emplace_back(m->gridSize);
+        loaded = setupMember(*m, sims.back(), error) && loaded;
+        scenes.push_back(&sims.back());
+    }
+
+    // Geometry the lanes cannot share (e.g. a preset that randomizes) falls back to single
+    // runs, as do scenes that failed to load (which then report the error)
+    LaneEnsemble lanes;
+    if (members.size() == 1 || !loaded || !packLanes(scenes, lanes, error)) {
+        std::vector<EnsembleResult> results;
+        for (const EnsembleMember* m : members) results.push_back(runEnsembleMember(*m, outputDir, variant));
+        return results;
+    }
+
+    const EnsembleMember& first = *members[0];
+    const int steps = totalSteps(first);
+    const int chunk = chunkSteps(first);
+    std::vector<EnsembleResult> results(members.size());
+    std::vector<double> previous(members.size(), -1.0);
+    std::vector<bool> running(members.size(), true);
+    for (size_t k = 0; k < members.size(); k++) {
+        results[k].name = members[k]->name;
+        results[k].status = "done";
+    }
+
+    // Finished lanes keep stepping with the others; their state is frozen into their scene
+    for (int step = 0; step < steps && std::find(running.begin(), running.end(), true) != running.end();) {
+        const int n = std::min(chunk, steps - step);
+        stepLanes(lanes, first.dt, n);
+        step += n;
+
+        for (size_t k = 0; k < members.size(); k++) {
+            if (!running[k]) continue;
+            EnsembleResult& r = results[k];
+            r.steps = step;
+            r.energy = laneEnergy(lanes, static_cast<int>(k), r.linf);
+            if (checkStop(*members[k], r, previous[k])) {
+                unpackLane(lanes, static_cast<int>(k), sims[k]);
+                running[k] = false;
+            }
+        }
+    }
+
+    for (size_t k = 0; k < members.size(); k++) {
+        if (running[k]) unpackLane(lanes, static_cast<int>(k), sims[k]);
+        results[k].simTime = sims[k].time;
+        writeFields(*members[k], sims[k], outputDir, results[k]);
+    }
+
+    // Wall time is shared evenly between the lanes
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto& r : results) r.seconds = seconds / members.size();
+    return results;
+}
+
+bool writeEnsembleSummary(const std::string& path, const std::vector<EnsembleMember>& members,
+                          const std::vector<EnsembleResult>& results) {
+    std::ofstream f(path);
+    if (!f) return false;
+
+    std::vector<std::string> keys;
+    for (const auto& m : members) {
+        for (const auto& p : m.params) {
+            if (p.first != "preset" && std::find(keys.begin(), keys.end(), p.first) == keys.end()) keys.push_back(p.first);
+        }
+    }
+
+    f << "name,preset";
+    for (const auto& k : keys) f << "," << k;
+    f << ",status,steps,sim_time,wall_seconds,energy,linf\n";
+    for (size_t i = 0; i < members.size() && i < results.size(); i++) {
+        const auto& m = members[i];
+        const auto& r = results[i];
+        f << m.name << ",\"" << m.preset << "\"";
+        for (const auto& k : keys) {
+            auto it = std::find_if(m.params.begin(), m.params.end(), [&](const auto& p) { return p.first == k; });
+            f << "," << (it != m.params.end() ? it->second : "");
+        }
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), ",%s,%d,%.6g,%.6g,%.9g,%.9g", r.status.c_str(), r.steps, r.simTime, r.seconds,
+                      r.energy, r.linf);
+        f << buf << "\n";
+    }
+    return static_cast<bool>(f);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Colormap.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "Solver.h"
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Headless parameter studies: a spec file expands into independent ensemble members
+// (scene + parameter overrides), each stepped on one thread to its stop condition.
+//
+// Spec format, one directive per line ('#' starts a comment):
+//   defaults key=value ...     defaults for the lines that follow
+//   sweep key=value ...        cartesian product of every listed value
+//   run key=value ...          same as sweep (reads better for a single member)
+// Values may be a single value, a comma list (2,4,8), a range start:stop:step (inclusive),
+// or a double-quoted string ("Double Slit"). Keys:
+//   name preset (a stock preset or a .scene file; see src/Scene.h) size duration settle dt
+//   frequency amplitude waveSpeed damping reflectivity fields (u+walls)
+//   slitCount slitSpacing slitWidth slitSeparation (override the scene variables of that name)
+//   from (a snapshot to start from instead of the preset; see src/Snapshot.h)
+//   frames (simulated seconds between rendered images, written to <out>/<name>/)
+//   colormap (energy, rainbow, grayscale, cyan-yellow) contrast imageFormat (png, ppm)
+
+struct EnsembleMember {
+    std::string name;               // unique; used for output file names
+    std::string preset = "Double Slit";
+    std::string from;               // snapshot to fork from; its size and scene replace the preset's
+    int gridSize = GRID_SIZE;
+    float duration = 10.0f;         // simulated seconds
+    float settle = 0.0f;            // > 0: stop once energy changes less than this (relative) per simulated second
+    float dt = 1.0f / 60.0f;
+    // Overrides applied after the preset loads; unset ones keep the preset's values
+    bool hasFrequency = false, hasAmplitude = false, hasWaveSpeed = false, hasDamping = false, hasReflectivity = false;
+    float frequency = 0.0f, amplitude = 0.0f, waveSpeed = 0.0f, damping = 0.0f, reflectivity = 0.0f;
+    PresetParams geometry;
+    std::vector<std::string> fields;                          // field outputs: "u", "walls"
+    float frames = 0.0f;            // > 0: render an image every this many simulated seconds
+    ColormapOptions image;
+    std::string imageFormat = "png";
+    std::vector<std::pair<std::string, std::string>> params;  // as written in the spec, for the summary
+};
+
+struct EnsembleResult {
+    std::string name;
+    std::string status = "pending"; // done, settled, diverged, error
+    std::string error;
+    int steps = 0;
+    double simTime = 0.0;
+    double seconds = 0.0;           // wall time
+    double energy = 0.0;            // sum of u^2 at the end
+    double linf = 0.0;
+};
+
+bool parseEnsembleSpec(std::istream& in, std::vector<EnsembleMember>& members, std::string& error);
+bool readEnsembleSpec(const std::string& path, std::vector<EnsembleMember>& members, std::string& error);
+
+// Periodic snapshots of running members, so an interrupted study resumes where it stopped.
+// Each member keeps <directory>/<name>.wsnap; a member whose snapshot exists continues from
+// it, and a finished member's final snapshot records its status so it is not rerun.
+struct EnsembleCheckpoints {
+    std::string directory;          // empty: no checkpoints
+    double interval = 60.0;         // wall seconds between snapshots
+    bool compress = false;
+};
+
+// Runs one member on the calling thread and writes its requested fields to `outputDir`.
+// Images (frames > 0) are rendered and encoded on the same thread, since members already
+// run in parallel; frame_NNNNNN is the image at step NNNNNN * frame interval, so a resumed
+// member rewrites the same files.
+EnsembleResult runEnsembleMember(const EnsembleMember& member, const std::string& outputDir,
+                                 KernelVariant variant = KernelVariant::SIMD,
+                                 const EnsembleCheckpoints& checkpoints = EnsembleCheckpoints());
+
+// Splits members into groups of up to ENSEMBLE_LANES that share preset (or snapshot), size,
+// geometry, dt and duration, so they differ only in per-lane parameters (frequency, amplitude, wave
+// speed, damping, reflectivity, settle, fields). Members that render images run on their
+// own. A candidate group is kept only when `useLanes` accepts its first member; otherwise
+// its members stay on their own. Order within the spec is preserved.
+std::vector<std::vector<size_t>> groupEnsembleLanes(const std::vector<EnsembleMember>& members,
+                                                    const std::function<bool(const EnsembleMember&)>& useLanes);
+
+// Times the lanes kernel against single runs on `member`'s scene (see lanesOutperformSingle).
+bool ensembleLanesPayOff(const EnsembleMember& member);
+
+// Runs one group on the calling thread with the ensemble-lanes kernel; results match
+// runEnsembleMember() bit for bit. Wall time is split evenly across the group. Groups of
+// one, or scenes whose walls or sources turn out to differ, run member by member with
+// `variant`. Groups are not checkpointed (lanes only pay off on small grids); they rerun
+// on resume.
+std::vector<EnsembleResult> runEnsembleLanes(const std::vector<const EnsembleMember*>& members,
+                                             const std::string& outputDir,
+                                             KernelVariant variant = KernelVariant::SIMD);
+
+// One CSV row per member: name, preset, every spec parameter, then the result columns.
+bool writeEnsembleSummary(const std::string& path, const std::vector<EnsembleMember>& members,
+                          const std::vector<EnsembleResult>& results);
@@ -0,0 +1,220 @@
+#include "EnsembleLanes.h"
+
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+const int K = ENSEMBLE_LANES;
+
+// Same operations, in the same order, as the single-scene kernels. The lane loop is
+// branch-free so it vectorizes across scenes; the wall test is one load per cell. As in
+// the single-scene kernel, the damping multiply is dropped when every lane is undamped.
+template <bool Damped>
+void updateLaneRows(LaneEnsemble& e, const float* laneC2, int y0, int y1) {
+    const int size = e.size;
+    float c2_dt2[K], damping[K], reflect[K];
+    for (int k = 0; k < K; k++) {
+        c2_dt2[k] = laneC2[k];
+        damping[k] = e.damping[k];
+        reflect[k] = -e.wallReflectivity[k];
+    }
+
+    for (int y = std::max(y0, 1); y < std::min(y1, size - 1); y++) {
+        const uint8_t* __restrict wall = e.walls.data() + y * size;
+        const float* __restrict mid = e.u_prev.data() + size_t(y) * size * K;
+        const float* __restrict up = mid - size * K;
+        const float* __restrict down = mid + size * K;
+        const float* __restrict prev2 = e.u_prev2.data() + size_t(y) * size * K;
+        float* __restrict out = e.u.data() + size_t(y) * size * K;
+
+        for (int x = 1; x < size - 1; x++) {
+            const bool isWall = wall[x] != 0;
+            const int i = x * K;
+            for (int k = 0; k < K; k++) {
+                float laplacian = up[i + k] + down[i + k] + mid[i + k - K] + mid[i + k + K] - 4.0f * mid[i + k];
+                float wave = 2.0f * mid[i + k] - prev2[i + k] + c2_dt2[k] * laplacian;
+                if constexpr (Damped) wave *= damping[k];
+                float reflected = mid[i + k] * reflect[k];
+                out[i + k] = isWall ? reflected : wave;
+            }
+        }
+    }
+}
+
+void injectLaneSources(LaneEnsemble& e) {
+    const int size = e.size;
+    for (const auto& src : e.sources) {
+        if (!src.active) continue;
+
+        int sx = static_cast<int>(src.x);
+        int sy = static_cast<int>(src.y);
+        if (sx < 5 || sx >= size - 5 || sy < 5 || sy >= size - 5) continue;
+
+        float value[K];
+        for (int k = 0; k < K; k++) {
+            value[k] = src.amplitude[k] * std::sin(2.0f * PI * src.frequency[k] * e.time);
+        }
+        for (int dy = -4; dy <= 4; dy++) {
+            for (int dx = -4; dx <= 4; dx++) {
+                float dist = std::sqrt(dx*dx + dy*dy);
+                if (dist >= 5.0f) continue;
+                const int cell = (sy + dy) * size + (sx + dx);
+                if (e.walls[cell]) continue;
+                float falloff = std::exp(-dist * dist / 12.0f);
+                float* out = e.u.data() + cell * K;
+                for (int k = 0; k < K; k++) out[k] += value[k] * falloff;
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool canShareLanes(const Simulation& a, const Simulation& b) {
+    if (a.size != b.size || a.sources.size() != b.sources.size()) return false;
+    for (size_t i = 0; i < a.sources.size(); i++) {
+        if (a.sources.x(i) != b.sources.x(i) || a.sources.y(i) != b.sources.y(i) ||
+            a.sources.active(i) != b.sources.active(i)) {
+            return false;
+        }
+    }
+    for (int y = 0; y < a.size; y++) {
+        for (int x = 0; x < a.size; x++) {
+            if ((a.walls[a.index(x, y)] != 0) != (b.walls[b.index(x, y)] != 0)) return false;
+        }
+    }
+    return true;
+}
+
+bool packLanes(const std::vector<const Simulation*>& scenes, LaneEnsemble& e, std::string& error) {
+    if (scenes.empty() || static_cast<int>(scenes.size()) > K) {
+        error = "need 1 to " + std::to_string(K) + " scenes";
+        return false;
+    }
+    const Simulation& first = *scenes[0];
+    for (size_t i = 1; i < scenes.size(); i++) {
+        if (!canShareLanes(first, *scenes[i]) || scenes[i]->time != first.time) {
+            error = "scene " + std::to_string(i) + " does not share size, walls, sources or time with scene 0";
+            return false;
+        }
+    }
+
+    const int size = first.size;
+    e.size = size;
+    e.lanes = static_cast<int>(scenes.size());
+    e.time = first.time;
+    const size_t cells = size_t(size) * size;
+    e.u.assign(cells * K, 0.0f);
+    e.u_prev.assign(cells * K, 0.0f);
+    e.u_prev2.assign(cells * K, 0.0f);
+    e.walls.assign(cells, 0);
+
+    for (int k = 0; k < K; k++) {
+        // Spare lanes replay lane 0 so they stay finite and cost nothing extra
+        const Simulation& s = *scenes[k < e.lanes ? k : 0];
+        e.waveSpeed[k] = s.waveSpeed;
+        e.damping[k] = s.damping;
+        e.wallReflectivity[k] = s.wallReflectivity;
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                const size_t i = (size_t(y) * size + x) * K + k;
+                e.u[i] = s.u[s.index(x, y)];
+                e.u_prev[i] = s.u_prev[s.index(x, y)];
+                e.u_prev2[i] = s.u_prev2[s.index(x, y)];
+            }
+        }
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            e.walls[size_t(y) * size + x] = first.walls[first.index(x, y)] ? 1 : 0;
+        }
+    }
+
+    e.sources.clear();
+    for (size_t i = 0; i < first.sources.size(); i++) {
+        LaneSource src;
+        src.x = first.sources.x(i);
+        src.y = first.sources.y(i);
+        src.active = first.sources.active(i);
+        for (int k = 0; k < K; k++) {
+            const SourceStore& s = scenes[k < e.lanes ? k : 0]->sources;
+            src.frequency[k] = s.frequency(i);
+            src.amplitude[k] = s.amplitude(i);
+        }
+        e.sources.push_back(src);
+    }
+    return true;
+}
+
+void unpackLane(const LaneEnsemble& e, int lane, Simulation& scene) {
+    scene.time = e.time;
+    for (int y = 0; y < e.size; y++) {
+        for (int x = 0; x < e.size; x++) {
+            const size_t i = (size_t(y) * e.size + x) * K + lane;
+            scene.u[scene.index(x, y)] = e.u[i];
+            scene.u_prev[scene.index(x, y)] = e.u_prev[i];
+            scene.u_prev2[scene.index(x, y)] = e.u_prev2[i];
+        }
+    }
+}
+
+void stepLanes(LaneEnsemble& e, float dt, int steps, ThreadPool* pool) {
+    float c2_dt2[K];
+    bool damped = false;
+    for (int k = 0; k < K; k++) {
+        c2_dt2[k] = e.waveSpeed[k] * e.waveSpeed[k] * dt * dt;
+        damped |= e.damping[k] != 1.0f;
+    }
+    auto rows = damped ? updateLaneRows<true> : updateLaneRows<false>;
+
+    for (int s = 0; s < steps; ++s) {
+        e.time += dt;
+        std::swap(e.u_prev2, e.u_prev);
+        std::swap(e.u_prev, e.u);
+
+        if (pool) {
+            pool->parallelFor(1, e.size - 1, [&](int y0, int y1) { rows(e, c2_dt2, y0, y1); });
+        } else {
+            rows(e, c2_dt2, 1, e.size - 1);
+        }
+        injectLaneSources(e);
+    }
+}
+
+bool lanesOutperformSingle(const Simulation& scene, int steps) {
+    using Clock = std::chrono::steady_clock;
+    const float dt = 1.0f / 60.0f;
+
+    std::vector<Simulation> scenes(K, scene);
+    std::vector<const Simulation*> pointers;
+    for (const auto& sim : scenes) pointers.push_back(&sim);
+    LaneEnsemble lanes;
+    std::string error;
+    if (!packLanes(pointers, lanes, error)) return false;
+
+    SolverOptions options;
+    options.variant = KernelVariant::SIMD;
+
+    // Best of three after a warm-up; each side runs back to back so it is timed cache-warm,
+    // the way a batch task runs
+    auto best = [](const std::function<void()>& sweep) {
+        double seconds = 1e30;
+        for (int rep = 0; rep < 4; rep++) {
+            const auto start = Clock::now();
+            sweep();
+            if (rep > 0) seconds = std::min(seconds, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        return seconds;
+    };
+    const double laneSeconds = best([&]() { stepLanes(lanes, dt, steps); });
+    const double singleSeconds = best([&]() {
+        for (auto& sim : scenes) stepSimulation(sim, dt, steps, options);
+    });
+    return laneSeconds < singleSeconds;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// SIMD across scenes: ENSEMBLE_LANES scenes that share one wall mask and source layout are
+// interleaved per cell, so one vectorized sweep advances all of them while the mask and
+// the loop overhead are paid once. Lanes may differ in wave speed, damping, reflectivity
+// and per-source frequency/amplitude. Each lane stays bit-identical to stepping its scene
+// alone with stepSimulation().
+
+const int ENSEMBLE_LANES = 8;
+
+struct LaneSource {
+    float x, y;
+    bool active;
+    float frequency[ENSEMBLE_LANES];
+    float amplitude[ENSEMBLE_LANES];
+};
+
+struct LaneEnsemble {
+    int size = 0;
+    int lanes = 0;                  // scenes in use (<= ENSEMBLE_LANES); the rest mirror lane 0
+    float time = 0.0f;
+    // Cell-major, lane-minor: field[(y * size + x) * ENSEMBLE_LANES + lane]
+    FieldVector<float> u;
+    FieldVector<float> u_prev;
+    FieldVector<float> u_prev2;
+    FieldVector<uint8_t> walls;     // size * size, shared by every lane
+    std::vector<LaneSource> sources;
+    float waveSpeed[ENSEMBLE_LANES];
+    float damping[ENSEMBLE_LANES];
+    float wallReflectivity[ENSEMBLE_LANES];
+};
+
+// True when every scene has the same size, wall mask and source positions.
+bool canShareLanes(const Simulation& a, const Simulation& b);
+
+// Packs up to ENSEMBLE_LANES compatible scenes; returns false (with `error`) otherwise.
+bool packLanes(const std::vector<const Simulation*>& scenes, LaneEnsemble& ensemble, std::string& error);
+// Copies lane `lane`'s fields and time back into `scene` (which must match its layout size).
+void unpackLane(const LaneEnsemble& ensemble, int lane, Simulation& scene);
+
+// Advances every lane by `steps` substeps of length dt.
+void stepLanes(LaneEnsemble& ensemble, float dt, int steps, ThreadPool* pool = nullptr);
+
+// Times a lane sweep of ENSEMBLE_LANES copies of `scene` against stepping the copies one by
+// one with the SIMD kernel. Lanes win while the interleaved fields stay cache-resident, and
+// on walled rows the single-scene kernel cannot skip; they lose once the ensemble spills to
+// memory, so callers measure on the actual scene instead of guessing a cutoff.
+bool lanesOutperformSingle(const Simulation& scene, int steps = 8);
@@ -0,0 +1,81 @@
+#include "FieldAllocator.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define WAVESIM_HAVE_MMAP 1
+#endif
+
+namespace {
+
+// Below this, a zeroed heap block is cheaper than a mapping
+const size_t MAP_THRESHOLD = 64 * 1024;
+const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Opt-in with WAVESIM_HUGE_PAGES=1: some virtualized hosts back guest huge pages so
+// poorly that the stencil runs several times slower with them
+bool hugePagesEnabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("WAVESIM_HUGE_PAGES");
+        return env && env[0] == '1';
+    }();
+    return enabled;
+}
+
+} // namespace
+
+void* allocateField(size_t bytes) {
+    if (bytes == 0) bytes = FIELD_ALIGNMENT;
+#ifdef WAVESIM_HAVE_MMAP
+    if (bytes >= MAP_THRESHOLD) {
+        const bool huge = bytes >= HUGE_PAGE;
+        const size_t length = roundUp(bytes, huge ? HUGE_PAGE : 4096);
+        // Over-map by one huge page and trim so the block starts on a huge page boundary
+        const size_t mapped = huge ? length + HUGE_PAGE : length;
+        void* base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) return nullptr;
+        if (!huge) return base;
+
+        const uintptr_t start = reinterpret_cast<uintptr_t>(base);
+        const uintptr_t aligned = roundUp(start, HUGE_PAGE);
+        if (aligned > start) munmap(base, aligned - start);
+        const size_t tail = mapped - (aligned - start) - length;
+        if (tail) munmap(reinterpret_cast<void*>(aligned + length), tail);
+#ifdef MADV_HUGEPAGE
+        if (hugePagesEnabled()) madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+#endif
+        return reinterpret_cast<void*>(aligned);
+    }
+#endif
+    void* p = ::operator new(roundUp(bytes, FIELD_ALIGNMENT), std::align_val_t(FIELD_ALIGNMENT), std::nothrow);
+    if (p) std::memset(p, 0, bytes);
+    return p;
+}
+
+void freeField(void* p, size_t bytes) {
+    if (!p) return;
+    if (bytes == 0) bytes = FIELD_ALIGNMENT;
+#ifdef WAVESIM_HAVE_MMAP
+    if (bytes >= MAP_THRESHOLD) {
+        munmap(p, roundUp(bytes, bytes >= HUGE_PAGE ? HUGE_PAGE : 4096));
+        return;
+    }
+#endif
+    ::operator delete(p, std::align_val_t(FIELD_ALIGNMENT));
+}
+
+int fieldPitch(int width) {
+    const int lane = static_cast<int>(FIELD_ALIGNMENT / sizeof(float));
+    int pitch = (width + lane - 1) / lane * lane;
+    // A pitch that is a multiple of 1 KB maps the rows above and below to the same
+    // L1 sets; one extra cache line staggers them
+    if ((pitch * sizeof(float)) % 1024 == 0) pitch += lane;
+    return pitch;
+}
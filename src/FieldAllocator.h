@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Storage for simulation fields. Blocks are aligned to FIELD_ALIGNMENT and come back
+// zero-filled. Large blocks are fresh anonymous mappings (2 MB aligned, and advised for
+// transparent huge pages with WAVESIM_HUGE_PAGES=1) whose pages stay untouched until
+// first written, so the thread that first writes a page decides which NUMA node it
+// lives on (see firstTouchFields).
+
+const size_t FIELD_ALIGNMENT = 64;
+
+void* allocateField(size_t bytes);
+void freeField(void* p, size_t bytes);
+
+// Row pitch in elements for a grid `width` cells wide: a whole number of cache lines,
+// bumped by one line when rows would land on the same cache sets (power-of-two widths).
+int fieldPitch(int width);
+
+// Allocator for std::vector. Default construction leaves the (already zeroed) memory
+// untouched so resize() does not fault the pages in on the calling thread.
+template <class T>
+struct FieldAllocator {
+    using value_type = T;
+
+    FieldAllocator() = default;
+    template <class U>
+    FieldAllocator(const FieldAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* p = allocateField(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t n) { freeField(p, n * sizeof(T)); }
+
+    template <class U>
+    void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+    template <class U>
+    bool operator==(const FieldAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const FieldAllocator<U>&) const { return false; }
+};
+
+template <class T>
+using FieldVector = std::vector<T, FieldAllocator<T>>;
@@ -0,0 +1,386 @@
+#include "FieldStore.h"
+
+#include "Solver.h"
+#include "ThreadPool.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WAVESIM_HAVE_MMAP 1
+#endif
+
+namespace {
+
+const char MAGIC[8] = { 'W', 'S', 'F', 'I', 'E', 'L', 'D', '\0' };
+const size_t HEADER_BYTES = 4096;
+const size_t REGION_ALIGNMENT = 64 * 1024;
+const size_t BAND_TARGET_BYTES = 1 << 20;
+
+static_assert(sizeof(FieldStoreHeader) <= HEADER_BYTES, "field store header must fit its page");
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+size_t pageSize() {
+#ifdef WAVESIM_HAVE_MMAP
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page;
+#else
+    return 4096;
+#endif
+}
+
+} // namespace
+
+// Writes back and evicts finished bands off the solver thread. Ranges are byte offsets
+// into the mapping; each is written, waited for, then dropped from the page cache and
+// this process's page tables (the data stays in the file).
+struct FieldStore::Writer {
+    FieldStore& store;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<std::pair<size_t, size_t>> queue;
+    bool busy = false;
+    bool stop = false;
+    std::thread thread;
+
+    explicit Writer(FieldStore& s) : store(s), thread([this] { run(); }) {}
+    ~Writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void push(size_t offset, size_t length) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.emplace_back(offset, length);
+        }
+        wake.notify_one();
+    }
+
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return queue.empty() && !busy; });
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stop || !queue.empty(); });
+            if (queue.empty()) break;
+            const auto range = queue.front();
+            queue.pop_front();
+            busy = true;
+            lock.unlock();
+            writeBack(range.first, range.second);
+            lock.lock();
+            busy = false;
+            if (queue.empty()) idle.notify_all();
+        }
+    }
+
+    void writeBack(size_t offset, size_t length) {
+#ifdef WAVESIM_HAVE_MMAP
+        char* base = static_cast<char*>(store.m_base);
+#ifdef __linux__
+        sync_file_range(store.m_fd, offset, length,
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(store.m_fd, offset, length, POSIX_FADV_DONTNEED);
+#else
+        msync(base + offset, length, MS_SYNC);
+#endif
+        madvise(base + offset, length, MADV_DONTNEED);
+#else
+        (void)offset;
+        (void)length;
+#endif
+    }
+};
+
+std::unique_ptr<FieldStore> FieldStore::create(const std::string& path, int size, std::string& error) {
+#ifdef WAVESIM_HAVE_MMAP
+    if (size < 3) {
+        error = "grid too small";
+        return nullptr;
+    }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = "cannot create " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    const size_t cells = size_t(size) * size;
+    const size_t fieldBytes = roundUp(cells * sizeof(float), REGION_ALIGNMENT);
+    const size_t bytes = HEADER_BYTES + 3 * fieldBytes + roundUp(cells, REGION_ALIGNMENT);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        error = "cannot size " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<FieldStore> store(new FieldStore());
+    if (!store->map(fd, bytes, true, error)) return nullptr;
+
+    FieldStoreHeader& h = *store->m_header;
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = FIELD_STORE_VERSION;
+    h.size = static_cast<uint32_t>(size);
+    h.fieldU = 0;
+    h.fieldPrev = 1;
+    h.fieldPrev2 = 2;
+    h.sourceCount = 0;
+    h.step = 0;
+    const Simulation defaults(3);
+    h.time = 0.0f;
+    h.waveSpeed = defaults.waveSpeed;
+    h.damping = defaults.damping;
+    h.wallReflectivity = defaults.wallReflectivity;
+    store->m_fieldBytes = fieldBytes;
+    store->m_walls = static_cast<uint8_t*>(store->m_base) + HEADER_BYTES + 3 * fieldBytes;
+    store->m_bandRows = std::max(1, static_cast<int>(BAND_TARGET_BYTES / (size_t(size) * sizeof(float))));
+    return store;
+#else
+    (void)size;
+    error = "out-of-core storage needs mmap (" + path + ")";
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<FieldStore> FieldStore::open(const std::string& path, bool writable, std::string& error) {
+#ifdef WAVESIM_HAVE_MMAP
+    const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < HEADER_BYTES) {
+        error = path + " is not a field store";
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::unique_ptr<FieldStore> store(new FieldStore());
+    if (!store->map(fd, size_t(st.st_size), writable, error)) return nullptr;
+
+    const FieldStoreHeader& h = *store->m_header;
+    const size_t cells = size_t(h.size) * h.size;
+    const size_t fieldBytes = roundUp(cells * sizeof(float), REGION_ALIGNMENT);
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != FIELD_STORE_VERSION || h.size < 3 ||
+        HEADER_BYTES + 3 * fieldBytes + cells > store->m_bytes || h.sourceCount > FIELD_STORE_MAX_SOURCES ||
+        h.fieldU > 2 || h.fieldPrev > 2 || h.fieldPrev2 > 2) {
+        error = path + " is not a version " + std::to_string(FIELD_STORE_VERSION) + " field store";
+        return nullptr;
+    }
+    store->m_fieldBytes = fieldBytes;
+    store->m_walls = static_cast<uint8_t*>(store->m_base) + HEADER_BYTES + 3 * fieldBytes;
+    store->m_bandRows = std::max(1, static_cast<int>(BAND_TARGET_BYTES / (size_t(h.size) * sizeof(float))));
+    for (uint32_t i = 0; i < h.sourceCount; i++) {
+        const FieldStoreSource& s = h.sources[i];
+        WaveSource source(s.x, s.y, s.frequency, s.amplitude);
+        source.active = s.active != 0;
+        store->m_sources.add(source);
+    }
+    return store;
+#else
+    (void)writable;
+    error = "out-of-core storage needs mmap (" + path + ")";
+    return nullptr;
+#endif
+}
+
+bool FieldStore::map(int fd, size_t bytes, bool writable, std::string& error) {
+#ifdef WAVESIM_HAVE_MMAP
+    m_fd = fd;
+    void* base = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        error = std::string("mmap failed: ") + std::strerror(errno);
+        return false;
+    }
+    m_base = base;
+    m_bytes = bytes;
+    m_header = static_cast<FieldStoreHeader*>(base);
+    // The solver walks the file front to back; readers sample sparse rows
+    madvise(base, bytes, writable ? MADV_SEQUENTIAL : MADV_RANDOM);
+    if (writable) m_writer.reset(new Writer(*this));
+    return true;
+#else
+    (void)fd;
+    (void)bytes;
+    (void)writable;
+    error = "out-of-core storage needs mmap";
+    return false;
+#endif
+}
+
+FieldStore::~FieldStore() {
+    m_writer.reset();
+#ifdef WAVESIM_HAVE_MMAP
+    if (m_base) munmap(m_base, m_bytes);
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+}
+
+float* FieldStore::field(uint32_t index) const {
+    return reinterpret_cast<float*>(static_cast<char*>(m_base) + HEADER_BYTES + index * m_fieldBytes);
+}
+
+bool FieldStore::importScene(const Simulation& scene, std::string& error) {
+    const int n = size();
+    if (scene.size != n) {
+        error = "scene is " + std::to_string(scene.size) + "^2, store is " + std::to_string(n) + "^2";
+        return false;
+    }
+    if (scene.sources.size() > size_t(FIELD_STORE_MAX_SOURCES)) {
+        error = "a field store holds at most " + std::to_string(FIELD_STORE_MAX_SOURCES) + " sources";
+        return false;
+    }
+
+    FieldStoreHeader& h = *m_header;
+    float* u = field(h.fieldU);
+    float* prev = field(h.fieldPrev);
+    float* prev2 = field(h.fieldPrev2);
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            const size_t src = scene.index(x, y);
+            const size_t dst = size_t(y) * n + x;
+            // Writing zeros would allocate every block of the sparse file
+            if (scene.u[src] != 0.0f) u[dst] = scene.u[src];
+            if (scene.u_prev[src] != 0.0f) prev[dst] = scene.u_prev[src];
+            if (scene.u_prev2[src] != 0.0f) prev2[dst] = scene.u_prev2[src];
+            if (scene.walls[src]) m_walls[dst] = 1;
+        }
+    }
+
+    h.step = 0;
+    h.time = scene.time;
+    h.waveSpeed = scene.waveSpeed;
+    h.damping = scene.damping;
+    h.wallReflectivity = scene.wallReflectivity;
+    h.sourceCount = static_cast<uint32_t>(scene.sources.size());
+    m_sources = scene.sources;
+    const SourceStore& s = scene.sources;
+    for (size_t i = 0; i < s.size(); i++) {
+        h.sources[i] = { s.x(i), s.y(i), s.frequency(i), s.amplitude(i), s.active(i) ? 1u : 0u };
+    }
+    return true;
+}
+
+void FieldStore::prefetch(int y0, int y1) {
+#ifdef WAVESIM_HAVE_MMAP
+    const int n = size();
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, n);
+    if (y1 <= y0) return;
+    const size_t page = pageSize();
+    auto willNeed = [&](const void* begin, size_t length) {
+        const size_t offset = static_cast<const char*>(begin) - static_cast<const char*>(m_base);
+        const size_t start = offset / page * page;
+        madvise(static_cast<char*>(m_base) + start, roundUp(offset + length, page) - start, MADV_WILLNEED);
+    };
+    const size_t rowBytes = size_t(n) * sizeof(float);
+    const FieldStoreHeader& h = *m_header;
+    willNeed(field(h.fieldPrev) + size_t(y0) * n, (y1 - y0) * rowBytes);
+    willNeed(field(h.fieldPrev2) + size_t(y0) * n, (y1 - y0) * rowBytes);
+    willNeed(m_walls + size_t(y0) * n, size_t(y1 - y0) * n);
+#else
+    (void)y0;
+    (void)y1;
+#endif
+}
+
+// Hands the whole pages inside [begin, end) to the writer
+void FieldStore::retire(const void* begin, const void* end) {
+    const size_t page = pageSize();
+    const size_t first = roundUp(static_cast<const char*>(begin) - static_cast<const char*>(m_base), page);
+    const size_t last = (static_cast<const char*>(end) - static_cast<const char*>(m_base)) / page * page;
+    if (last > first) m_writer->push(first, last - first);
+}
+
+void FieldStore::step(float dt, int steps, ThreadPool* pool) {
+    FieldStoreHeader& h = *m_header;
+    const int n = size();
+    const float c2_dt2 = h.waveSpeed * h.waveSpeed * dt * dt;
+
+    for (int s = 0; s < steps; ++s) {
+        h.time += dt;
+        h.step++;
+        // Same rotation as the in-memory swap: u_prev2 <- u_prev <- u <- u_prev2
+        const uint32_t u = h.fieldPrev2;
+        h.fieldPrev2 = h.fieldPrev;
+        h.fieldPrev = h.fieldU;
+        h.fieldU = u;
+
+        StencilView view;
+        view.u = field(h.fieldU);
+        view.u_prev = field(h.fieldPrev);
+        view.u_prev2 = field(h.fieldPrev2);
+        view.walls = m_walls;
+        view.pitch = n;
+
+        // Rows of u_prev below this are no longer read this step
+        int prevRetired = 0;
+        prefetch(0, 1 + m_prefetchBands * m_bandRows + 1);
+        for (int y0 = 1; y0 < n - 1; y0 += m_bandRows) {
+            const int y1 = std::min(y0 + m_bandRows, n - 1);
+            prefetch(y1 + m_prefetchBands * m_bandRows - m_bandRows, y1 + m_prefetchBands * m_bandRows + 1);
+
+            auto rows = [&](int r0, int r1) {
+                updateStencilRect(view, c2_dt2, h.damping, h.wallReflectivity, r0, r1, 1, n - 1);
+            };
+            if (pool) {
+                pool->parallelFor(y0, y1, rows);
+            } else {
+                rows(y0, y1);
+            }
+
+            // The band's output is final; u_prev rows above y1 - 1 and this band's u_prev2
+            // and walls will not be read again this step
+            retire(view.u + size_t(y0) * n, view.u + size_t(y1) * n);
+            retire(view.u_prev + size_t(prevRetired) * n, view.u_prev + size_t(y1 - 1) * n);
+            prevRetired = y1 - 1;
+            retire(view.u_prev2 + size_t(y0) * n, view.u_prev2 + size_t(y1) * n);
+            retire(m_walls + size_t(y0) * n, m_walls + size_t(y1) * n);
+        }
+
+        injectSourcesRect(view.u, m_walls, n, 0, 0, 0, n, 0, n, n, m_sources, h.time);
+    }
+}
+
+void FieldStore::flush() {
+    if (m_writer) m_writer->drain();
+#ifdef WAVESIM_HAVE_MMAP
+    msync(m_base, HEADER_BYTES, MS_SYNC);
+#endif
+}
+
+void FieldStore::overview(int outSize, float* u, float* walls) const {
+    const int n = size();
+    const float* field = this->field(m_header->fieldU);
+    for (int j = 0; j < outSize; j++) {
+        const size_t row = size_t(int64_t(j) * n / outSize) * n;
+        for (int i = 0; i < outSize; i++) {
+            const size_t x = size_t(int64_t(i) * n / outSize);
+            u[size_t(j) * outSize + i] = field[row + x];
+            if (walls) walls[size_t(j) * outSize + i] = m_walls[row + x] ? 1.0f : 0.0f;
+        }
+    }
+}
+
+void FieldStore::readField(float* out) const {
+    std::memcpy(out, field(m_header->fieldU), size_t(size()) * size() * sizeof(float));
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Out-of-core field storage for grids larger than RAM. The three displacement fields and
+// the wall mask live in one memory-mapped file and the solver streams through them in
+// bands of rows, so only a sliding window of bands needs to be resident:
+//   - bands ahead of the solver are prefetched (madvise/posix_fadvise WILLNEED);
+//   - finished bands are handed to a writer thread that writes them back and drops them
+//     from the page cache, so dirty pages never pile up behind the window.
+// Steps are bit-identical to stepSimulation() with the SIMD kernel. Another process can
+// open the same file read-only and watch it through overview().
+//
+// File layout: a 4 KB header (FieldStoreHeader), then field 0, 1, 2 (size^2 floats each)
+// and the walls (size^2 bytes), every region page aligned. Which field is u, u_prev and
+// u_prev2 rotates each step and is recorded in the header.
+
+const int FIELD_STORE_VERSION = 1;
+const int FIELD_STORE_MAX_SOURCES = 64;
+
+struct FieldStoreSource {
+    float x, y, frequency, amplitude;
+    uint32_t active;
+};
+
+struct FieldStoreHeader {
+    char magic[8];                  // "WSFIELD\0"
+    uint32_t version;
+    uint32_t size;
+    uint32_t fieldU, fieldPrev, fieldPrev2;
+    uint32_t sourceCount;
+    uint64_t step;
+    float time;
+    float waveSpeed;
+    float damping;
+    float wallReflectivity;
+    FieldStoreSource sources[FIELD_STORE_MAX_SOURCES];
+};
+
+class FieldStore {
+public:
+    // Creates (or truncates) `path` for a size x size grid. The file starts sparse, so a
+    // fresh 32k^2 store takes no disk space until the waves reach it.
+    static std::unique_ptr<FieldStore> create(const std::string& path, int size, std::string& error);
+    static std::unique_ptr<FieldStore> open(const std::string& path, bool writable, std::string& error);
+    ~FieldStore();
+
+    int size() const { return static_cast<int>(m_header->size); }
+    const FieldStoreHeader& header() const { return *m_header; }
+
+    // Copies walls, sources, physics, time and any nonzero field cells of `scene` into a
+    // freshly created store of the same size. Zero cells are skipped so the file stays sparse.
+    bool importScene(const Simulation& scene, std::string& error);
+
+    // Rows per streamed band (default: about 1 MB of one field per band)
+    void setBandRows(int rows) { m_bandRows = std::max(1, rows); }
+    // Bands read ahead of the solver
+    void setPrefetchBands(int bands) { m_prefetchBands = std::max(0, bands); }
+
+    void step(float dt, int steps, ThreadPool* pool = nullptr);
+    // Waits until the writer thread has written back every finished band.
+    void flush();
+
+    // Point-sampled outSize x outSize copy of u (and optionally the walls as 0/1), reading
+    // only the sampled rows.
+    void overview(int outSize, float* u, float* walls = nullptr) const;
+    // Copies u into a dense size x size array.
+    void readField(float* out) const;
+
+private:
+    struct Writer;
+
+    FieldStore() = default;
+    bool map(int fd, size_t bytes, bool writable, std::string& error);
+    float* field(uint32_t index) const;
+    void prefetch(int y0, int y1);
+    void retire(const void* begin, const void* end);
+
+    int m_fd = -1;
+    void* m_base = nullptr;
+    size_t m_bytes = 0;
+    size_t m_fieldBytes = 0;        // one field region, page aligned
+    FieldStoreHeader* m_header = nullptr;
+    uint8_t* m_walls = nullptr;
+    SourceStore m_sources;
+    int m_bandRows = 0;
+    int m_prefetchBands = 2;
+    std::unique_ptr<Writer> m_writer;
+};
@@ -0,0 +1,281 @@
+#include "Geometry.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+float length(float x, float y) {
+    return std::sqrt(x * x + y * y);
+}
+
+float segmentDistance(float px, float py, float ax, float ay, float bx, float by) {
+    const float ex = bx - ax, ey = by - ay;
+    const float wx = px - ax, wy = py - ay;
+    const float ee = ex * ex + ey * ey;
+    const float t = ee > 0.0f ? std::clamp((wx * ex + wy * ey) / ee, 0.0f, 1.0f) : 0.0f;
+    return length(wx - ex * t, wy - ey * t);
+}
+
+float boxDistance(const Shape& s, float px, float py) {
+    const float hx = 0.5f * (s.bx - s.ax), hy = 0.5f * (s.by - s.ay);
+    const float qx = std::fabs(px - 0.5f * (s.ax + s.bx)) - hx;
+    const float qy = std::fabs(py - 0.5f * (s.ay + s.by)) - hy;
+    return length(std::max(qx, 0.0f), std::max(qy, 0.0f)) + std::min(std::max(qx, qy), 0.0f);
+}
+
+float arcDistance(const Shape& s, float px, float py) {
+    const float dx = px - s.ax, dy = py - s.ay;
+    const float span = s.angle1 - s.angle0;
+    if (span < 2.0f * PI) {
+        float rel = std::atan2(dy, dx) - s.angle0;
+        rel -= 2.0f * PI * std::floor(rel / (2.0f * PI));
+        // Outside the arc's wedge the nearest point is one of its ends
+        if (rel > span) {
+            const float d0 = length(px - s.ax - s.radius * std::cos(s.angle0), py - s.ay - s.radius * std::sin(s.angle0));
+            const float d1 = length(px - s.ax - s.radius * std::cos(s.angle1), py - s.ay - s.radius * std::sin(s.angle1));
+            return std::min(d0, d1) - s.halfWidth;
+        }
+    }
+    return std::fabs(length(dx, dy) - s.radius) - s.halfWidth;
+}
+
+float polygonDistance(const Shape& s, float px, float py) {
+    const std::vector<float>& v = s.points;
+    const size_t n = v.size() / 2;
+    if (n == 0) return std::numeric_limits<float>::max();
+    float best = (px - v[0]) * (px - v[0]) + (py - v[1]) * (py - v[1]);
+    float sign = 1.0f;
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        const float ex = v[2 * j] - v[2 * i], ey = v[2 * j + 1] - v[2 * i + 1];
+        const float wx = px - v[2 * i], wy = py - v[2 * i + 1];
+        const float ee = ex * ex + ey * ey;
+        const float t = ee > 0.0f ? std::clamp((wx * ex + wy * ey) / ee, 0.0f, 1.0f) : 0.0f;
+        const float bx = wx - ex * t, by = wy - ey * t;
+        best = std::min(best, bx * bx + by * by);
+        // Crossing number for the inside test
+        const bool above = py >= v[2 * i + 1], below = py < v[2 * j + 1], left = ex * wy > ey * wx;
+        if ((above && below && left) || (!above && !below && !left)) sign = -sign;
+    }
+    return sign * std::sqrt(best);
+}
+
+// In the parabola's frame (along = offset along the axis, across = distance from it) the
+// curve is (curvature * t^2, t). The nearest point solves
+// 2k^2 t^3 + (1 - 2k along) t - across = 0, or is an end of the |t| <= reach piece.
+float parabolaDistance(const Shape& s, float px, float py) {
+    const double k = s.curvature, reach = s.reach;
+    const double rx = px - s.ax, ry = py - s.ay;
+    const double along = rx * s.bx + ry * s.by;
+    const double across = -rx * s.by + ry * s.bx;
+    double roots[3];
+    int count = 0;
+    if (k == 0.0) {
+        roots[count++] = across;
+    } else {
+        // Depressed cubic t^3 + p t + q = 0
+        const double p = (1.0 - 2.0 * k * along) / (2.0 * k * k);
+        const double q = -across / (2.0 * k * k);
+        const double disc = 0.25 * q * q + p * p * p / 27.0;
+        if (disc >= 0.0) {
+            const double r = std::sqrt(disc);
+            roots[count++] = std::cbrt(-0.5 * q + r) + std::cbrt(-0.5 * q - r);
+        } else {
+            const double m = 2.0 * std::sqrt(-p / 3.0);
+            const double phi = std::acos(std::clamp(3.0 * q / (p * m), -1.0, 1.0));
+            for (int i = 0; i < 3; i++) roots[count++] = m * std::cos((phi - 2.0 * PI * i) / 3.0);
+        }
+    }
+    double best = std::numeric_limits<double>::max();
+    auto visit = [&](double t) {
+        t = std::clamp(t, -reach, reach);
+        const double da = along - k * t * t, dc = across - t;
+        best = std::min(best, da * da + dc * dc);
+    };
+    visit(-reach);
+    visit(reach);
+    for (int i = 0; i < count; i++) visit(roots[i]);
+    return static_cast<float>(std::sqrt(best)) - s.halfWidth;
+}
+
+float slitsDistance(const Shape& s, float px, float py) {
+    const float box = boxDistance(s, px, py);
+    const float along = (s.bx - s.ax >= s.by - s.ay) ? px : py;
+    float gap = std::numeric_limits<float>::max();
+    for (float c : s.points) gap = std::min(gap, std::fabs(along - c) - s.halfWidth);
+    return std::max(box, -gap);
+}
+
+} // namespace
+
+Shape segmentShape(float ax, float ay, float bx, float by, float halfWidth) {
+    Shape s;
+    s.type = Shape::SEGMENT;
+    s.ax = ax;
+    s.ay = ay;
+    s.bx = bx;
+    s.by = by;
+    s.halfWidth = halfWidth;
+    return s;
+}
+
+Shape boxShape(float x0, float y0, float x1, float y1) {
+    Shape s;
+    s.type = Shape::BOX;
+    s.ax = std::min(x0, x1);
+    s.ay = std::min(y0, y1);
+    s.bx = std::max(x0, x1);
+    s.by = std::max(y0, y1);
+    return s;
+}
+
+Shape arcShape(float cx, float cy, float radius, float halfWidth, float angle0, float angle1) {
+    Shape s;
+    s.type = Shape::ARC;
+    s.ax = cx;
+    s.ay = cy;
+    s.radius = radius;
+    s.halfWidth = halfWidth;
+    s.angle0 = angle0;
+    s.angle1 = angle1;
+    return s;
+}
+
+Shape polygonShape(const std::vector<float>& points) {
+    Shape s;
+    s.type = Shape::POLYGON;
+    s.points = points;
+    return s;
+}
+
+Shape parabolaShape(float vx, float vy, float dirX, float dirY, float curvature, float reach, float halfWidth) {
+    Shape s;
+    s.type = Shape::PARABOLA;
+    s.ax = vx;
+    s.ay = vy;
+    const float norm = length(dirX, dirY);
+    s.bx = norm > 0.0f ? dirX / norm : 1.0f;
+    s.by = norm > 0.0f ? dirY / norm : 0.0f;
+    s.curvature = curvature;
+    s.reach = std::fabs(reach);
+    s.halfWidth = halfWidth;
+    return s;
+}
+
+Shape slitsShape(float x0, float y0, float x1, float y1, const std::vector<float>& centres, float halfWidth) {
+    Shape s = boxShape(x0, y0, x1, y1);
+    s.type = Shape::SLITS;
+    s.points = centres;
+    s.halfWidth = halfWidth;
+    return s;
+}
+
+float shapeDistance(const Shape& s, float x, float y) {
+    switch (s.type) {
+        case Shape::SEGMENT: return segmentDistance(x, y, s.ax, s.ay, s.bx, s.by) - s.halfWidth;
+        case Shape::BOX: return boxDistance(s, x, y);
+        case Shape::ARC: return arcDistance(s, x, y);
+        case Shape::POLYGON: return polygonDistance(s, x, y);
+        case Shape::PARABOLA: return parabolaDistance(s, x, y);
+        case Shape::SLITS: return slitsDistance(s, x, y);
+        default: return std::numeric_limits<float>::max();
+    }
+}
+
+void shapeBounds(const Shape& s, float& x0, float& y0, float& x1, float& y1) {
+    x0 = y0 = std::numeric_limits<float>::max();
+    x1 = y1 = std::numeric_limits<float>::lowest();
+    auto include = [&](float x, float y) {
+        x0 = std::min(x0, x);
+        y0 = std::min(y0, y);
+        x1 = std::max(x1, x);
+        y1 = std::max(y1, y);
+    };
+    float pad = 0.0f;
+    switch (s.type) {
+        case Shape::SEGMENT:
+            include(s.ax, s.ay);
+            include(s.bx, s.by);
+            pad = s.halfWidth;
+            break;
+        case Shape::BOX:
+        case Shape::SLITS:
+            include(s.ax, s.ay);
+            include(s.bx, s.by);
+            break;
+        case Shape::ARC:
+            include(s.ax - s.radius, s.ay - s.radius);
+            include(s.ax + s.radius, s.ay + s.radius);
+            pad = s.halfWidth;
+            break;
+        case Shape::POLYGON:
+            for (size_t i = 0; i + 1 < s.points.size(); i += 2) include(s.points[i], s.points[i + 1]);
+            break;
+        case Shape::PARABOLA: {
+            // Corners of the curve's box in its own frame
+            const float depth = s.curvature * s.reach * s.reach;
+            for (float a : { 0.0f, depth }) {
+                for (float c : { -s.reach, s.reach }) include(s.ax + a * s.bx - c * s.by, s.ay + a * s.by + c * s.bx);
+            }
+            pad = s.halfWidth;
+            break;
+        }
+    }
+    x0 -= pad;
+    y0 -= pad;
+    x1 += pad;
+    y1 += pad;
+}
+
+void rasterizeShapes(Simulation& sim, const std::vector<Shape>& shapes, ThreadPool* pool) {
+    struct Bounds { float x0, y0, x1, y1; };
+    std::vector<Bounds> bounds(shapes.size());
+    for (size_t i = 0; i < shapes.size(); i++) {
+        shapeBounds(shapes[i], bounds[i].x0, bounds[i].y0, bounds[i].x1, bounds[i].y1);
+    }
+
+    const int n = sim.size;
+    const int tiles = (n + FIELD_TILE - 1) / FIELD_TILE;
+    auto tileRows = [&](int ty0, int ty1) {
+        std::vector<size_t> hits;
+        for (int ty = ty0; ty < ty1; ty++) {
+            const int y0 = ty * FIELD_TILE, y1 = std::min(n, y0 + FIELD_TILE) - 1;
+            for (int tx = 0; tx < tiles; tx++) {
+                const int x0 = tx * FIELD_TILE, x1 = std::min(n, x0 + FIELD_TILE) - 1;
+                hits.clear();
+                for (size_t i = 0; i < shapes.size(); i++) {
+                    const Bounds& b = bounds[i];
+                    if (b.x1 >= x0 && b.x0 <= x1 && b.y1 >= y0 && b.y0 <= y1) hits.push_back(i);
+                }
+                if (hits.empty()) continue;
+
+                // Distances change by at most one per cell moved, so the value at the tile's
+                // centre settles tiles that lie wholly outside or inside a shape
+                const float cx = 0.5f * (x0 + x1), cy = 0.5f * (y0 + y1);
+                const float reach = length(0.5f * (x1 - x0), 0.5f * (y1 - y0)) + 0.01f;
+                for (size_t i : hits) {
+                    const Shape& shape = shapes[i];
+                    const float d = shapeDistance(shape, cx, cy);
+                    if (d >= reach) continue;
+                    const bool filled = d < -reach;
+                    for (int y = y0; y <= y1; y++) {
+                        for (int x = x0; x <= x1; x++) {
+                            uint8_t& cell = sim.walls[sim.index(x, y)];
+                            if (!cell && (filled || shapeDistance(shape, static_cast<float>(x), static_cast<float>(y)) < 0.0f)) {
+                                cell = 1;
+                            }
+                        }
+                    }
+                    if (filled) break;
+                }
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(0, tiles, tileRows);
+    } else {
+        tileRows(0, tiles);
+    }
+}
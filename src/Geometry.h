@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <vector>
+
+class ThreadPool;
+
+// Wall geometry as shapes with signed distance functions, in cell units: cell (x, y) is the
+// point (x, y), and it becomes a wall when a shape's distance there is negative. Every
+// distance is exact or a lower bound with slope at most 1, so a whole tile of cells can be
+// accepted or rejected from the distance at its centre.
+//
+//   SEGMENT   a -> b, thickened by halfWidth on every side (a capsule)
+//   BOX       axis-aligned, corners a and b
+//   ARC       circle of `radius` around a, thickened by halfWidth, from angle0 to angle1
+//             (radians, counter-clockwise; a full ring when they span 2 pi)
+//   POLYGON   filled, vertices as x, y pairs in `points`
+//   PARABOLA  vertex a, opening along the unit vector b, offset = curvature * t^2 at
+//             distance t from the axis for |t| <= reach, thickened by halfWidth
+//   SLITS     BOX with gaps of half width halfWidth centred on `points`, along the box's
+//             longer side and through its whole thickness (gratings, double slits)
+struct Shape {
+    enum Type { SEGMENT, BOX, ARC, POLYGON, PARABOLA, SLITS };
+
+    Type type = BOX;
+    float ax = 0.0f, ay = 0.0f, bx = 0.0f, by = 0.0f;
+    float radius = 0.0f;
+    float halfWidth = 0.0f;
+    float angle0 = 0.0f, angle1 = 0.0f;
+    float curvature = 0.0f;
+    float reach = 0.0f;
+    std::vector<float> points;
+};
+
+Shape segmentShape(float ax, float ay, float bx, float by, float halfWidth);
+Shape boxShape(float x0, float y0, float x1, float y1);
+Shape arcShape(float cx, float cy, float radius, float halfWidth, float angle0 = 0.0f, float angle1 = 2.0f * PI);
+Shape polygonShape(const std::vector<float>& points);
+Shape parabolaShape(float vx, float vy, float dirX, float dirY, float curvature, float reach, float halfWidth);
+Shape slitsShape(float x0, float y0, float x1, float y1, const std::vector<float>& centres, float halfWidth);
+
+// Signed distance from (x, y) to the shape; negative inside
+float shapeDistance(const Shape& shape, float x, float y);
+// Box holding every point with a negative distance
+void shapeBounds(const Shape& shape, float& x0, float& y0, float& x1, float& y1);
+
+// Marks the cells inside any shape as walls (others are left as they are). The grid is
+// walked in FIELD_TILE tiles, and only shapes whose bounds touch a tile are evaluated
+// there, so untouched tiles (and their pages) are never written. Tile rows are spread
+// over `pool`.
+void rasterizeShapes(Simulation& sim, const std::vector<Shape>& shapes, ThreadPool* pool = nullptr);
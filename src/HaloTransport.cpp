@@ -0,0 +1,140 @@
+#include "HaloTransport.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define WAVESIM_HAVE_MMAP 1
+#endif
+
+namespace {
+
+const int SIDES = static_cast<int>(HaloSide::COUNT);
+
+// Spin briefly (halos usually arrive within the interior update), then yield the core
+template <class Ready>
+void waitFor(Ready ready) {
+    for (int spin = 0; !ready(); spin++) {
+        if (spin > 1000) std::this_thread::yield();
+    }
+}
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+HaloSide oppositeSide(HaloSide side) {
+    switch (side) {
+        case HaloSide::NORTH: return HaloSide::SOUTH;
+        case HaloSide::SOUTH: return HaloSide::NORTH;
+        case HaloSide::WEST: return HaloSide::EAST;
+        case HaloSide::EAST: return HaloSide::WEST;
+        default: return side;
+    }
+}
+
+// Slot s holds the message for steps with parity s. `posted` is the step last written,
+// `taken` the step last read; the writer may reuse a slot once taken catches up.
+struct alignas(64) ShmHaloTransport::Mailbox {
+    std::atomic<uint64_t> posted[2];
+    std::atomic<uint64_t> taken[2];
+};
+
+// Counting barrier: the last rank to arrive resets the count and bumps the generation
+struct alignas(64) ShmHaloTransport::Header {
+    std::atomic<int> arrived;
+    std::atomic<int> generation;
+};
+
+std::unique_ptr<ShmHaloTransport> ShmHaloTransport::create(int ranks, size_t maxCount, std::string& error) {
+#ifdef WAVESIM_HAVE_MMAP
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory mailboxes need lock-free atomics");
+
+    const size_t mailboxes = size_t(ranks) * SIDES;
+    const size_t slotBytes = roundUp(maxCount * sizeof(float), 64);
+    const size_t bytes = sizeof(Header) + mailboxes * (sizeof(Mailbox) + 2 * slotBytes);
+
+    // MAP_SHARED survives fork(), so every rank sees the same mailboxes
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        error = std::string("mmap of the halo segment failed: ") + std::strerror(errno);
+        return nullptr;
+    }
+
+    std::unique_ptr<ShmHaloTransport> t(new ShmHaloTransport());
+    t->m_base = base;
+    t->m_bytes = bytes;
+    t->m_maxCount = slotBytes / sizeof(float);
+    t->m_ranks = ranks;
+
+    Header* header = new (base) Header;
+    header->arrived.store(0);
+    header->generation.store(0);
+    for (int r = 0; r < ranks; r++) {
+        for (int s = 0; s < SIDES; s++) {
+            Mailbox* box = new (&t->mailbox(r, static_cast<HaloSide>(s))) Mailbox;
+            for (int k = 0; k < 2; k++) {
+                box->posted[k].store(0);
+                box->taken[k].store(0);
+            }
+        }
+    }
+    return t;
+#else
+    (void)ranks;
+    (void)maxCount;
+    error = "shared-memory halo transport needs mmap";
+    return nullptr;
+#endif
+}
+
+ShmHaloTransport::~ShmHaloTransport() {
+#ifdef WAVESIM_HAVE_MMAP
+    if (m_base) munmap(m_base, m_bytes);
+#endif
+}
+
+ShmHaloTransport::Mailbox& ShmHaloTransport::mailbox(int rank, HaloSide side) {
+    char* boxes = static_cast<char*>(m_base) + sizeof(Header);
+    return reinterpret_cast<Mailbox*>(boxes)[rank * SIDES + static_cast<int>(side)];
+}
+
+float* ShmHaloTransport::slot(int rank, HaloSide side, uint64_t step) {
+    char* data = static_cast<char*>(m_base) + sizeof(Header) + size_t(m_ranks) * SIDES * sizeof(Mailbox);
+    const size_t index = (size_t(rank) * SIDES + static_cast<int>(side)) * 2 + (step & 1);
+    return reinterpret_cast<float*>(data) + index * m_maxCount;
+}
+
+void ShmHaloTransport::send(int peer, HaloSide side, const float* data, size_t count, uint64_t step) {
+    Mailbox& box = mailbox(peer, side);
+    const int k = step & 1;
+    // The slot's previous message (two steps back) must have been read
+    waitFor([&] { return box.taken[k].load(std::memory_order_acquire) == box.posted[k].load(std::memory_order_relaxed); });
+    std::memcpy(slot(peer, side, step), data, count * sizeof(float));
+    box.posted[k].store(step, std::memory_order_release);
+}
+
+void ShmHaloTransport::receive(int /*peer*/, HaloSide side, float* data, size_t count, uint64_t step) {
+    Mailbox& box = mailbox(m_rank, side);
+    const int k = step & 1;
+    waitFor([&] { return box.posted[k].load(std::memory_order_acquire) == step; });
+    std::memcpy(data, slot(m_rank, side, step), count * sizeof(float));
+    box.taken[k].store(step, std::memory_order_release);
+}
+
+void ShmHaloTransport::barrier() {
+    Header* header = static_cast<Header*>(m_base);
+    const int generation = header->generation.load(std::memory_order_acquire);
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) == m_ranks - 1) {
+        header->arrived.store(0, std::memory_order_relaxed);
+        header->generation.store(generation + 1, std::memory_order_release);
+        return;
+    }
+    waitFor([&] { return header->generation.load(std::memory_order_acquire) != generation; });
+}
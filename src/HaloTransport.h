@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Moves halo rows and columns between the ranks of a decomposed domain. Ranks talk only to
+// their four neighbours, one message per side per step, so a backend only has to provide
+// ordered point-to-point channels plus a barrier. The shared-memory backend below runs on
+// a single host; an MPI backend maps send/receive onto MPI_Isend/MPI_Recv with the
+// channel as the tag.
+
+enum class HaloSide { NORTH, SOUTH, WEST, EAST, COUNT };
+
+HaloSide oppositeSide(HaloSide side);
+
+class HaloTransport {
+public:
+    virtual ~HaloTransport() = default;
+
+    virtual int rank() const = 0;
+    virtual int ranks() const = 0;
+
+    // Hands `peer` the halo it will read on its `side` for `step` (steps start at 1). Returns
+    // once the data is copied out; it only waits if the peer still holds this side's
+    // message from two steps ago.
+    virtual void send(int peer, HaloSide side, const float* data, size_t count, uint64_t step) = 0;
+    // Blocks until the halo for this rank's `side` at `step` has arrived from `peer`.
+    virtual void receive(int peer, HaloSide side, float* data, size_t count, uint64_t step) = 0;
+
+    virtual void barrier() = 0;
+};
+
+// Single-host transport over one shared mapping: a double-buffered single-producer,
+// single-consumer mailbox per (rank, side), synchronized with lock-free atomics. Create it
+// before fork(); every child then calls bind() with its rank.
+class ShmHaloTransport : public HaloTransport {
+public:
+    // `maxCount` is the longest halo (in floats) any rank sends. Returns nullptr with
+    // `error` set if the mapping fails.
+    static std::unique_ptr<ShmHaloTransport> create(int ranks, size_t maxCount, std::string& error);
+    ~ShmHaloTransport() override;
+
+    void bind(int rank) { m_rank = rank; }
+
+    int rank() const override { return m_rank; }
+    int ranks() const override { return m_ranks; }
+    void send(int peer, HaloSide side, const float* data, size_t count, uint64_t step) override;
+    void receive(int peer, HaloSide side, float* data, size_t count, uint64_t step) override;
+    void barrier() override;
+
+private:
+    struct Mailbox;
+    struct Header;
+
+    ShmHaloTransport() = default;
+    Mailbox& mailbox(int rank, HaloSide side);
+    float* slot(int rank, HaloSide side, uint64_t step);
+
+    void* m_base = nullptr;
+    size_t m_bytes = 0;
+    size_t m_maxCount = 0;
+    int m_ranks = 0;
+    int m_rank = 0;
+};
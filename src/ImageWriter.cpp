@@ -0,0 +1,163 @@
+#include "ImageWriter.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef WAVESIM_HAVE_ZLIB
+#include <zlib.h>
+
+namespace {
+
+// stb_image_write's hook for an external deflate; the result is freed with STBIW_FREE
+unsigned char* deflateForPng(unsigned char* data, int length, int* outLength, int /*quality*/) {
+    uLongf bytes = compressBound(static_cast<uLong>(length));
+    unsigned char* out = static_cast<unsigned char*>(std::malloc(bytes));
+    // Level 1: screenshots are mostly smooth gradients, which filtering already flattens
+    if (!out || compress2(out, &bytes, data, static_cast<uLong>(length), 1) != Z_OK) {
+        std::free(out);
+        return nullptr;
+    }
+    *outLength = static_cast<int>(bytes);
+    return out;
+}
+
+} // namespace
+
+#define STBIW_ZLIB_COMPRESS deflateForPng
+#endif
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#include "stb_image_write.h"
+
+bool writePng(const Image& image) {
+    if (image.width <= 0 || image.height <= 0 ||
+        image.pixels.size() < size_t(image.width) * image.height * image.channels) {
+        return false;
+    }
+    const int stride = image.width * image.channels;
+    // A negative stride walks bottom-up rows from the last one
+    const uint8_t* first = image.pixels.data();
+    if (image.bottomUp) first += size_t(image.height - 1) * stride;
+    return stbi_write_png(image.path.c_str(), image.width, image.height, image.channels, first,
+                          image.bottomUp ? -stride : stride) != 0;
+}
+
+bool writePpm(const Image& image) {
+    if (image.width <= 0 || image.height <= 0 ||
+        image.pixels.size() < size_t(image.width) * image.height * image.channels) {
+        return false;
+    }
+    std::ofstream out(image.path, std::ios::binary);
+    out << "P6\n" << image.width << " " << image.height << "\n255\n";
+    std::vector<uint8_t> row(size_t(image.width) * 3);
+    for (int y = 0; y < image.height; y++) {
+        const int source = image.bottomUp ? image.height - 1 - y : y;
+        const uint8_t* p = image.pixels.data() + size_t(source) * image.width * image.channels;
+        for (int x = 0; x < image.width; x++) {
+            for (int c = 0; c < 3; c++) row[size_t(x) * 3 + c] = p[size_t(x) * image.channels + c];
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(out);
+}
+
+bool writeImage(const Image& image) {
+    const std::string& path = image.path;
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".ppm") == 0) return writePpm(image);
+    return writePng(image);
+}
+
+bool Y4mWriter::open(const std::string& path, int width, int height, int fps, std::string& error) {
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+    m_planes.resize(size_t(width) * height * 3);
+    return static_cast<bool>(m_file);
+}
+
+bool Y4mWriter::write(const Image& image) {
+    if (image.width != m_width || image.height != m_height) return false;
+    const size_t plane = size_t(m_width) * m_height;
+    uint8_t* Y = m_planes.data();
+    uint8_t* U = Y + plane;
+    uint8_t* V = U + plane;
+    for (int y = 0; y < m_height; y++) {
+        const int source = image.bottomUp ? m_height - 1 - y : y;
+        const uint8_t* p = image.pixels.data() + size_t(source) * m_width * image.channels;
+        const size_t row = size_t(y) * m_width;
+        for (int x = 0; x < m_width; x++, p += image.channels) {
+            const int r = p[0], g = p[1], b = p[2];
+            Y[row + x] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            U[row + x] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            V[row + x] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    m_file << "FRAME\n";
+    m_file.write(reinterpret_cast<const char*>(m_planes.data()), m_planes.size());
+    return static_cast<bool>(m_file);
+}
+
+bool Y4mWriter::close() {
+    m_file.close();
+    return !m_file.fail();
+}
+
+ImageWriter::~ImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_threads) t.join();
+}
+
+void ImageWriter::submit(Image image) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(image));
+        if (m_threads.empty()) {
+            for (int i = 0; i < m_threadCount; i++) m_threads.emplace_back([this] { run(); });
+        }
+    }
+    m_wake.notify_one();
+}
+
+int ImageWriter::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<int>(m_queue.size()) + m_encoding;
+}
+
+std::vector<ImageResult> ImageWriter::finished() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ImageResult> results;
+    results.swap(m_results);
+    return results;
+}
+
+void ImageWriter::wait(int maxPending) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this, maxPending] { return static_cast<int>(m_queue.size()) + m_encoding <= maxPending; });
+}
+
+void ImageWriter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_closing || !m_queue.empty(); });
+        if (m_queue.empty()) break;
+        Image image = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_encoding++;
+        lock.unlock();
+        const bool ok = writeImage(image);
+        lock.lock();
+        m_encoding--;
+        m_results.push_back({ image.path, ok });
+        m_idle.notify_all();
+    }
+}
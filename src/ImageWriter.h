@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Background image encoding, so screenshots and frame dumps never wait on PNG compression.
+// PNGs are encoded with the bundled stb_image_write (using zlib's deflate when available,
+// which is several times faster than stb's own); PPM (binary P6) is written as is.
+
+struct Image {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int channels = 4;               // 8-bit RGB (3) or RGBA (4)
+    bool bottomUp = false;          // rows stored bottom row first (OpenGL readback order)
+    std::vector<uint8_t> pixels;
+};
+
+// Encodes `image` as a PNG at image.path.
+bool writePng(const Image& image);
+bool writePpm(const Image& image);
+// Picks the format from image.path's extension (.ppm, otherwise PNG).
+bool writeImage(const Image& image);
+
+struct ImageResult {
+    std::string path;
+    bool ok = false;
+};
+
+// A queue of images drained by `threads` encoder threads, started on first use. The
+// destructor finishes everything queued.
+class ImageWriter {
+public:
+    explicit ImageWriter(int threads = 2) : m_threadCount(threads < 1 ? 1 : threads) {}
+    ~ImageWriter();
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    void submit(Image image);
+    // Images queued or being encoded
+    int pending() const;
+    // Images finished since the last call, in completion order
+    std::vector<ImageResult> finished();
+    // Blocks until at most `maxPending` images are pending (throttles a fast producer)
+    void wait(int maxPending = 0);
+
+private:
+    void run();
+
+    int m_threadCount;
+    std::vector<std::thread> m_threads;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Image> m_queue;
+    int m_encoding = 0;
+    bool m_closing = false;
+    std::vector<ImageResult> m_results;
+};
+
+// A YUV4MPEG2 video (4:4:4, BT.601 limited range) that most players and ffmpeg read
+// directly. Frames are converted and appended in order on the calling thread; the
+// conversion is cheap next to PNG encoding.
+class Y4mWriter {
+public:
+    bool open(const std::string& path, int width, int height, int fps, std::string& error);
+    // `image` must match the size given to open()
+    bool write(const Image& image);
+    bool close();
+
+private:
+    std::ofstream m_file;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<uint8_t> m_planes;
+};
@@ -0,0 +1,147 @@
+#include "InputLatency.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+// Completed samples kept for the summaries and the trace
+const size_t MAX_SAMPLES = 4096;
+// Events still in flight; more means a stage is never reported (e.g. no GPU timing)
+const size_t MAX_OPEN = 4096;
+
+double stageStart(const LatencySample& s, int stage) {
+    return stage == 0 ? s.input : s.at[stage - 1];
+}
+
+} // namespace
+
+const char* latencyStageName(int stage) {
+    switch (stage) {
+        case LATENCY_APPLIED: return "queue";
+        case LATENCY_STEPPED: return "solve";
+        case LATENCY_UPLOADED: return "upload";
+        case LATENCY_SWAPPED: return "render";
+        case LATENCY_DISPLAYED: return "gpu";
+        default: return "total";
+    }
+}
+
+uint64_t LatencyTracker::input(double time) {
+    if (!enabled) return 0;
+    if (m_open.size() >= MAX_OPEN) m_open.pop_front();
+    Open o;
+    o.sample.id = m_nextId++;
+    o.sample.input = time;
+    m_open.push_back(o);
+    return o.sample.id;
+}
+
+void LatencyTracker::applied(uint64_t id, double time) {
+    if (id == 0) return;
+    for (auto it = m_open.rbegin(); it != m_open.rend(); ++it) {
+        if (it->sample.id != id) continue;
+        if (it->reached < LATENCY_APPLIED) {
+            it->sample.at[LATENCY_APPLIED] = time;
+            it->reached = LATENCY_APPLIED;
+        }
+        return;
+    }
+}
+
+void LatencyTracker::reached(int stage, double time) {
+    for (auto& o : m_open) {
+        if (o.reached < LATENCY_APPLIED) continue;
+        if (o.reached >= stage) continue;
+        // Stages an event skipped take no time
+        for (int s = o.reached + 1; s < stage; s++) o.sample.at[s] = o.sample.at[o.reached];
+        o.sample.at[stage] = time;
+        o.reached = stage;
+    }
+}
+
+uint64_t LatencyTracker::endFrame(double time) {
+    reached(LATENCY_SWAPPED, time);
+    m_frame++;
+    for (auto& o : m_open) {
+        if (o.reached == LATENCY_SWAPPED && o.frame == 0) o.frame = m_frame;
+    }
+    return m_frame;
+}
+
+void LatencyTracker::frameDisplayed(uint64_t frame, double time) {
+    size_t kept = 0;
+    for (size_t i = 0; i < m_open.size(); i++) {
+        Open& o = m_open[i];
+        if (o.frame != 0 && o.frame <= frame) {
+            // The GPU can finish before a swap that blocked on vsync returns
+            o.sample.at[LATENCY_DISPLAYED] = std::max(time, o.sample.at[LATENCY_SWAPPED]);
+            m_samples.push_back(o.sample);
+            if (m_samples.size() > MAX_SAMPLES) m_samples.pop_front();
+        } else {
+            m_open[kept++] = o;
+        }
+    }
+    m_open.resize(kept);
+}
+
+void LatencyTracker::reset() {
+    m_open.clear();
+    m_samples.clear();
+}
+
+LatencySummary LatencyTracker::summary(int stage) const {
+    LatencySummary r;
+    if (m_samples.empty()) return r;
+    std::vector<double> d;
+    d.reserve(m_samples.size());
+    for (const auto& s : m_samples) {
+        d.push_back(stage >= LATENCY_STAGES ? s.at[LATENCY_DISPLAYED] - s.input : s.at[stage] - stageStart(s, stage));
+    }
+    std::sort(d.begin(), d.end());
+    auto percentile = [&](double p) { return d[std::min(d.size() - 1, static_cast<size_t>(p * d.size()))]; };
+    r.count = static_cast<int>(d.size());
+    for (double v : d) r.mean += v;
+    r.mean /= d.size();
+    r.p50 = percentile(0.50);
+    r.p95 = percentile(0.95);
+    r.p99 = percentile(0.99);
+    r.max = d.back();
+    return r;
+}
+
+bool LatencyTracker::writeTrace(const std::string& path, std::string& error) const {
+    std::ofstream f(path);
+    if (!f) {
+        error = "cannot create " + path;
+        return false;
+    }
+    // Each event is an async track: the whole latency with the stages nested inside it
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char line[256];
+    auto slice = [&](const char* name, uint64_t id, double begin, double end) {
+        for (int edge = 0; edge < 2; edge++) {
+            std::snprintf(line, sizeof(line),
+                          "%s{\"name\":\"%s\",\"cat\":\"input\",\"ph\":\"%c\",\"id\":%llu,\"ts\":%.3f,\"pid\":1,\"tid\":1}",
+                          first ? "" : ",\n", name, edge == 0 ? 'b' : 'e', (unsigned long long)id,
+                          (edge == 0 ? begin : end) * 1e6);
+            f << line;
+            first = false;
+        }
+    };
+    for (const auto& s : m_samples) {
+        slice("input", s.id, s.input, s.at[LATENCY_DISPLAYED]);
+        for (int stage = 0; stage < LATENCY_STAGES; stage++) {
+            slice(latencyStageName(stage), s.id, stageStart(s, stage), s.at[stage]);
+        }
+    }
+    f << "\n]}\n";
+    if (!f) {
+        error = "failed to write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+// Input-to-photon latency of the app's pointer input, split into stages. Each event is
+// stamped in the GLFW callback and then at every stage boundary on its way to the screen:
+//
+//   queue    callback -> applied to the simulation (waits for its substep)
+//   solve    applied -> the solver substep that includes it finished
+//   upload   -> the field texture holding it was uploaded
+//   render   -> glfwSwapBuffers() returned for that frame
+//   gpu      -> the GPU executed past the swap (GL timestamp query, else a fence)
+//
+// An event applied after the frame's last substep skips the solve stage (zero length); it
+// is on screen before the solver advances it. Times are seconds on one clock (glfwGetTime()
+// in the app); the caller converts GPU times to it.
+
+enum LatencyStage {
+    LATENCY_APPLIED,
+    LATENCY_STEPPED,
+    LATENCY_UPLOADED,
+    LATENCY_SWAPPED,
+    LATENCY_DISPLAYED,
+    LATENCY_STAGES
+};
+
+// Stage names as above; LATENCY_STAGES names the total
+const char* latencyStageName(int stage);
+
+struct LatencySample {
+    uint64_t id = 0;
+    double input = 0.0;             // callback time
+    double at[LATENCY_STAGES] = {}; // time each stage ended
+};
+
+struct LatencySummary {
+    int count = 0;
+    double mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;  // seconds
+};
+
+class LatencyTracker {
+public:
+    bool enabled = false;
+
+    // A new input event; returns its id, or 0 when disabled
+    uint64_t input(double time);
+    void applied(uint64_t id, double time);
+    // Every applied event that has not reached `stage` yet reaches it now
+    void reached(int stage, double time);
+    // Events that reached LATENCY_SWAPPED join the returned frame number; frameDisplayed()
+    // completes them once the GPU time of that frame is known
+    uint64_t endFrame(double time);
+    void frameDisplayed(uint64_t frame, double time);
+    void reset();
+
+    // Stage durations (LATENCY_STAGES: input to display) over the retained samples
+    LatencySummary summary(int stage) const;
+    const std::deque<LatencySample>& samples() const { return m_samples; }
+    // Chrome trace event JSON (chrome://tracing, Perfetto): one async slice per event and
+    // stage, timestamps in microseconds of the tracker's clock
+    bool writeTrace(const std::string& path, std::string& error) const;
+
+private:
+    struct Open {
+        LatencySample sample;
+        int reached = -1;           // last stage reached
+        uint64_t frame = 0;
+    };
+
+    std::deque<Open> m_open;
+    std::deque<LatencySample> m_samples;
+    uint64_t m_nextId = 1;
+    uint64_t m_frame = 0;
+};
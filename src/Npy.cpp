@@ -0,0 +1,50 @@
+#include "Npy.h"
+
+#include <fstream>
+
+namespace {
+
+void writeHeader(std::ostream& f, const char* descr, const std::vector<size_t>& shape) {
+    std::string dims;
+    for (size_t d : shape) dims += std::to_string(d) + ",";
+    if (shape.size() > 1) dims.pop_back();  // (n,) for 1-D, (a, b) otherwise
+
+    std::string header = std::string("{'descr': '") + descr + "', 'fortran_order': False, 'shape': (" + dims + "), }";
+    // Magic (6) + version (2) + length (2) + header + '\n' must be a multiple of 64
+    const size_t total = 10 + header.size() + 1;
+    header.append((64 - total % 64) % 64, ' ');
+    header += '\n';
+
+    const uint16_t length = static_cast<uint16_t>(header.size());
+    f.write("\x93NUMPY\x01\x00", 8);
+    const char lengthBytes[2] = { static_cast<char>(length & 0xff), static_cast<char>(length >> 8) };
+    f.write(lengthBytes, 2);
+    f.write(header.data(), header.size());
+}
+
+bool writeArray(const std::string& path, const char* descr, const void* data, size_t elementSize,
+                const std::vector<size_t>& shape) {
+    size_t count = 1;
+    for (size_t d : shape) count *= d;
+
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    writeHeader(f, descr, shape);
+    f.write(static_cast<const char*>(data), count * elementSize);
+    return static_cast<bool>(f);
+}
+
+} // namespace
+
+bool writeNpy(const std::string& path, const float* data, const std::vector<size_t>& shape) {
+    return writeArray(path, "<f4", data, sizeof(float), shape);
+}
+
+bool writeNpy(const std::string& path, const uint8_t* data, const std::vector<size_t>& shape) {
+    return writeArray(path, "|u1", data, sizeof(uint8_t), shape);
+}
+
+bool writeNpyHeader(std::ostream& out, const std::vector<size_t>& shape) {
+    writeHeader(out, "<f4", shape);
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Minimal NumPy .npy (format 1.0) writer for exporting fields to analysis tools.
+
+// Writes a C-order float32 array with the given shape.
+bool writeNpy(const std::string& path, const float* data, const std::vector<size_t>& shape);
+// Writes a C-order uint8 array with the given shape.
+bool writeNpy(const std::string& path, const uint8_t* data, const std::vector<size_t>& shape);
+
+// Writes only the header of a C-order float32 array; the caller streams the data after it
+// (for arrays too large to hold in memory, such as frame stacks).
+bool writeNpyHeader(std::ostream& out, const std::vector<size_t>& shape);
@@ -0,0 +1,175 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+namespace {
+
+int openEvent(uint32_t type, uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (groupFd < 0) ? 1 : 0;  // the leader gates the whole group
+    attr.inherit = 1;                       // include worker threads spawned later
+    // User space only: this is what perf_event_paranoid <= 2 still permits.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+std::string readParanoid() {
+    std::ifstream f("/proc/sys/kernel/perf_event_paranoid");
+    std::string value;
+    if (f >> value) return value;
+    return "unknown";
+}
+
+} // namespace
+#endif
+
+PerfCounterGroup::PerfCounterGroup() {
+    for (int& fd : fds) fd = -1;
+
+#if defined(__linux__)
+    const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    fds[CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (fds[CYCLES] < 0) {
+        statusText = std::string("perf_event_open failed (") + std::strerror(errno) +
+                     "), perf_event_paranoid=" + readParanoid() + "; wall time only";
+        return;
+    }
+
+    const int leader = fds[CYCLES];
+    fds[INSTRUCTIONS] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+    fds[L1D_MISSES] = openEvent(PERF_TYPE_HW_CACHE, l1dReadMiss, leader);
+    fds[LLC_MISSES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, leader);
+    fds[STALLED_CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND, leader);
+
+    static const char* names[EVENT_COUNT] = { "cycles", "instructions", "L1D misses", "LLC misses", "stalled cycles" };
+    std::string missing;
+    for (int e = 0; e < EVENT_COUNT; e++) {
+        if (fds[e] < 0) {
+            missing += missing.empty() ? "" : ", ";
+            missing += names[e];
+        }
+    }
+    statusText = missing.empty() ? "all counters active" : "unsupported: " + missing;
+#else
+    statusText = "hardware counters need Linux perf_event; wall time only";
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+#if defined(__linux__)
+    for (int fd : fds) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+uint64_t PerfCounterGroup::readEvent(Event e) const {
+#if defined(__linux__)
+    uint64_t value = 0;
+    if (fds[e] >= 0 && read(fds[e], &value, sizeof(value)) == sizeof(value)) {
+        return value;
+    }
+#else
+    (void)e;
+#endif
+    return 0;
+}
+
+void PerfCounterGroup::start() {
+#if defined(__linux__)
+    if (available()) {
+        // The group runs continuously once enabled; samples are deltas of free-running counts.
+        if (!running) {
+            ioctl(fds[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            running = true;
+        }
+        for (int e = 0; e < EVENT_COUNT; e++) {
+            startValues[e] = readEvent(static_cast<Event>(e));
+        }
+    }
+#endif
+    startTime = std::chrono::steady_clock::now();
+}
+
+PerfSample PerfCounterGroup::stop() {
+    PerfSample s;
+    s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (available()) {
+        s.cycles = readEvent(CYCLES) - startValues[CYCLES];
+        s.instructions = readEvent(INSTRUCTIONS) - startValues[INSTRUCTIONS];
+        s.l1dMisses = readEvent(L1D_MISSES) - startValues[L1D_MISSES];
+        s.llcMisses = readEvent(LLC_MISSES) - startValues[LLC_MISSES];
+        s.stalledCycles = readEvent(STALLED_CYCLES) - startValues[STALLED_CYCLES];
+    }
+    return s;
+}
+
+int KernelProfiler::registerKernel(const std::string& name) {
+    for (size_t i = 0; i < stats.size(); i++) {
+        if (stats[i].name == name) return static_cast<int>(i);
+    }
+    KernelStats k;
+    k.name = name;
+    stats.push_back(k);
+    return static_cast<int>(stats.size() - 1);
+}
+
+void KernelProfiler::begin(int kernel) {
+    if (!enabled || active >= 0) return;  // kernels are not nested
+    active = kernel;
+    if (useCounters) {
+        counters.start();
+    } else {
+        beginTime = std::chrono::steady_clock::now();
+    }
+}
+
+void KernelProfiler::end(int kernel, uint64_t cells) {
+    if (active != kernel) return;
+    active = -1;
+
+    PerfSample s;
+    if (useCounters) {
+        s = counters.stop();
+    } else {
+        s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+    }
+
+    KernelStats& k = stats[kernel];
+    k.invocations++;
+    k.cells += cells;
+    k.total += s;
+}
+
+void KernelProfiler::reset() {
+    for (auto& k : stats) {
+        k.invocations = 0;
+        k.cells = 0;
+        k.total = PerfSample();
+    }
+}
+
+const KernelStats* KernelProfiler::find(const std::string& name) const {
+    for (const auto& k : stats) {
+        if (k.name == name) return &k;
+    }
+    return nullptr;
+}
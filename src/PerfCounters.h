@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Optional hardware performance counters (Linux perf_event_open).
+// On other platforms, or when the kernel refuses access (e.g. containers with a
+// restrictive perf_event_paranoid), everything still works but only wall time is
+// recorded and available() returns false.
+
+// Raw counter deltas captured around one kernel invocation.
+struct PerfSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t l1dMisses = 0;
+    uint64_t llcMisses = 0;
+    uint64_t stalledCycles = 0;
+    double seconds = 0.0;
+
+    PerfSample& operator+=(const PerfSample& o) {
+        cycles += o.cycles;
+        instructions += o.instructions;
+        l1dMisses += o.l1dMisses;
+        llcMisses += o.llcMisses;
+        stalledCycles += o.stalledCycles;
+        seconds += o.seconds;
+        return *this;
+    }
+};
+
+// A group of counters attached to the calling thread (and threads it spawns later).
+class PerfCounterGroup {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, STALLED_CYCLES, EVENT_COUNT };
+
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    // True if at least the cycle counter could be opened.
+    bool available() const { return fds[CYCLES] >= 0; }
+    // True if a specific event is being counted (some PMUs lack stalled cycles, etc.).
+    bool hasEvent(Event e) const { return fds[e] >= 0; }
+    // Human readable reason when counters are unavailable or partial.
+    const std::string& status() const { return statusText; }
+
+    void start();
+    PerfSample stop();
+
+private:
+    int fds[EVENT_COUNT];
+    uint64_t startValues[EVENT_COUNT] = {};
+    std::chrono::steady_clock::time_point startTime;
+    std::string statusText;
+    bool running = false;
+
+    uint64_t readEvent(Event e) const;
+};
+
+// Accumulated statistics for one named kernel.
+struct KernelStats {
+    std::string name;
+    uint64_t invocations = 0;
+    uint64_t cells = 0;         // cells touched across all invocations
+    PerfSample total;
+
+    double ipc() const { return total.cycles ? double(total.instructions) / double(total.cycles) : 0.0; }
+    double nsPerCell() const { return cells ? total.seconds * 1e9 / double(cells) : 0.0; }
+    double cellsPerSecond() const { return total.seconds > 0.0 ? double(cells) / total.seconds : 0.0; }
+    // DRAM traffic estimate: every last-level miss moves one 64-byte line.
+    double bytesPerCell() const { return cells ? double(total.llcMisses) * 64.0 / double(cells) : 0.0; }
+    double l1Mpki() const { return total.instructions ? double(total.l1dMisses) * 1000.0 / double(total.instructions) : 0.0; }
+    double llcMpki() const { return total.instructions ? double(total.llcMisses) * 1000.0 / double(total.instructions) : 0.0; }
+    double stalledFraction() const { return total.cycles ? double(total.stalledCycles) / double(total.cycles) : 0.0; }
+};
+
+// Per-kernel profiler used by the profiler panel and the benchmark runner.
+// Kernels are registered once and then measured with begin()/end() pairs.
+class KernelProfiler {
+public:
+    bool enabled = true;         // wall-time profiling
+    bool useCounters = true;     // hardware counters, when available
+
+    int registerKernel(const std::string& name);
+    void begin(int kernel);
+    void end(int kernel, uint64_t cells);
+    void reset();
+
+    const std::vector<KernelStats>& kernels() const { return stats; }
+    const KernelStats* find(const std::string& name) const;
+    bool countersAvailable() const { return counters.available(); }
+    const std::string& countersStatus() const { return counters.status(); }
+
+private:
+    PerfCounterGroup counters;
+    std::vector<KernelStats> stats;
+    std::chrono::steady_clock::time_point beginTime;
+    int active = -1;
+};
+
+// Scoped measurement helper: KernelScope scope(profiler, id, cells);
+class KernelScope {
+public:
+    KernelScope(KernelProfiler& p, int kernel, uint64_t cells) : profiler(p), id(kernel), cellCount(cells) {
+        profiler.begin(id);
+    }
+    ~KernelScope() { profiler.end(id, cellCount); }
+    KernelScope(const KernelScope&) = delete;
+    KernelScope& operator=(const KernelScope&) = delete;
+
+private:
+    KernelProfiler& profiler;
+    int id;
+    uint64_t cellCount;
+};
@@ -0,0 +1,432 @@
+#include "Recording.h"
+
+#include "Npy.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef WAVESIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const char MAGIC[8] = { 'W', 'S', 'R', 'E', 'C', '\0', '\0', '\0' };
+
+#ifdef WAVESIM_HAVE_ZLIB
+const bool DEFLATE = true;
+#else
+const bool DEFLATE = false;
+#endif
+
+// Band b of RECORDING_BANDS covers rows [bandRow(n, b), bandRow(n, b + 1))
+int bandRow(int size, int band) {
+    return static_cast<int>(int64_t(size) * band / RECORDING_BANDS);
+}
+
+// Deflates `raw` into `out` (level 1: the shuffled deltas are mostly runs of 0x00/0xff,
+// which cheap matching already finds). Without zlib the bytes are stored as they are.
+bool pack(const std::vector<char>& raw, std::vector<char>& out) {
+#ifdef WAVESIM_HAVE_ZLIB
+    uLongf bytes = compressBound(static_cast<uLong>(raw.size()));
+    out.resize(bytes);
+    if (compress2(reinterpret_cast<Bytef*>(out.data()), &bytes, reinterpret_cast<const Bytef*>(raw.data()),
+                  static_cast<uLong>(raw.size()), 1) != Z_OK) {
+        return false;
+    }
+    out.resize(bytes);
+#else
+    out = raw;
+#endif
+    return true;
+}
+
+bool unpack(const char* stored, size_t storedBytes, bool deflated, char* raw, size_t rawBytes) {
+    if (!deflated) {
+        if (storedBytes != rawBytes) return false;
+        std::memcpy(raw, stored, rawBytes);
+        return true;
+    }
+#ifdef WAVESIM_HAVE_ZLIB
+    uLongf bytes = static_cast<uLongf>(rawBytes);
+    return uncompress(reinterpret_cast<Bytef*>(raw), &bytes, reinterpret_cast<const Bytef*>(stored),
+                      static_cast<uLong>(storedBytes)) == Z_OK &&
+           bytes == rawBytes;
+#else
+    return false;
+#endif
+}
+
+int16_t quantize(float v, float inverseQuantum) {
+    float q = v * inverseQuantum;
+    // NaN fails both comparisons and lands on the lower bound
+    if (!(q >= -32767.0f)) q = -32767.0f;
+    if (q > 32767.0f) q = 32767.0f;
+    return static_cast<int16_t>(std::lrint(q));
+}
+
+} // namespace
+
+std::unique_ptr<FieldRecorder> FieldRecorder::create(const std::string& path, int size,
+                                                     const RecordingOptions& options, std::string& error) {
+    if (size < 3 || options.keyframeInterval < 1 || options.quantum <= 0.0f || options.maxQueued < 1) {
+        error = "invalid recording options";
+        return nullptr;
+    }
+    std::unique_ptr<FieldRecorder> r(new FieldRecorder());
+    r->m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!r->m_file) {
+        error = "cannot create " + path;
+        return nullptr;
+    }
+    r->m_path = path;
+    r->m_size = size;
+    r->m_options = options;
+
+    RecordingHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = RECORDING_VERSION;
+    header.size = static_cast<uint32_t>(size);
+    header.keyframeInterval = static_cast<uint32_t>(options.keyframeInterval);
+    header.every = static_cast<uint32_t>(std::max(1, options.every));
+    header.quantum = options.quantum;
+    r->m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    r->m_offset = sizeof(header);
+
+    r->m_previous.assign(size_t(size) * size, 0);
+    r->m_quantized.assign(size_t(size) * size, 0);
+    r->m_bands.resize(RECORDING_BANDS);
+    r->m_pool.reset(new ThreadPool(options.threads));
+    r->m_thread = std::thread([p = r.get()] { p->encodeLoop(); });
+    return r;
+}
+
+FieldRecorder::~FieldRecorder() {
+    std::string error;
+    if (m_thread.joinable()) close(error);
+}
+
+bool FieldRecorder::capture(const Simulation& sim, uint64_t step) {
+    if (sim.size != m_size) return false;
+    std::unique_ptr<Frame> frame;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closing) return false;
+        if (m_queue.size() >= size_t(m_options.maxQueued)) {
+            if (m_options.dropWhenBusy) {
+                m_dropped++;
+                return false;
+            }
+            m_space.wait(lock, [this] { return m_queue.size() < size_t(m_options.maxQueued); });
+        }
+        if (!m_free.empty()) {
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        } else {
+            frame.reset(new Frame());
+        }
+        frame->keyframe = m_captured++ % m_options.keyframeInterval == 0;
+    }
+
+    // The copy is the only work done on the solver's thread
+    const size_t cells = size_t(m_size) * m_size;
+    frame->u.resize(cells);
+    packRowMajor(sim, sim.u, frame->u.data());
+    if (frame->keyframe) {
+        frame->walls.resize(cells);
+        packRowMajor(sim, sim.walls, frame->walls.data());
+    }
+    frame->step = step;
+    frame->time = sim.time;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(frame));
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+void FieldRecorder::encodeLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_closing || !m_queue.empty(); });
+        if (m_queue.empty()) break;
+        std::unique_ptr<Frame> frame = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        const bool ok = encode(*frame);
+        lock.lock();
+        if (!ok && m_error.empty()) m_error = "failed to write " + m_path;
+        m_free.push_back(std::move(frame));
+        m_space.notify_one();
+    }
+}
+
+bool FieldRecorder::encode(Frame& frame) {
+    const int n = m_size;
+    const float inverseQuantum = 1.0f / m_options.quantum;
+    bool ok = true;
+    std::mutex failure;
+
+    auto bands = [&](int b0, int b1) {
+        std::vector<char> raw;
+        for (int b = b0; b < b1; b++) {
+            const size_t begin = size_t(bandRow(n, b)) * n;
+            const size_t cells = size_t(bandRow(n, b + 1)) * n - begin;
+            raw.resize(2 * cells);
+            for (size_t i = 0; i < cells; i++) {
+                const int16_t q = quantize(frame.u[begin + i], inverseQuantum);
+                // Wrapping subtraction; the decoder's wrapping addition undoes it exactly
+                const uint16_t d = frame.keyframe ? uint16_t(q) : uint16_t(uint16_t(q) - uint16_t(m_previous[begin + i]));
+                m_quantized[begin + i] = q;
+                raw[i] = static_cast<char>(d & 0xff);
+                raw[cells + i] = static_cast<char>(d >> 8);
+            }
+            if (!pack(raw, m_bands[b])) {
+                std::lock_guard<std::mutex> lock(failure);
+                ok = false;
+            }
+        }
+    };
+    m_pool->parallelFor(0, RECORDING_BANDS, bands);
+
+    std::vector<char> walls;
+    if (frame.keyframe) {
+        std::vector<char> bits((size_t(n) * n + 7) / 8, 0);
+        for (size_t i = 0; i < frame.walls.size(); i++) {
+            if (frame.walls[i]) bits[i >> 3] |= static_cast<char>(1 << (i & 7));
+        }
+        ok = pack(bits, walls) && ok;
+    }
+    if (!ok) return false;
+
+    RecordingFrameHeader header = {};
+    header.magic = RECORDING_FRAME_MAGIC;
+    header.flags = (frame.keyframe ? uint32_t(RECORDING_KEYFRAME) : 0u) | (DEFLATE ? uint32_t(RECORDING_DEFLATED) : 0u);
+    header.step = frame.step;
+    header.time = frame.time;
+    header.wallBytes = static_cast<uint32_t>(walls.size());
+    uint32_t bandBytes[RECORDING_BANDS];
+    uint64_t bytes = sizeof(header) + sizeof(bandBytes) + walls.size();
+    for (int b = 0; b < RECORDING_BANDS; b++) {
+        bandBytes[b] = static_cast<uint32_t>(m_bands[b].size());
+        bytes += m_bands[b].size();
+    }
+
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.write(reinterpret_cast<const char*>(bandBytes), sizeof(bandBytes));
+    for (const auto& band : m_bands) m_file.write(band.data(), band.size());
+    m_file.write(walls.data(), walls.size());
+    if (!m_file) return false;
+    // Only a frame on disk may be the reference for the next delta
+    m_previous.swap(m_quantized);
+
+    m_index.push_back({ m_offset, frame.step, frame.time, frame.keyframe ? 1u : 0u });
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_offset += bytes;
+    return true;
+}
+
+bool FieldRecorder::close(std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_wake.notify_all();
+    m_space.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+    if (!m_file.is_open()) return true;
+
+    RecordingHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = RECORDING_VERSION;
+    header.size = static_cast<uint32_t>(m_size);
+    header.keyframeInterval = static_cast<uint32_t>(m_options.keyframeInterval);
+    header.every = static_cast<uint32_t>(std::max(1, m_options.every));
+    header.quantum = m_options.quantum;
+    header.frameCount = static_cast<uint32_t>(m_index.size());
+    header.indexOffset = m_offset;
+    m_file.write(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(RecordingFrameInfo));
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.close();
+    if (!m_file && m_error.empty()) m_error = "failed to write " + m_path;
+    if (m_error.empty()) return true;
+    error = m_error;
+    return false;
+}
+
+int FieldRecorder::framesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<int>(m_index.size());
+}
+
+int FieldRecorder::framesDropped() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+uint64_t FieldRecorder::bytesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_offset;
+}
+
+std::unique_ptr<RecordingReader> RecordingReader::open(const std::string& path, std::string& error) {
+    std::unique_ptr<RecordingReader> r(new RecordingReader());
+    r->m_file.open(path, std::ios::binary);
+    if (!r->m_file) {
+        error = "cannot open " + path;
+        return nullptr;
+    }
+    RecordingHeader& h = r->m_header;
+    if (!r->m_file.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a recording";
+        return nullptr;
+    }
+    if (h.version != RECORDING_VERSION || h.size < 3 || h.quantum <= 0.0f) {
+        error = path + " is not a version " + std::to_string(RECORDING_VERSION) + " recording";
+        return nullptr;
+    }
+    r->m_file.seekg(0, std::ios::end);
+    const uint64_t fileBytes = static_cast<uint64_t>(r->m_file.tellg());
+
+    if (h.indexOffset != 0 && h.indexOffset + uint64_t(h.frameCount) * sizeof(RecordingFrameInfo) <= fileBytes) {
+        r->m_index.resize(h.frameCount);
+        r->m_file.seekg(static_cast<std::streamoff>(h.indexOffset));
+        r->m_file.read(reinterpret_cast<char*>(r->m_index.data()), r->m_index.size() * sizeof(RecordingFrameInfo));
+    } else {
+        // Never closed (e.g. the recording process crashed): walk the frame headers and
+        // keep every frame that was written completely
+        uint64_t offset = sizeof(RecordingHeader);
+        RecordingFrameHeader fh;
+        uint32_t bandBytes[RECORDING_BANDS];
+        while (r->m_file.seekg(static_cast<std::streamoff>(offset)) &&
+               r->m_file.read(reinterpret_cast<char*>(&fh), sizeof(fh)) &&
+               r->m_file.read(reinterpret_cast<char*>(bandBytes), sizeof(bandBytes)) &&
+               fh.magic == RECORDING_FRAME_MAGIC) {
+            uint64_t bytes = sizeof(fh) + sizeof(bandBytes) + fh.wallBytes;
+            for (uint32_t b : bandBytes) bytes += b;
+            if (offset + bytes > fileBytes) break;
+            r->m_index.push_back({ offset, fh.step, fh.time, fh.flags & RECORDING_KEYFRAME });
+            offset += bytes;
+        }
+    }
+    r->m_file.clear();
+    if (!r->m_index.empty() && !r->m_index[0].keyframe) {
+        error = path + " does not start with a keyframe";
+        return nullptr;
+    }
+    return r;
+}
+
+bool RecordingReader::decode(int index, bool wantWalls, std::string& error) {
+    const int n = size();
+    const size_t cells = size_t(n) * n;
+    const RecordingFrameInfo& info = m_index[index];
+
+    RecordingFrameHeader fh;
+    uint32_t bandBytes[RECORDING_BANDS];
+    m_file.seekg(static_cast<std::streamoff>(info.offset));
+    if (!m_file.read(reinterpret_cast<char*>(&fh), sizeof(fh)) ||
+        !m_file.read(reinterpret_cast<char*>(bandBytes), sizeof(bandBytes)) || fh.magic != RECORDING_FRAME_MAGIC) {
+        error = "corrupt frame " + std::to_string(index);
+        return false;
+    }
+    size_t stored = fh.wallBytes;
+    for (uint32_t b : bandBytes) stored += b;
+    m_stored.resize(stored);
+    if (!m_file.read(m_stored.data(), stored)) {
+        error = "truncated frame " + std::to_string(index);
+        return false;
+    }
+
+    const bool keyframe = fh.flags & RECORDING_KEYFRAME;
+    const bool deflated = fh.flags & RECORDING_DEFLATED;
+    m_current.resize(cells);
+    const char* p = m_stored.data();
+    for (int b = 0; b < RECORDING_BANDS; b++) {
+        const size_t begin = size_t(bandRow(n, b)) * n;
+        const size_t count = size_t(bandRow(n, b + 1)) * n - begin;
+        m_raw.resize(2 * count);
+        if (!unpack(p, bandBytes[b], deflated, m_raw.data(), m_raw.size())) {
+            error = deflated && !DEFLATE ? "recording is compressed and this build has no zlib"
+                                                    : "corrupt frame " + std::to_string(index);
+            return false;
+        }
+        p += bandBytes[b];
+        for (size_t i = 0; i < count; i++) {
+            const uint16_t d = uint16_t(uint8_t(m_raw[i])) | uint16_t(uint8_t(m_raw[count + i]) << 8);
+            m_current[begin + i] = keyframe ? int16_t(d) : int16_t(uint16_t(m_current[begin + i]) + d);
+        }
+    }
+    if (keyframe && wantWalls) {
+        std::vector<char> bits((cells + 7) / 8);
+        if (!unpack(p, fh.wallBytes, deflated, bits.data(), bits.size())) {
+            error = "corrupt walls in frame " + std::to_string(index);
+            return false;
+        }
+        m_walls.resize(cells);
+        for (size_t i = 0; i < cells; i++) m_walls[i] = (bits[i >> 3] >> (i & 7)) & 1;
+        m_wallsKey = index;
+    }
+    m_decoded = index;
+    return true;
+}
+
+bool RecordingReader::readFrame(int index, float* u, uint8_t* walls, std::string& error) {
+    if (index < 0 || index >= frameCount()) {
+        error = "frame " + std::to_string(index) + " out of range";
+        return false;
+    }
+    int key = index;
+    while (!m_index[key].keyframe) key--;
+    // Continue from the last decoded frame if it lies between the keyframe and the target,
+    // unless walls are wanted and those held are not that keyframe's (frames decoded
+    // without walls leave them as they were)
+    int start = key;
+    if (m_decoded >= key && m_decoded <= index) start = m_decoded + 1;
+    if (walls && m_wallsKey != key) start = key;
+    for (int f = start; f <= index; f++) {
+        if (!decode(f, walls != nullptr, error)) {
+            m_decoded = -1;
+            return false;
+        }
+    }
+
+    const size_t cells = size_t(size()) * size();
+    const float quantum = m_header.quantum;
+    for (size_t i = 0; i < cells; i++) u[i] = m_current[i] * quantum;
+    if (walls) std::memcpy(walls, m_walls.data(), cells);
+    return true;
+}
+
+bool exportRecordingNpy(RecordingReader& reader, const std::string& path, int first, int last, int stride,
+                        std::string& error) {
+    first = std::max(first, 0);
+    last = std::min(last, reader.frameCount() - 1);
+    stride = std::max(stride, 1);
+    if (last < first) {
+        error = "no frames to export";
+        return false;
+    }
+    const size_t frames = size_t(last - first) / stride + 1;
+    const size_t n = size_t(reader.size());
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out || !writeNpyHeader(out, { frames, n, n })) {
+        error = "cannot write " + path;
+        return false;
+    }
+    std::vector<float> frame(n * n);
+    for (int f = first; f <= last; f += stride) {
+        if (!reader.readFrame(f, frame.data(), nullptr, error)) return false;
+        out.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(float));
+    }
+    if (!out) {
+        error = "failed to write " + path;
+        return false;
+    }
+    return true;
+}
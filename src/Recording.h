@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ThreadPool;
+
+// Streaming recordings of the displacement field (.wsrec) for offline analysis and video.
+//
+// Each frame is quantized to 16-bit steps of `quantum`, delta-coded against the previous
+// frame (keyframes store the values themselves) and split into RECORDING_BANDS row bands
+// that are byte-shuffled (low bytes, then high bytes) and deflated independently on a
+// thread pool. Quantized values are reproduced exactly, so deltas never drift. Keyframes
+// also carry the wall mask.
+//
+// File layout (little endian): a RecordingHeader, then frames, each a RecordingFrameHeader
+// followed by the band sizes, the bands and the walls. close() appends a seek index of
+// RecordingFrameInfo and patches its offset into the header; a recording that was never
+// closed is indexed by scanning the frame headers instead.
+
+const uint32_t RECORDING_VERSION = 1;
+const int RECORDING_BANDS = 16;
+
+struct RecordingHeader {
+    char magic[8];                  // "WSREC\0\0\0"
+    uint32_t version;
+    uint32_t size;
+    uint32_t keyframeInterval;
+    uint32_t every;                 // solver steps between frames (informational)
+    float quantum;
+    uint32_t frameCount;            // 0 until closed
+    uint64_t indexOffset;           // 0 until closed
+};
+
+enum RecordingFrameFlags : uint32_t {
+    RECORDING_KEYFRAME = 1,
+    RECORDING_DEFLATED = 2,         // bands and walls are deflated (else raw)
+};
+
+struct RecordingFrameHeader {
+    uint32_t magic;                 // RECORDING_FRAME_MAGIC
+    uint32_t flags;                 // RecordingFrameFlags
+    uint64_t step;
+    float time;
+    uint32_t wallBytes;             // stored wall mask bytes (keyframes only)
+};
+
+const uint32_t RECORDING_FRAME_MAGIC = 0x52465357;  // "WSFR"
+
+struct RecordingFrameInfo {
+    uint64_t offset;                // of the frame header
+    uint64_t step;
+    float time;
+    uint32_t keyframe;
+};
+
+struct RecordingOptions {
+    int every = 1;                  // solver steps per frame (recorded in the header)
+    int keyframeInterval = 30;      // frames per keyframe; bounds the work of a seek
+    float quantum = 1.0f / 1024.0f; // values clamp at +-32767 quanta (+-32 by default)
+    int threads = 0;                // encoder threads (0: hardware concurrency)
+    int maxQueued = 8;              // frames waiting for the encoder
+    bool dropWhenBusy = true;       // full queue: drop the frame (true) or wait (false)
+};
+
+class FieldRecorder {
+public:
+    static std::unique_ptr<FieldRecorder> create(const std::string& path, int size, const RecordingOptions& options,
+                                                 std::string& error);
+    ~FieldRecorder();
+    FieldRecorder(const FieldRecorder&) = delete;
+    FieldRecorder& operator=(const FieldRecorder&) = delete;
+
+    // Copies sim.u (and the walls, for a keyframe) for the encoder. With dropWhenBusy the
+    // solver never waits on encoding: a full queue drops the frame and returns false.
+    bool capture(const Simulation& sim, uint64_t step);
+    // Encodes what is queued, writes the seek index and closes the file.
+    bool close(std::string& error);
+
+    int framesWritten() const;
+    int framesDropped() const;
+    uint64_t bytesWritten() const;
+    const std::string& path() const { return m_path; }
+
+private:
+    struct Frame {
+        std::vector<float> u;
+        std::vector<uint8_t> walls;     // keyframes only
+        bool keyframe = false;
+        uint64_t step = 0;
+        float time = 0.0f;
+    };
+
+    FieldRecorder() = default;
+    void encodeLoop();
+    bool encode(Frame& frame);
+
+    std::string m_path;
+    int m_size = 0;
+    RecordingOptions m_options;
+    std::ofstream m_file;
+    std::unique_ptr<ThreadPool> m_pool;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_space;
+    std::deque<std::unique_ptr<Frame>> m_queue;
+    std::vector<std::unique_ptr<Frame>> m_free;
+    bool m_closing = false;
+    int m_captured = 0;             // frames accepted (decides keyframes)
+    int m_dropped = 0;
+    std::string m_error;
+
+    // Encoder thread only (counters read under m_mutex)
+    std::vector<int16_t> m_previous;
+    std::vector<int16_t> m_quantized;   // the frame being encoded; becomes m_previous once written
+    std::vector<std::vector<char>> m_bands;
+    std::vector<RecordingFrameInfo> m_index;
+    uint64_t m_offset = 0;
+};
+
+class RecordingReader {
+public:
+    static std::unique_ptr<RecordingReader> open(const std::string& path, std::string& error);
+
+    int size() const { return static_cast<int>(m_header.size); }
+    int frameCount() const { return static_cast<int>(m_index.size()); }
+    const RecordingHeader& header() const { return m_header; }
+    const RecordingFrameInfo& frame(int index) const { return m_index[index]; }
+
+    // Decodes frame `index` into dense size x size arrays (`walls` may be null). Seeks to
+    // the nearest keyframe, or continues from the last decoded frame when that is closer.
+    bool readFrame(int index, float* u, uint8_t* walls, std::string& error);
+
+private:
+    RecordingReader() = default;
+    bool decode(int index, bool wantWalls, std::string& error);
+
+    std::ifstream m_file;
+    RecordingHeader m_header = {};
+    std::vector<RecordingFrameInfo> m_index;
+    std::vector<int16_t> m_current;  // quantized values of frame m_decoded
+    std::vector<uint8_t> m_walls;    // walls of keyframe m_wallsKey
+    int m_wallsKey = -1;
+    int m_decoded = -1;
+    std::vector<char> m_stored, m_raw;
+};
+
+// Writes frames [first, last] (every `stride`-th) as one float32 .npy of shape
+// (frames, size, size), streaming frame by frame.
+bool exportRecordingNpy(RecordingReader& reader, const std::string& path, int first, int last, int stride,
+                        std::string& error);
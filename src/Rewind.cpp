@@ -0,0 +1,265 @@
+#include "Rewind.h"
+
+#include <cstring>
+
+#ifdef WAVESIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001b3ull;
+}
+
+uint32_t floatBits(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+// The physics and sources the next steps depend on; cheap enough to take every step. The
+// walls are left out: hashing them costs a pass over the grid per step, and their edits
+// are reported with markEdited() instead.
+uint64_t sceneSignature(const Simulation& sim) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = mix(h, floatBits(sim.waveSpeed));
+    h = mix(h, floatBits(sim.damping));
+    h = mix(h, floatBits(sim.wallReflectivity));
+    const SourceStore& sources = sim.sources;
+    for (size_t i = 0; i < sources.size(); i++) {
+        h = mix(h, floatBits(sources.x(i)) | uint64_t(floatBits(sources.y(i))) << 32);
+        h = mix(h, floatBits(sources.frequency(i)) | uint64_t(floatBits(sources.amplitude(i))) << 32);
+        h = mix(h, sources.active(i));
+    }
+    return h;
+}
+
+} // namespace
+
+RewindBuffer::RewindBuffer(const RewindOptions& options) : m_options(options) {
+#ifdef WAVESIM_HAVE_ZLIB
+    m_thread = std::thread([this] { compressLoop(); });
+#endif
+}
+
+RewindBuffer::~RewindBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void RewindBuffer::setOptions(const RewindOptions& options) {
+    m_options = options;
+    m_options.checkpointInterval = std::max(1, m_options.checkpointInterval);
+    evict();
+}
+
+void RewindBuffer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_checkpoints.clear();
+    m_position = m_end = 0;
+    m_edited = false;
+}
+
+uint64_t RewindBuffer::firstStep() const {
+    return m_checkpoints.empty() ? 0 : m_checkpoints.front()->step;
+}
+
+size_t RewindBuffer::bytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    for (const auto& c : m_checkpoints) {
+        total += c->data.size() + (c->edges.size() + c->dts.size()) * sizeof(float);
+    }
+    return total;
+}
+
+const RewindBuffer::Checkpoint* RewindBuffer::containing(uint64_t step) const {
+    for (auto it = m_checkpoints.rbegin(); it != m_checkpoints.rend(); ++it) {
+        if ((*it)->step <= step) return it->get();
+    }
+    return nullptr;
+}
+
+float RewindBuffer::timeAt(uint64_t step) const {
+    const Checkpoint* c = containing(step);
+    if (!c) return 0.0f;
+    // Summed in the order the solver advanced sim.time
+    float time = c->time;
+    for (uint64_t s = c->step; s < step && s - c->step < c->dts.size(); s++) time += c->dts[s - c->step];
+    return time;
+}
+
+void RewindBuffer::beforeStep(const Simulation& sim, float dt) {
+    if (sim.size != m_size || sim.layout != m_layout) {
+        clear();
+        m_size = sim.size;
+        m_layout = sim.layout;
+    }
+    if (m_position < m_end) {
+        // Resuming from a rewound state: the old future is gone
+        while (!m_checkpoints.empty() && m_checkpoints.back()->step > m_position) m_checkpoints.pop_back();
+        if (!m_checkpoints.empty()) m_checkpoints.back()->dts.resize(m_position - m_checkpoints.back()->step);
+        m_end = m_position;
+    }
+
+    const uint64_t signature = sceneSignature(sim);
+    if (m_checkpoints.empty() || m_edited || signature != m_checkpoints.back()->signature ||
+        m_checkpoints.back()->dts.size() >= size_t(m_options.checkpointInterval)) {
+        push(sim, signature);
+    }
+    m_checkpoints.back()->dts.push_back(dt);
+    m_end = ++m_position;
+    m_edited = false;
+}
+
+void RewindBuffer::push(const Simulation& sim, uint64_t signature) {
+    // An edit at the step of the newest checkpoint replaces it
+    if (!m_checkpoints.empty() && m_checkpoints.back()->step == m_position) m_checkpoints.pop_back();
+
+    auto c = std::make_shared<Checkpoint>();
+    c->step = m_position;
+    c->signature = signature;
+    c->time = sim.time;
+    c->sources = sim.sources;
+    c->waveSpeed = sim.waveSpeed;
+    c->damping = sim.damping;
+    c->wallReflectivity = sim.wallReflectivity;
+
+    const int n = sim.size;
+    c->edges.resize(size_t(4) * n);
+    for (int i = 0; i < n; i++) {
+        c->edges[i] = sim.u_prev2[sim.index(i, 0)];
+        c->edges[n + i] = sim.u_prev2[sim.index(i, n - 1)];
+        c->edges[2 * n + i] = sim.u_prev2[sim.index(0, i)];
+        c->edges[3 * n + i] = sim.u_prev2[sim.index(n - 1, i)];
+    }
+
+    // Byte planes: the four bytes of u_prev, then of u ^ u_prev, then the walls
+    const size_t cells = sim.fieldCells();
+    c->data.resize(9 * cells);
+    char* planes = c->data.data();
+    for (size_t i = 0; i < cells; i++) {
+        const uint32_t prev = floatBits(sim.u_prev[i]);
+        const uint32_t delta = floatBits(sim.u[i]) ^ prev;
+        for (int b = 0; b < 4; b++) {
+            planes[b * cells + i] = static_cast<char>(prev >> (8 * b));
+            planes[(4 + b) * cells + i] = static_cast<char>(delta >> (8 * b));
+        }
+    }
+    std::memcpy(planes + 8 * cells, sim.walls.data(), cells);
+    c->rawBytes = c->data.size();
+
+    m_checkpoints.push_back(c);
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back(c);
+        }
+        m_wake.notify_one();
+    }
+    evict();
+}
+
+void RewindBuffer::evict() {
+    while (m_checkpoints.size() > 1 && bytes() > m_options.budgetBytes) m_checkpoints.pop_front();
+}
+
+void RewindBuffer::restore(const Checkpoint& c, Simulation& sim) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const char* planes = c.data.data();
+#ifdef WAVESIM_HAVE_ZLIB
+    if (c.deflated) {
+        m_scratch.resize(c.rawBytes);
+        uLongf length = static_cast<uLongf>(c.rawBytes);
+        uncompress(reinterpret_cast<Bytef*>(m_scratch.data()), &length, reinterpret_cast<const Bytef*>(c.data.data()),
+                   static_cast<uLong>(c.data.size()));
+        planes = m_scratch.data();
+    }
+#endif
+
+    const size_t cells = sim.fieldCells();
+    for (size_t i = 0; i < cells; i++) {
+        uint32_t prev = 0, delta = 0;
+        for (int b = 0; b < 4; b++) {
+            prev |= uint32_t(uint8_t(planes[b * cells + i])) << (8 * b);
+            delta |= uint32_t(uint8_t(planes[(4 + b) * cells + i])) << (8 * b);
+        }
+        const uint32_t current = prev ^ delta;
+        std::memcpy(&sim.u_prev[i], &prev, sizeof(float));
+        std::memcpy(&sim.u[i], &current, sizeof(float));
+    }
+    std::memcpy(sim.walls.data(), planes + 8 * cells, cells);
+
+    // The interior of u_prev2 is written before it is read again
+    const int n = sim.size;
+    std::fill(sim.u_prev2.begin(), sim.u_prev2.end(), 0.0f);
+    for (int i = 0; i < n; i++) {
+        sim.u_prev2[sim.index(i, 0)] = c.edges[i];
+        sim.u_prev2[sim.index(i, n - 1)] = c.edges[n + i];
+        sim.u_prev2[sim.index(0, i)] = c.edges[2 * n + i];
+        sim.u_prev2[sim.index(n - 1, i)] = c.edges[3 * n + i];
+    }
+
+    sim.time = c.time;
+    sim.sources = c.sources;
+    sim.waveSpeed = c.waveSpeed;
+    sim.damping = c.damping;
+    sim.wallReflectivity = c.wallReflectivity;
+}
+
+bool RewindBuffer::seek(uint64_t step, Simulation& sim, const SolverOptions& solver, std::string& error) {
+    if (m_checkpoints.empty() || step < firstStep() || step > m_end) {
+        error = "step " + std::to_string(step) + " is not in the history";
+        return false;
+    }
+    if (sim.size != m_size || sim.layout != m_layout) {
+        error = "the simulation was resized since the history was recorded";
+        return false;
+    }
+    const Checkpoint* c = containing(step);
+    uint64_t from = m_position;
+    // Edits or moved sources since (while paused) also rule out stepping forward
+    if (m_edited || m_position < c->step || m_position > step || sceneSignature(sim) != c->signature) {
+        restore(*c, sim);
+        from = c->step;
+    }
+    for (uint64_t s = from; s < step; s++) stepSimulation(sim, c->dts[s - c->step], 1, solver);
+    m_position = step;
+    m_edited = false;
+    return true;
+}
+
+void RewindBuffer::compressLoop() {
+#ifdef WAVESIM_HAVE_ZLIB
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_closing || !m_pending.empty(); });
+        if (m_closing) break;
+        std::shared_ptr<Checkpoint> c = std::move(m_pending.front());
+        m_pending.pop_front();
+        lock.unlock();
+
+        // Only this thread replaces the data, so it can be read without the lock
+        uLongf bytes = compressBound(static_cast<uLong>(c->rawBytes));
+        std::vector<char> packed(bytes);
+        const bool ok = compress2(reinterpret_cast<Bytef*>(packed.data()), &bytes,
+                                  reinterpret_cast<const Bytef*>(c->data.data()), static_cast<uLong>(c->rawBytes),
+                                  1) == Z_OK &&
+                        bytes < c->rawBytes;
+        packed.resize(bytes);
+        packed.shrink_to_fit();
+
+        lock.lock();
+        if (ok) {
+            c->data.swap(packed);
+            c->deflated = true;
+        }
+    }
+#endif
+}
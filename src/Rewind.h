@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Simulation.h"
+#include "Solver.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// In-memory history of a running simulation for scrubbing back through recent steps.
+//
+// The buffer keeps a checkpoint every `checkpointInterval` steps plus the dt of every step
+// since. A checkpoint holds what leapfrog needs to restart: u_prev, u (stored as its XOR
+// with u_prev, which zeroes the high bytes where the field changes slowly), u_prev2's edge
+// ring (see Snapshot.h) and the walls, in the simulation's own layout, byte-shuffled and
+// deflated by a background thread when built with zlib. Any other step is reconstructed by
+// re-simulating from the checkpoint before it, which is bit-exact because the kernels are.
+//
+// The interval trades memory for recompute: a seek replays up to interval - 1 steps. When
+// the checkpoints outgrow `budgetBytes`, the oldest are dropped. Changing the sources or the
+// physics starts a new checkpoint on its own; edits to the walls or the field itself (wall
+// strokes, ripples, clearing) must be reported with markEdited().
+
+struct RewindOptions {
+    size_t budgetBytes = size_t(256) << 20;
+    int checkpointInterval = 60;    // steps between checkpoints
+};
+
+class RewindBuffer {
+public:
+    explicit RewindBuffer(const RewindOptions& options = RewindOptions());
+    ~RewindBuffer();
+    RewindBuffer(const RewindBuffer&) = delete;
+    RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+    // Applies new limits, dropping the oldest checkpoints if the budget shrank
+    void setOptions(const RewindOptions& options);
+    const RewindOptions& options() const { return m_options; }
+
+    // Call before every solver step with the dt it will take. If the simulation was moved
+    // back with seek(), the history after that point is discarded first.
+    void beforeStep(const Simulation& sim, float dt);
+    // The simulation was changed in a way that beforeStep() cannot see
+    void markEdited() { m_edited = true; }
+    void clear();
+
+    bool empty() const { return m_checkpoints.empty(); }
+    uint64_t firstStep() const;
+    uint64_t lastStep() const { return m_end; }
+    uint64_t position() const { return m_position; }
+    float timeAt(uint64_t step) const;
+    int checkpointCount() const { return static_cast<int>(m_checkpoints.size()); }
+    size_t bytes() const;
+
+    // Puts `sim` in its state at `step` (firstStep() <= step <= lastStep()). Steps forward
+    // from the current position when that is on the way, otherwise restores the checkpoint
+    // before `step` and replays.
+    bool seek(uint64_t step, Simulation& sim, const SolverOptions& solver, std::string& error);
+
+private:
+    struct Checkpoint {
+        uint64_t step = 0;
+        uint64_t signature = 0;
+        float time = 0.0f;
+        SourceStore sources;
+        float waveSpeed = 0.0f, damping = 0.0f, wallReflectivity = 0.0f;
+        std::vector<float> edges;       // u_prev2: rows 0 and n-1, then columns 0 and n-1
+        std::vector<char> data;         // shuffled u_prev, u ^ u_prev, then walls
+        size_t rawBytes = 0;
+        bool deflated = false;
+        std::vector<float> dts;         // steps taken from here
+    };
+
+    void push(const Simulation& sim, uint64_t signature);
+    void restore(const Checkpoint& checkpoint, Simulation& sim);
+    void evict();
+    void compressLoop();
+    const Checkpoint* containing(uint64_t step) const;
+
+    RewindOptions m_options;
+    int m_size = 0;
+    FieldLayout m_layout = FieldLayout::ROW_MAJOR;
+    std::deque<std::shared_ptr<Checkpoint>> m_checkpoints;
+    uint64_t m_position = 0;        // step the simulation is at
+    uint64_t m_end = 0;             // newest step recorded
+    bool m_edited = false;
+    std::vector<char> m_scratch;
+
+    // Checkpoints waiting to be deflated; m_mutex also guards their data
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::shared_ptr<Checkpoint>> m_pending;
+    bool m_closing = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,706 @@
+#include "Scene.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WAVESIM_HAVE_MMAP 1
+#endif
+
+namespace {
+
+// The stock presets. Straight walls are grown by `pad`, the margin the 5x5 wall brush used to
+// leave around them.
+struct BuiltinScene {
+    const char* name;
+    const char* text;
+};
+
+const BuiltinScene BUILTIN_SCENES[] = {
+    { "Double Slit", R"(
+set pad 2.5c
+set slitSeparation 0.23
+source 0.25 0.8 5 2
+source 0.75 0.8 5 2
+slits 0.1-$pad 0.45-$pad 0.9+$pad 0.55+$pad 2 $slitSeparation 0.035-$pad
+)" },
+    { "Ripple Tank", R"(
+source 0.5 0.5 3 2
+)" },
+    { "Interference", R"(
+source 0.3 0.5 4 1.8
+source 0.7 0.5 4 1.8
+)" },
+    { "Reflection", R"(
+set pad 2.5c
+source 0.2 0.5 3 2
+box 0.75-$pad 0.2-$pad 0.78+$pad 0.8+$pad
+)" },
+    { "Circular Arena", R"(
+arc 0.5 0.5 0.4+5c 5c
+source 0.5 0.5 3 1.8
+)" },
+    { "Standing Waves", R"(
+set pad 2.5c
+source 0.2 0.5 4 2
+source 0.8 0.5 4 2
+# Resonance chamber
+box 0.1-$pad 0.3-$pad 0.1+$pad 0.7+$pad
+box 0.9-$pad 0.3-$pad 0.9+$pad 0.7+$pad
+)" },
+    { "Lens Focus", R"(
+# Mirror reaching back to x = 0.9, source at its focus
+parabola 0.75 0.5 1 0 0.3 0.424264 3c
+source 0.2 0.5 3.5 2
+)" },
+    { "Corner Cavity", R"(
+set pad 2.5c
+box 0.2-$pad 0.48-$pad 0.5+$pad 0.52+$pad
+box 0.48-$pad 0.5-$pad 0.52+$pad 0.8+$pad
+source 0.3 0.3 3 1.5
+source 0.7 0.7 3 1.5
+)" },
+    { "Wave Guide", R"(
+set pad 2.5c
+box 0.1-$pad 0.35-$pad 0.9+$pad 0.4+$pad
+box 0.1-$pad 0.6-$pad 0.9+$pad 0.65+$pad
+source 0.15 0.5 4 2
+)" },
+    { "Multiple Slits", R"(
+set pad 2.5c
+set slitCount 5
+set slitSpacing 0.1
+set slitWidth 0.02
+source 0.5 0.15 4 2
+# Diffraction grating centred on the source
+slits 0.2-$pad 0.45-$pad 0.8+$pad 0.5+$pad $slitCount $slitSpacing $slitWidth-$pad
+)" },
+};
+
+struct Arity {
+    const char* keyword;
+    int min, max;
+};
+
+const Arity DIRECTIVES[] = {
+    { "name", 1, 1 }, { "set", 2, 2 }, { "physics", 1, 3 }, { "source", 4, 5 }, { "probe", 3, 3 },
+    { "box", 4, 4 }, { "segment", 5, 5 }, { "arc", 4, 6 }, { "polygon", 6, 1 << 20 },
+    { "parabola", 7, 7 }, { "slits", 7, 7 },
+};
+
+// fraction * size + cells
+struct Length {
+    float fraction = 0.0f;
+    float cells = 0.0f;
+};
+
+using Variables = std::vector<std::pair<std::string, Length>>;
+
+bool isIdentifier(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// term (+|- term)*, where a term is a number, a number of cells (5c) or $variable
+bool parseLength(const std::string& text, const Variables& variables, Length& out, std::string& error) {
+    out = Length();
+    size_t i = 0;
+    float sign = 1.0f;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) sign = text[i++] == '-' ? -1.0f : 1.0f;
+    while (true) {
+        if (i < text.size() && text[i] == '$') {
+            const size_t start = ++i;
+            while (i < text.size() && isIdentifier(text[i])) i++;
+            const std::string name = text.substr(start, i - start);
+            auto it = std::find_if(variables.begin(), variables.end(), [&](const auto& v) { return v.first == name; });
+            if (it == variables.end()) {
+                error = "unknown variable $" + name;
+                return false;
+            }
+            out.fraction += sign * it->second.fraction;
+            out.cells += sign * it->second.cells;
+        } else {
+            if (i >= text.size() || !(std::isdigit(static_cast<unsigned char>(text[i])) || text[i] == '.')) {
+                error = "expected a number in '" + text + "'";
+                return false;
+            }
+            char* end = nullptr;
+            const float value = sign * static_cast<float>(std::strtod(text.c_str() + i, &end));
+            i = size_t(end - text.c_str());
+            if (i < text.size() && text[i] == 'c') {
+                out.cells += value;
+                i++;
+            } else {
+                out.fraction += value;
+            }
+        }
+        if (i == text.size()) return true;
+        if (text[i] != '+' && text[i] != '-') {
+            error = "unexpected '" + text.substr(i) + "' in '" + text + "'";
+            return false;
+        }
+        sign = text[i++] == '-' ? -1.0f : 1.0f;
+    }
+}
+
+// Splits a line at whitespace; quoted tokens may hold spaces and '#'
+bool splitLine(const std::string& line, std::vector<std::string>& tokens, std::string& error) {
+    size_t i = 0;
+    while (true) {
+        while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) i++;
+        if (i >= line.size() || line[i] == '#') return true;
+        if (line[i] == '"') {
+            const size_t close = line.find('"', i + 1);
+            if (close == std::string::npos) {
+                error = "unterminated quote";
+                return false;
+            }
+            tokens.push_back(line.substr(i + 1, close - i - 1));
+            i = close + 1;
+        } else {
+            const size_t start = i;
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) i++;
+            tokens.push_back(line.substr(start, i - start));
+        }
+    }
+}
+
+void hashBytes(uint64_t& h, const void* data, size_t bytes) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < bytes; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+}
+
+template <class T>
+void hashValue(uint64_t& h, const T& value) {
+    hashBytes(h, &value, sizeof(value));
+}
+
+void hashString(uint64_t& h, const std::string& s) {
+    hashValue(h, uint32_t(s.size()));
+    hashBytes(h, s.data(), s.size());
+}
+
+// Compiled scene cache file (little endian): header, ascending tile ids, the tiles (FIELD_TILE^2
+// bytes each, row-major, 64-byte aligned), then the sources as in a snapshot
+const char CACHE_MAGIC[8] = { 'W', 'S', 'S', 'C', 'E', 'N', 'E', '\0' };
+const uint32_t CACHE_VERSION = 1;
+const size_t TILE_BYTES = size_t(FIELD_TILE) * FIELD_TILE;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+    uint64_t hash;
+    uint32_t tileCount;
+    uint32_t sourceCount;
+    uint64_t tileOffset;
+    uint64_t sourceOffset;
+    uint64_t sourceBytes;
+};
+
+// Read-only view of a file: a private mapping where available, else a copy
+class MappedFile {
+public:
+    ~MappedFile() {
+#ifdef WAVESIM_HAVE_MMAP
+        if (m_map) munmap(m_map, m_bytes);
+#endif
+    }
+
+    bool open(const std::string& path) {
+#ifdef WAVESIM_HAVE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        m_bytes = size_t(st.st_size);
+        if (m_bytes > 0) {
+            void* p = mmap(nullptr, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_map = p;
+                m_data = static_cast<const char*>(p);
+            }
+        }
+        ::close(fd);
+        return m_data != nullptr;
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        m_copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m_data = m_copy.data();
+        m_bytes = m_copy.size();
+        return m_bytes > 0;
+#endif
+    }
+
+    const char* data() const { return m_data; }
+    size_t bytes() const { return m_bytes; }
+
+private:
+    void* m_map = nullptr;
+    const char* m_data = nullptr;
+    size_t m_bytes = 0;
+    std::vector<char> m_copy;
+};
+
+std::string cachePath(const std::string& directory, uint64_t hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.wscene", static_cast<unsigned long long>(hash));
+    return directory + "/" + name;
+}
+
+// Copies the walls and sources of a compiled scene into sim (walls and sources empty)
+bool readCache(const std::string& path, uint64_t hash, Simulation& sim) {
+    MappedFile file;
+    if (!file.open(path) || file.bytes() < sizeof(CacheHeader)) return false;
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const int n = sim.size;
+    const size_t tiles = size_t((n + FIELD_TILE - 1) / FIELD_TILE);
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.size != uint32_t(n) || header.hash != hash || header.tileCount > tiles * tiles ||
+        sizeof(header) + size_t(header.tileCount) * sizeof(uint32_t) > header.tileOffset ||
+        header.tileOffset + header.tileCount * TILE_BYTES > header.sourceOffset ||
+        header.sourceOffset > file.bytes() || header.sourceBytes > file.bytes() - header.sourceOffset) {
+        return false;
+    }
+
+    // Sources first, so a corrupt table leaves the walls alone
+    SourceStore sources;
+    const char* p = file.data() + header.sourceOffset;
+    const char* end = p + header.sourceBytes;
+    for (uint32_t i = 0; i < header.sourceCount; i++) {
+        float values[4];
+        uint32_t active, length;
+        if (size_t(end - p) < sizeof(values) + 2 * sizeof(uint32_t)) return false;
+        std::memcpy(values, p, sizeof(values));
+        std::memcpy(&active, p + sizeof(values), sizeof(active));
+        std::memcpy(&length, p + sizeof(values) + sizeof(active), sizeof(length));
+        p += sizeof(values) + 2 * sizeof(uint32_t);
+        if (size_t(end - p) < length) return false;
+        WaveSource source(values[0], values[1], values[2], values[3], std::string(p, length));
+        source.active = active != 0;
+        sources.add(source);
+        p += length;
+    }
+
+    const uint32_t* ids = reinterpret_cast<const uint32_t*>(file.data() + sizeof(header));
+    for (uint32_t t = 0; t < header.tileCount; t++) {
+        if (ids[t] >= tiles * tiles || (t > 0 && ids[t] <= ids[t - 1])) return false;
+    }
+    for (uint32_t t = 0; t < header.tileCount; t++) {
+        const int x0 = int(ids[t] % tiles) * FIELD_TILE, y0 = int(ids[t] / tiles) * FIELD_TILE;
+        const int width = std::min(FIELD_TILE, n - x0), height = std::min(FIELD_TILE, n - y0);
+        const char* tile = file.data() + header.tileOffset + t * TILE_BYTES;
+        // Rows of a tile are contiguous in either layout
+        for (int y = 0; y < height; y++) {
+            std::memcpy(&sim.walls[sim.index(x0, y0 + y)], tile + size_t(y) * FIELD_TILE, width);
+        }
+    }
+    sim.sources = std::move(sources);
+    return true;
+}
+
+// Writes sim's walls (only tiles inside some shape's bounds can hold any) and sources
+bool writeCache(const std::string& path, uint64_t hash, const Simulation& sim, const std::vector<Shape>& shapes,
+                std::string& error) {
+    const int n = sim.size;
+    const int tiles = (n + FIELD_TILE - 1) / FIELD_TILE;
+    std::vector<uint8_t> candidate(size_t(tiles) * tiles, 0);
+    for (const Shape& shape : shapes) {
+        float x0, y0, x1, y1;
+        shapeBounds(shape, x0, y0, x1, y1);
+        if (!(x1 >= 0.0f && y1 >= 0.0f && x0 < n && y0 < n)) continue;
+        const int tx0 = int(std::max(x0, 0.0f)) / FIELD_TILE, tx1 = int(std::min(x1, n - 1.0f)) / FIELD_TILE;
+        const int ty0 = int(std::max(y0, 0.0f)) / FIELD_TILE, ty1 = int(std::min(y1, n - 1.0f)) / FIELD_TILE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            std::fill(candidate.begin() + size_t(ty) * tiles + tx0, candidate.begin() + size_t(ty) * tiles + tx1 + 1, 1);
+        }
+    }
+
+    std::vector<uint32_t> ids;
+    std::vector<char> tileData;
+    std::vector<char> tile(TILE_BYTES);
+    for (size_t id = 0; id < candidate.size(); id++) {
+        if (!candidate[id]) continue;
+        const int x0 = int(id % tiles) * FIELD_TILE, y0 = int(id / tiles) * FIELD_TILE;
+        const int width = std::min(FIELD_TILE, n - x0), height = std::min(FIELD_TILE, n - y0);
+        std::fill(tile.begin(), tile.end(), 0);
+        bool any = false;
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = &sim.walls[sim.index(x0, y0 + y)];
+            std::memcpy(tile.data() + size_t(y) * FIELD_TILE, row, width);
+            any = any || std::any_of(row, row + width, [](uint8_t w) { return w != 0; });
+        }
+        if (!any) continue;
+        ids.push_back(static_cast<uint32_t>(id));
+        tileData.insert(tileData.end(), tile.begin(), tile.end());
+    }
+
+    std::vector<char> sourceData;
+    auto append = [&](const void* data, size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        sourceData.insert(sourceData.end(), p, p + bytes);
+    };
+    const SourceStore& s = sim.sources;
+    for (size_t i = 0; i < s.size(); i++) {
+        const float values[4] = { s.x(i), s.y(i), s.frequency(i), s.amplitude(i) };
+        const uint32_t active = s.active(i) ? 1 : 0, length = static_cast<uint32_t>(s.name(i).size());
+        append(values, sizeof(values));
+        append(&active, sizeof(active));
+        append(&length, sizeof(length));
+        append(s.name(i).data(), length);
+    }
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.size = static_cast<uint32_t>(n);
+    header.hash = hash;
+    header.tileCount = static_cast<uint32_t>(ids.size());
+    header.sourceCount = static_cast<uint32_t>(s.size());
+    header.tileOffset = (sizeof(header) + ids.size() * sizeof(uint32_t) + 63) / 64 * 64;
+    header.sourceOffset = header.tileOffset + tileData.size();
+    header.sourceBytes = sourceData.size();
+
+    const std::string temporary = path + ".tmp";
+    std::FILE* f = std::fopen(temporary.c_str(), "wb");
+    if (!f) {
+        error = "cannot create " + temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    static const char padding[64] = {};
+    size_t written = 0;
+    written += std::fwrite(&header, 1, sizeof(header), f);
+    written += std::fwrite(ids.data(), 1, ids.size() * sizeof(uint32_t), f);
+    written += std::fwrite(padding, 1, header.tileOffset - written, f);
+    written += std::fwrite(tileData.data(), 1, tileData.size(), f);
+    written += std::fwrite(sourceData.data(), 1, sourceData.size(), f);
+    const bool ok = std::fclose(f) == 0 && written == header.sourceOffset + header.sourceBytes;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "failed to write " + path + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void PresetParams::set(const std::string& name, float value) {
+    auto it = std::find_if(variables.begin(), variables.end(), [&](const auto& v) { return v.first == name; });
+    if (it != variables.end()) it->second = value;
+    else variables.push_back({ name, value });
+}
+
+bool parseScene(const std::string& text, SceneSpec& scene, std::string& error) {
+    scene.directives.clear();
+    std::istringstream in(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::vector<std::string> tokens;
+        if (!splitLine(line, tokens, error)) {
+            error = "line " + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+        if (tokens.empty()) continue;
+
+        SceneDirective d;
+        d.line = lineNumber;
+        d.keyword = tokens[0];
+        d.args.assign(tokens.begin() + 1, tokens.end());
+        auto arity = std::find_if(std::begin(DIRECTIVES), std::end(DIRECTIVES),
+                                  [&](const Arity& a) { return d.keyword == a.keyword; });
+        if (arity == std::end(DIRECTIVES)) {
+            error = "line " + std::to_string(lineNumber) + ": unknown directive '" + d.keyword + "'";
+            return false;
+        }
+        const int count = static_cast<int>(d.args.size());
+        if (count < arity->min || count > arity->max) {
+            error = "line " + std::to_string(lineNumber) + ": wrong number of values for " + d.keyword;
+            return false;
+        }
+        if (d.keyword == "name") scene.name = d.args[0];
+        else scene.directives.push_back(d);
+    }
+    // Catch bad values now rather than at load time
+    SceneContents contents;
+    return layoutScene(scene, GRID_SIZE, PresetParams(), contents, error);
+}
+
+bool readSceneFile(const std::string& path, SceneSpec& scene, std::string& error) {
+    std::ifstream f(path);
+    if (!f) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << f.rdbuf();
+    scene = SceneSpec();
+    if (!parseScene(text.str(), scene, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    scene.path = path;
+    if (scene.name.empty()) scene.name = std::filesystem::path(path).stem().string();
+    return true;
+}
+
+std::vector<SceneSpec> readSceneDirectory(const std::string& directory, std::vector<std::string>& errors) {
+    std::vector<SceneSpec> scenes;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".scene") continue;
+        SceneSpec scene;
+        std::string error;
+        if (readSceneFile(entry.path().string(), scene, error)) scenes.push_back(scene);
+        else errors.push_back(error);
+    }
+    std::sort(scenes.begin(), scenes.end(), [](const SceneSpec& a, const SceneSpec& b) { return a.name < b.name; });
+    return scenes;
+}
+
+bool findScene(const std::string& name, SceneSpec& scene, std::string& error) {
+    static const std::vector<SceneSpec> builtins = [] {
+        std::vector<SceneSpec> specs;
+        for (const BuiltinScene& b : BUILTIN_SCENES) {
+            SceneSpec spec;
+            std::string ignored;
+            parseScene(b.text, spec, ignored);
+            spec.name = b.name;
+            specs.push_back(spec);
+        }
+        return specs;
+    }();
+    for (const SceneSpec& spec : builtins) {
+        if (spec.name == name) {
+            scene = spec;
+            return true;
+        }
+    }
+    if (name.size() > 6 && name.compare(name.size() - 6, 6, ".scene") == 0) return readSceneFile(name, scene, error);
+    error = "unknown preset '" + name + "'";
+    return false;
+}
+
+bool layoutScene(const SceneSpec& scene, int size, const PresetParams& params, SceneContents& contents,
+                 std::string& error) {
+    contents = SceneContents();
+    Variables variables;
+    const float edge = static_cast<float>(size);
+
+    for (const SceneDirective& d : scene.directives) {
+        const std::vector<std::string>& a = d.args;
+        auto fail = [&](const std::string& message) {
+            error = "line " + std::to_string(d.line) + ": " + message;
+            return false;
+        };
+        // Positions and lengths in cells
+        auto length = [&](const std::string& text, float& value) {
+            Length l;
+            if (!parseLength(text, variables, l, error)) return fail(error);
+            value = edge * l.fraction + l.cells;
+            return true;
+        };
+        auto number = [&](const std::string& text, float& value) {
+            Length l;
+            if (!parseLength(text, variables, l, error)) return fail(error);
+            if (l.cells != 0.0f) return fail("'" + text + "' must be a plain number");
+            value = l.fraction;
+            return true;
+        };
+        auto lengths = [&](size_t first, size_t count, float* values) {
+            for (size_t i = 0; i < count; i++) {
+                if (!length(a[first + i], values[i])) return false;
+            }
+            return true;
+        };
+
+        if (d.keyword == "set") {
+            if (a[0].empty() || !std::all_of(a[0].begin(), a[0].end(), isIdentifier)) {
+                return fail("bad variable name '" + a[0] + "'");
+            }
+            Length value;
+            auto given = std::find_if(params.variables.begin(), params.variables.end(),
+                                      [&](const auto& v) { return v.first == a[0]; });
+            if (given != params.variables.end()) {
+                value.fraction = given->second;
+            } else if (!parseLength(a[1], variables, value, error)) {
+                return fail(error);
+            }
+            auto it = std::find_if(variables.begin(), variables.end(), [&](const auto& v) { return v.first == a[0]; });
+            if (it != variables.end()) it->second = value;
+            else variables.push_back({ a[0], value });
+        } else if (d.keyword == "physics") {
+            for (const std::string& setting : a) {
+                const size_t eq = setting.find('=');
+                float value;
+                if (eq == std::string::npos) return fail("expected key=value, got '" + setting + "'");
+                if (!number(setting.substr(eq + 1), value)) return false;
+                const std::string key = setting.substr(0, eq);
+                if (key == "waveSpeed") { contents.waveSpeed = value; contents.hasWaveSpeed = true; }
+                else if (key == "damping") { contents.damping = value; contents.hasDamping = true; }
+                else if (key == "reflectivity") { contents.reflectivity = value; contents.hasReflectivity = true; }
+                else return fail("unknown physics setting '" + key + "'");
+            }
+        } else if (d.keyword == "source") {
+            float p[2], frequency, amplitude;
+            if (!lengths(0, 2, p) || !number(a[2], frequency) || !number(a[3], amplitude)) return false;
+            const std::string name = a.size() > 4 ? a[4] : "Source " + std::to_string(contents.sources.size() + 1);
+            contents.sources.push_back(WaveSource(p[0], p[1], frequency, amplitude, name));
+        } else if (d.keyword == "probe") {
+            SceneProbe probe;
+            probe.name = a[0];
+            if (!length(a[1], probe.x) || !length(a[2], probe.y)) return false;
+            contents.probes.push_back(probe);
+        } else if (d.keyword == "box") {
+            float p[4];
+            if (!lengths(0, 4, p)) return false;
+            contents.shapes.push_back(boxShape(p[0], p[1], p[2], p[3]));
+        } else if (d.keyword == "segment") {
+            float p[5];
+            if (!lengths(0, 5, p)) return false;
+            contents.shapes.push_back(segmentShape(p[0], p[1], p[2], p[3], p[4]));
+        } else if (d.keyword == "arc") {
+            float p[4], from = 0.0f, to = 360.0f;
+            if (!lengths(0, 4, p)) return false;
+            if (a.size() == 5) return fail("arc needs both angles or neither");
+            if (a.size() == 6 && (!number(a[4], from) || !number(a[5], to))) return false;
+            if (to <= from) return fail("arc ends before it starts");
+            if (to - from >= 360.0f) contents.shapes.push_back(arcShape(p[0], p[1], p[2], p[3]));
+            else contents.shapes.push_back(arcShape(p[0], p[1], p[2], p[3], from * PI / 180.0f, to * PI / 180.0f));
+        } else if (d.keyword == "polygon") {
+            if (a.size() % 2 != 0) return fail("polygon needs x y pairs");
+            std::vector<float> points(a.size());
+            if (!lengths(0, a.size(), points.data())) return false;
+            contents.shapes.push_back(polygonShape(points));
+        } else if (d.keyword == "parabola") {
+            float vertex[2], dx, dy, focal, reach, width;
+            if (!lengths(0, 2, vertex) || !number(a[2], dx) || !number(a[3], dy) || !length(a[4], focal) ||
+                !length(a[5], reach) || !length(a[6], width)) {
+                return false;
+            }
+            if (dx == 0.0f && dy == 0.0f) return fail("parabola needs a direction");
+            if (focal == 0.0f) return fail("parabola needs a nonzero focal length");
+            contents.shapes.push_back(parabolaShape(vertex[0], vertex[1], dx, dy, 1.0f / (4.0f * focal), reach, width));
+        } else if (d.keyword == "slits") {
+            float box[4], count, width;
+            Length spacing, from, to;
+            if (!lengths(0, 4, box) || !number(a[4], count) || !length(a[6], width)) return false;
+            if (count < 0.0f || count != std::floor(count)) return fail("slit count must be a whole number");
+            if (!parseLength(a[5], variables, spacing, error)) return fail(error);
+            // Gaps run along the longer side, centred between its ends
+            const bool wide = box[2] - box[0] >= box[3] - box[1];
+            if (!parseLength(a[wide ? 0 : 1], variables, from, error) || !parseLength(a[wide ? 2 : 3], variables, to, error)) {
+                return fail(error);
+            }
+            std::vector<float> centres;
+            for (int i = 0; i < static_cast<int>(count); i++) {
+                const float k = i - (count - 1.0f) * 0.5f;
+                const float fraction = (from.fraction + to.fraction) * 0.5f + k * spacing.fraction;
+                const float cells = (from.cells + to.cells) * 0.5f + k * spacing.cells;
+                centres.push_back(edge * fraction + cells);
+            }
+            contents.shapes.push_back(slitsShape(box[0], box[1], box[2], box[3], centres, width));
+        }
+    }
+    return true;
+}
+
+uint64_t sceneHash(const SceneContents& contents, int size) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    hashValue(h, CACHE_VERSION);
+    hashValue(h, size);
+    for (const Shape& s : contents.shapes) {
+        hashValue(h, int32_t(s.type));
+        const float values[11] = { s.ax, s.ay, s.bx, s.by, s.radius, s.halfWidth, s.angle0, s.angle1,
+                                   s.curvature, s.reach, float(s.points.size()) };
+        hashValue(h, values);
+        hashBytes(h, s.points.data(), s.points.size() * sizeof(float));
+    }
+    for (const WaveSource& s : contents.sources) {
+        const float values[4] = { s.x, s.y, s.frequency, s.amplitude };
+        hashValue(h, values);
+        hashValue(h, uint8_t(s.active));
+        hashString(h, s.name);
+    }
+    return h;
+}
+
+bool loadScene(Simulation& sim, const SceneSpec& scene, const PresetParams& params, const SceneOptions& options,
+               SceneContents* laidOut, std::string& error) {
+    SceneContents contents;
+    if (!layoutScene(scene, sim.size, params, contents, error)) {
+        if (!scene.path.empty()) error = scene.path + ": " + error;
+        return false;
+    }
+
+    clearWaves(sim);
+    clearWalls(sim);
+    clearSources(sim);
+
+    const uint64_t hash = options.cacheDirectory.empty() ? 0 : sceneHash(contents, sim.size);
+    const std::string path = options.cacheDirectory.empty() ? std::string() : cachePath(options.cacheDirectory, hash);
+    if (path.empty() || !readCache(path, hash, sim)) {
+        rasterizeShapes(sim, contents.shapes, options.pool);
+        sim.sources.reserve(contents.sources.size());
+        for (const WaveSource& source : contents.sources) sim.sources.add(source);
+        if (!path.empty()) {
+            // The cache is an optimization; a read-only scenes directory only costs the rasterization
+            std::string ignored;
+            std::error_code ec;
+            std::filesystem::create_directories(options.cacheDirectory, ec);
+            if (!writeCache(path, hash, sim, contents.shapes, ignored)) std::cerr << ignored << std::endl;
+        }
+    }
+
+    if (contents.hasWaveSpeed) sim.waveSpeed = contents.waveSpeed;
+    if (contents.hasDamping) sim.damping = contents.damping;
+    if (contents.hasReflectivity) sim.wallReflectivity = contents.reflectivity;
+    if (laidOut) *laidOut = std::move(contents);
+    return true;
+}
+
+const std::vector<std::string>& presetNames() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> list;
+        for (const BuiltinScene& b : BUILTIN_SCENES) list.push_back(b.name);
+        return list;
+    }();
+    return names;
+}
+
+bool loadPreset(Simulation& sim, const std::string& name, const PresetParams& params, ThreadPool* pool) {
+    SceneSpec scene;
+    SceneOptions options;
+    options.pool = pool;
+    std::string error;
+    if (!findScene(name, scene, error) || !loadScene(sim, scene, params, options, nullptr, error)) {
+        std::cerr << error << std::endl;
+        clearWaves(sim);
+        clearWalls(sim);
+        clearSources(sim);
+        return false;
+    }
+    std::cout << "Loaded preset: " << name << std::endl;
+    return true;
+}
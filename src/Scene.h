@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Geometry.h"
+#include "Simulation.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+// Declarative scenes: walls, sources, physics and probes as text (*.scene files, and the
+// built-in presets, which are written the same way).
+//
+// One directive per line; '#' starts a comment. Positions and lengths are fractions of the
+// grid edge, so a scene fits any grid size. A length may also be given in cells with a 'c'
+// suffix (5c), terms may be joined with + and - (0.4+5c), and $name reads a variable.
+// Counts, frequencies, amplitudes, directions and angles are plain numbers.
+//
+//   name "Double Slit"                        display name (default: the file's stem)
+//   set slitCount 5                           variable; PresetParams may override it
+//   physics waveSpeed=6 damping=0.9995 reflectivity=1
+//                                             replaces those settings (others stay as they are)
+//   source x y frequency amplitude ["label"]
+//   probe "label" x y                         a point whose displacement the app shows
+//   box x0 y0 x1 y1
+//   segment x0 y0 x1 y1 width                 capsule of half width `width`
+//   arc cx cy radius width [from to]          ring of half width `width`; degrees, counter-clockwise
+//   polygon x y x y x y ...                   filled
+//   parabola vx vy dx dy focal reach width    mirror opening along (dx, dy), |offset| <= reach
+//   slits x0 y0 x1 y1 count spacing width     box with `count` gaps of half width `width`,
+//                                             `spacing` apart and centred on the box
+//
+// Walls follow Geometry.h; see src/Scene.cpp for the stock presets.
+
+// Overrides for scene variables (`set` lines), for parameter studies. The stock presets
+// expose slitCount, slitSpacing and slitWidth (Multiple Slits) and slitSeparation (Double
+// Slit). Variables a scene does not set are ignored.
+struct PresetParams {
+    std::vector<std::pair<std::string, float>> variables;
+
+    // Replaces an earlier override of the same variable
+    void set(const std::string& name, float value);
+};
+
+struct SceneProbe {
+    std::string name;
+    float x = 0.0f, y = 0.0f;       // cells
+};
+
+struct SceneDirective {
+    int line = 0;
+    std::string keyword;
+    std::vector<std::string> args;  // quotes removed
+};
+
+// A parsed scene, independent of grid size
+struct SceneSpec {
+    std::string name;
+    std::string path;               // empty for built-in presets
+    std::vector<SceneDirective> directives;
+};
+
+// A scene laid out on a grid of a given size
+struct SceneContents {
+    std::vector<Shape> shapes;
+    std::vector<WaveSource> sources;
+    std::vector<SceneProbe> probes;
+    bool hasWaveSpeed = false, hasDamping = false, hasReflectivity = false;
+    float waveSpeed = 0.0f, damping = 0.0f, reflectivity = 0.0f;
+};
+
+// Parses and checks a scene (every directive is laid out once, on a GRID_SIZE grid)
+bool parseScene(const std::string& text, SceneSpec& scene, std::string& error);
+bool readSceneFile(const std::string& path, SceneSpec& scene, std::string& error);
+// The *.scene files in `directory`, by name; files that fail to parse are reported in `errors`
+std::vector<SceneSpec> readSceneDirectory(const std::string& directory, std::vector<std::string>& errors);
+
+// A built-in preset by name, or a scene file when `name` ends in .scene
+bool findScene(const std::string& name, SceneSpec& scene, std::string& error);
+
+bool layoutScene(const SceneSpec& scene, int size, const PresetParams& params, SceneContents& contents,
+                 std::string& error);
+
+// Content hash of a laid-out scene: grid size, shapes and sources
+uint64_t sceneHash(const SceneContents& contents, int size);
+
+struct SceneOptions {
+    ThreadPool* pool = nullptr;     // spreads wall rasterization over threads
+    // Compiled scenes are kept here, named by sceneHash(): the wall tiles that hold walls and
+    // the sources, read back through a memory mapping instead of rasterizing. Empty: no cache.
+    std::string cacheDirectory;
+};
+
+// Replaces sim's scene (fields cleared) with `scene` and applies the physics it sets; the
+// others stay as they are. `contents`, if given, receives the laid-out scene (probes, physics).
+bool loadScene(Simulation& sim, const SceneSpec& scene, const PresetParams& params, const SceneOptions& options,
+               SceneContents* contents, std::string& error);
+
+// Stock presets
+const std::vector<std::string>& presetNames();
+// findScene() + loadScene() without a cache; unknown names are reported and leave an empty scene
+bool loadPreset(Simulation& sim, const std::string& name, const PresetParams& params = PresetParams(),
+                ThreadPool* pool = nullptr);
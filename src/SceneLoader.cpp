@@ -0,0 +1,132 @@
+#include "SceneLoader.h"
+
+#include <iostream>
+
+SceneLoader::SceneLoader() {
+    m_thread = std::thread([this] { run(); });
+}
+
+SceneLoader::~SceneLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void SceneLoader::load(const std::string& preset, const Simulation& sim, const PresetParams& params) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_request.id = m_nextId++;
+        m_request.preset = preset;
+        m_request.params = params;
+        m_request.size = sim.size;
+        m_request.layout = sim.layout;
+        m_request.cacheDirectory = m_cacheDirectory;
+        m_requested = true;
+        m_wanted = m_request.id;
+    }
+    m_wake.notify_one();
+}
+
+void SceneLoader::setCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cacheDirectory = directory;
+}
+
+void SceneLoader::cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requested = false;
+    m_wanted = 0;
+}
+
+bool SceneLoader::loading() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_wanted != 0;
+}
+
+std::string SceneLoader::loadingName() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_request.preset;
+}
+
+bool SceneLoader::adopt(Simulation& sim, std::vector<SceneProbe>* probes) {
+    std::unique_ptr<Simulation> scene;
+    SceneContents contents;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_ready || m_readyId != m_wanted) return false;
+        scene = std::move(m_ready);
+        contents = std::move(m_readyContents);
+        m_wanted = 0;
+    }
+    // The grid may have changed shape since load()
+    const bool fits = scene->size == sim.size;
+    if (fits) {
+        if (scene->layout != sim.layout) setFieldLayout(*scene, sim.layout);
+        sim.u.swap(scene->u);
+        sim.u_prev.swap(scene->u_prev);
+        sim.u_prev2.swap(scene->u_prev2);
+        sim.walls.swap(scene->walls);
+        std::swap(sim.sources, scene->sources);
+        std::swap(sim.time, scene->time);
+        if (contents.hasWaveSpeed) sim.waveSpeed = contents.waveSpeed;
+        if (contents.hasDamping) sim.damping = contents.damping;
+        if (contents.hasReflectivity) sim.wallReflectivity = contents.reflectivity;
+        if (probes) *probes = std::move(contents.probes);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(m_retired, scene);
+    }
+    m_wake.notify_one();
+    return fits;
+}
+
+void SceneLoader::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return m_closing || m_requested || m_retired; });
+        if (m_closing) break;
+        // Large grids take a while to unmap; that happens here rather than in adopt()
+        std::unique_ptr<Simulation> garbage = std::move(m_retired);
+        if (!m_requested) {
+            lock.unlock();
+            garbage.reset();
+            lock.lock();
+            continue;
+        }
+        const Request request = m_request;
+        m_requested = false;
+        lock.unlock();
+        garbage.reset();
+
+        auto scene = std::make_unique<Simulation>(request.size, request.layout);
+        SceneSpec spec;
+        SceneOptions options;
+        options.cacheDirectory = request.cacheDirectory;
+        SceneContents contents;
+        std::string error;
+        const bool loaded = findScene(request.preset, spec, error) &&
+                            loadScene(*scene, spec, request.params, options, &contents, error);
+        if (loaded) std::cout << "Loaded preset: " << spec.name << std::endl;
+        else std::cerr << error << std::endl;
+
+        lock.lock();
+        if (request.id == m_wanted && !loaded) {
+            m_wanted = 0;
+            garbage = std::move(scene);
+        } else if (request.id == m_wanted) {
+            garbage = std::move(m_ready);
+            m_ready = std::move(scene);
+            m_readyContents = std::move(contents);
+            m_readyId = request.id;
+        } else {
+            garbage = std::move(scene);     // superseded or cancelled while building
+        }
+        lock.unlock();
+        garbage.reset();
+        lock.lock();
+    }
+}
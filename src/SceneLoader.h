@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Scene.h"
+#include "Simulation.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Builds scenes on a background thread, so the app keeps stepping and drawing the current
+// scene while a new one's walls are rasterized. load() starts a preset or scene file (see
+// findScene()) in a staging Simulation shaped like the live one; the caller polls adopt()
+// between solver steps, which swaps the finished fields, walls, sources and time in without
+// copying. Physics settings change only where the scene sets them, as with loadScene(). The
+// replaced scene goes back to the loader thread to be freed.
+class SceneLoader {
+public:
+    SceneLoader();
+    ~SceneLoader();
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator=(const SceneLoader&) = delete;
+
+    // Starts building `preset` for a grid of sim's size and layout. Supersedes a load that
+    // has not been adopted yet. A scene that fails to load is reported and dropped.
+    void load(const std::string& preset, const Simulation& sim, const PresetParams& params = PresetParams());
+    // Where compiled scenes are cached (SceneOptions::cacheDirectory); empty for none
+    void setCacheDirectory(const std::string& directory);
+    // Drops the pending load, if any (e.g. the scene was cleared meanwhile)
+    void cancel();
+    // True from load() until the scene is adopted or cancelled
+    bool loading() const;
+    std::string loadingName() const;
+
+    // Swaps a finished scene into `sim`, and its probes into `probes`; false if none is ready
+    bool adopt(Simulation& sim, std::vector<SceneProbe>* probes = nullptr);
+
+private:
+    struct Request {
+        uint64_t id = 0;
+        std::string preset;
+        PresetParams params;
+        int size = 0;
+        FieldLayout layout = FieldLayout::ROW_MAJOR;
+        std::string cacheDirectory;
+    };
+
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    Request m_request;
+    bool m_requested = false;           // m_request not yet picked up
+    uint64_t m_wanted = 0;              // id of the load to adopt, 0 for none
+    uint64_t m_nextId = 1;
+    std::string m_cacheDirectory;
+    std::unique_ptr<Simulation> m_ready;
+    SceneContents m_readyContents;      // probes and physics of m_ready
+    uint64_t m_readyId = 0;
+    std::unique_ptr<Simulation> m_retired;
+    bool m_closing = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,149 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+const char* fieldLayoutName(FieldLayout layout) {
+    switch (layout) {
+        case FieldLayout::ROW_MAJOR: return "row-major";
+        case FieldLayout::TILED: return "tiled";
+        default: return "unknown";
+    }
+}
+
+void setFieldLayout(Simulation& sim, FieldLayout layout) {
+    if (sim.layout == layout) return;
+
+    Simulation next(sim.size, layout);
+    auto copy = [&](const auto& from, auto& to) {
+        for (int y = 0; y < sim.size; y++) {
+            for (int x = 0; x < sim.size; x++) {
+                to[next.index(x, y)] = from[sim.index(x, y)];
+            }
+        }
+    };
+    copy(sim.u, next.u);
+    copy(sim.u_prev, next.u_prev);
+    copy(sim.u_prev2, next.u_prev2);
+    copy(sim.walls, next.walls);
+
+    sim.layout = next.layout;
+    sim.pitch = next.pitch;
+    sim.tiles = next.tiles;
+    sim.u.swap(next.u);
+    sim.u_prev.swap(next.u_prev);
+    sim.u_prev2.swap(next.u_prev2);
+    sim.walls.swap(next.walls);
+}
+
+// Add wave source
+void addSource(Simulation& sim, float x, float y, float freq, float amp) {
+    sim.sources.add(WaveSource(x, y, freq, amp, "Source " + std::to_string(sim.sources.size() + 1)));
+}
+
+// Remove wave source
+void removeSource(Simulation& sim, float x, float y) {
+    sim.sources.eraseWithin(x, y, 25.0f);
+}
+
+DirtyRect wholeGrid(const Simulation& sim) {
+    return DirtyRect{ 0, 0, sim.size, sim.size };
+}
+
+// Clear functions
+void clearWaves(Simulation& sim) {
+    // Fresh blocks come back zeroed with their pages untouched, so clearing a huge grid
+    // costs nothing up front and the solver threads still decide page placement
+    const size_t cells = sim.u.size();
+    FieldVector<float>(cells).swap(sim.u);
+    FieldVector<float>(cells).swap(sim.u_prev);
+    FieldVector<float>(cells).swap(sim.u_prev2);
+    sim.time = 0.0f;
+}
+
+void clearWalls(Simulation& sim) {
+    // As above; presets then only write the pages their walls land on
+    FieldVector<uint8_t>(sim.walls.size()).swap(sim.walls);
+}
+
+void clearSources(Simulation& sim) {
+    sim.sources.clear();
+}
+
+
+namespace {
+
+// applyRipple()'s kernel, amplitude * (1 - d / r)^2 for d <= r, computed once. Each row
+// also records the half-width of the disc in it.
+struct RippleStamp {
+    std::vector<float> weights;     // (2r + 1)^2, row-major, centred
+    std::vector<int> halfWidth;     // per row
+};
+
+const RippleStamp& rippleStamp() {
+    static const RippleStamp stamp = [] {
+        const int r = RIPPLE_RADIUS, w = 2 * RIPPLE_RADIUS + 1;
+        const float amplitude = 1.5f;  // Reduced for continuous application
+        RippleStamp s;
+        s.weights.assign(size_t(w) * w, 0.0f);
+        s.halfWidth.assign(w, -1);
+        for (int dy = -r; dy <= r; dy++) {
+            for (int dx = -r; dx <= r; dx++) {
+                const float dist = static_cast<float>(std::sqrt(dx * dx + dy * dy));
+                if (dist > r) continue;
+                const float falloff = 1.0f - (dist / r);
+                s.weights[size_t(dy + r) * w + dx + r] = amplitude * falloff * falloff;
+                s.halfWidth[dy + r] = std::max(s.halfWidth[dy + r], dx);
+            }
+        }
+        return s;
+    }();
+    return stamp;
+}
+
+} // namespace
+
+// Create a ripple effect centred on a grid cell (Interact tool)
+void applyRipple(Simulation& sim, int gridX, int gridY) {
+    const RippleStamp& stamp = rippleStamp();
+    const int r = RIPPLE_RADIUS, w = 2 * RIPPLE_RADIUS + 1;
+    const int y0 = std::max(gridY - r, 0), y1 = std::min(gridY + r, sim.size - 1);
+    for (int y = y0; y <= y1; y++) {
+        const int dy = y - gridY;
+        const int half = stamp.halfWidth[dy + r];
+        const int x0 = std::max(gridX - half, 0), x1 = std::min(gridX + half, sim.size - 1);
+        const float* weights = stamp.weights.data() + size_t(dy + r) * w + r;
+        for (int x = x0; x <= x1; x++) {
+            const size_t i = sim.index(x, y);
+            if (!sim.walls[i]) sim.u[i] += weights[x - gridX];
+        }
+    }
+}
+
+float applyRippleStroke(Simulation& sim, float x0, float y0, float x1, float y1, float spacing, float carry) {
+    const float dx = x1 - x0, dy = y1 - y0;
+    const float length = std::sqrt(dx * dx + dy * dy);
+    float d = spacing - carry;
+    for (; d <= length; d += spacing) {
+        const float t = d / length;
+        applyRipple(sim, static_cast<int>(x0 + t * dx), static_cast<int>(y0 + t * dy));
+    }
+    return length - (d - spacing);
+}
+
+
+// Convert the wall mask to the float texture layout used by the renderer
+void wallsToTexture(const Simulation& sim, std::vector<float>& out) {
+    out.resize(sim.size * sim.size);
+    packRowMajor(sim, sim.walls, out.data());
+}
+
+void wallsToTexture(const Simulation& sim, const DirtyRect& rect, std::vector<float>& out) {
+    const int width = rect.x1 - rect.x0;
+    out.resize(size_t(width) * (rect.y1 - rect.y0));
+    for (int y = rect.y0; y < rect.y1; y++) {
+        float* row = out.data() + size_t(y - rect.y0) * width;
+        for (int x = rect.x0; x < rect.x1; x++) row[x - rect.x0] = sim.walls[sim.index(x, y)];
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "FieldAllocator.h"
+#include "SourceStore.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Grid
+const int GRID_SIZE = 512;
+const float PI = 3.14159265359f;
+
+// Field storage order. TILED stores FIELD_TILE x FIELD_TILE tiles contiguously (tile rows
+// of tiles, row-major inside a tile), so the rows above and below a cell are 128 bytes
+// away instead of a full grid row.
+enum class FieldLayout { ROW_MAJOR, TILED };
+
+const int FIELD_TILE = 32;
+const int FIELD_TILE_SHIFT = 5;
+
+const char* fieldLayoutName(FieldLayout layout);
+
+// Scene and physics state shared by the interactive app and headless tools.
+// Cells are addressed through index(); storage beyond the size x size grid (row padding,
+// partial edge tiles) is always zero.
+struct Simulation {
+    int size = GRID_SIZE;           // Grid is size x size cells
+    FieldLayout layout = FieldLayout::ROW_MAJOR;
+    int pitch = GRID_SIZE;          // Row stride in elements (ROW_MAJOR) or FIELD_TILE (TILED)
+    int tiles = 0;                  // Tiles per grid edge (TILED)
+    FieldVector<float> u;           // Current displacement
+    FieldVector<float> u_prev;      // Previous displacement
+    FieldVector<float> u_prev2;     // Two steps back
+    FieldVector<uint8_t> walls;     // 1 = wall cell
+    SourceStore sources;
+
+    float time = 0.0f;
+    // Physics
+    // Note: this wave solver implicitly assumes a grid spacing of 1.
+    // Keeping waveSpeed moderate (and dt stable) dramatically improves visual quality.
+    float waveSpeed = 6.0f;
+    float damping = 0.9995f;
+    float wallReflectivity = 1.0f;  // 1.0 = perfect reflection, 0.0 = full absorption
+    float dt = 1.0f / 60.0f; // base (used as a clamp/target)
+
+    // Fields start zeroed but unfaulted; see firstTouchFields() for NUMA placement.
+    explicit Simulation(int gridSize = GRID_SIZE, FieldLayout fieldLayout = FieldLayout::ROW_MAJOR)
+        : size(gridSize), layout(fieldLayout) {
+        if (layout == FieldLayout::TILED) {
+            tiles = (size + FIELD_TILE - 1) / FIELD_TILE;
+            pitch = FIELD_TILE;
+        } else {
+            pitch = fieldPitch(size);
+        }
+        const size_t cells = fieldCells();
+        u.resize(cells);
+        u_prev.resize(cells);
+        u_prev2.resize(cells);
+        walls.resize(cells);
+    }
+
+    size_t fieldCells() const {
+        if (layout == FieldLayout::TILED) return size_t(tiles) * tiles * FIELD_TILE * FIELD_TILE;
+        return size_t(pitch) * size;
+    }
+
+    int index(int x, int y) const {
+        if (layout == FieldLayout::TILED) {
+            const int tile = (y >> FIELD_TILE_SHIFT) * tiles + (x >> FIELD_TILE_SHIFT);
+            return (tile << (2 * FIELD_TILE_SHIFT)) + ((y & (FIELD_TILE - 1)) << FIELD_TILE_SHIFT) + (x & (FIELD_TILE - 1));
+        }
+        return y * pitch + x;
+    }
+};
+
+// Re-stores every field of `sim` in `layout`, keeping the scene intact.
+void setFieldLayout(Simulation& sim, FieldLayout layout);
+
+// Copies a field into a dense size x size row-major array (texture upload, export).
+// `field` may be any buffer laid out like sim's fields.
+template <class T, class U>
+void packRowMajor(const Simulation& sim, const T* field, U* out) {
+    const int n = sim.size;
+    if (sim.layout == FieldLayout::ROW_MAJOR) {
+        for (int y = 0; y < n; y++) {
+            const T* row = field + size_t(y) * sim.pitch;
+            for (int x = 0; x < n; x++) out[size_t(y) * n + x] = static_cast<U>(row[x]);
+        }
+        return;
+    }
+    // Copy tile rows as FIELD_TILE-wide runs
+    for (int y = 0; y < n; y++) {
+        for (int x0 = 0; x0 < n; x0 += FIELD_TILE) {
+            const T* run = field + sim.index(x0, y);
+            const int width = std::min(FIELD_TILE, n - x0);
+            for (int x = 0; x < width; x++) out[size_t(y) * n + x0 + x] = static_cast<U>(run[x]);
+        }
+    }
+}
+
+template <class T, class U>
+void packRowMajor(const Simulation& sim, const FieldVector<T>& field, U* out) {
+    packRowMajor(sim, field.data(), out);
+}
+
+// Inverse of packRowMajor(): fills a field of sim from a dense row-major array.
+template <class T>
+void unpackRowMajor(const Simulation& sim, const T* in, FieldVector<T>& field) {
+    const int n = sim.size;
+    for (int y = 0; y < n; y++) {
+        if (sim.layout == FieldLayout::ROW_MAJOR) {
+            std::copy(in + size_t(y) * n, in + size_t(y + 1) * n, field.data() + size_t(y) * sim.pitch);
+            continue;
+        }
+        for (int x = 0; x < n; x++) field[sim.index(x, y)] = in[size_t(y) * n + x];
+    }
+}
+
+// Sources
+void addSource(Simulation& sim, float x, float y, float freq, float amp);
+void removeSource(Simulation& sim, float x, float y);
+
+// Interaction
+const int RIPPLE_RADIUS = 15;
+void applyRipple(Simulation& sim, int gridX, int gridY);
+// Stamps ripples every `spacing` cells along the segment (x0, y0) -> (x1, y1). `carry` is
+// the distance covered since the last stamp; passing the returned value to the next segment
+// of a drag keeps the stamps evenly spaced however the cursor events split the path.
+float applyRippleStroke(Simulation& sim, float x0, float y0, float x1, float y1, float spacing, float carry);
+
+// Clear functions
+void clearWaves(Simulation& sim);
+void clearWalls(Simulation& sim);
+void clearSources(Simulation& sim);
+
+// Cells [x0, x1) x [y0, y1) of the grid; wall edits report the cells they changed as one
+struct DirtyRect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    // Grows to the bounding box of both
+    void include(const DirtyRect& other) {
+        if (other.empty()) return;
+        if (empty()) {
+            *this = other;
+            return;
+        }
+        x0 = std::min(x0, other.x0);
+        y0 = std::min(y0, other.y0);
+        x1 = std::max(x1, other.x1);
+        y1 = std::max(y1, other.y1);
+    }
+    void include(int x, int y) { include(DirtyRect{ x, y, x + 1, y + 1 }); }
+};
+
+DirtyRect wholeGrid(const Simulation& sim);
+
+// Rendering helpers
+// Packs the wall mask into a dense size x size float texture (no row padding, any layout)
+void wallsToTexture(const Simulation& sim, std::vector<float>& out);
+// Packs `rect` of the wall mask, (x1 - x0) x (y1 - y0) row-major, for a sub-image upload
+void wallsToTexture(const Simulation& sim, const DirtyRect& rect, std::vector<float>& out);
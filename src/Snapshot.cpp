@@ -0,0 +1,480 @@
+#include "Snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WAVESIM_HAVE_MMAP 1
+#endif
+
+#ifdef WAVESIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const char MAGIC[8] = { 'W', 'S', 'S', 'N', 'A', 'P', '\0', '\0' };
+const size_t SECTION_ALIGNMENT = 64;
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+void appendBytes(std::vector<char>& out, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    out.insert(out.end(), p, p + bytes);
+}
+
+void appendString(std::vector<char>& out, const std::string& s) {
+    const uint32_t length = static_cast<uint32_t>(s.size());
+    appendBytes(out, &length, sizeof(length));
+    appendBytes(out, s.data(), s.size());
+}
+
+// Bounds-checked reader over a decoded section
+struct Reader {
+    const char* p;
+    const char* end;
+
+    template <class T>
+    bool read(T& value) {
+        if (size_t(end - p) < sizeof(T)) return false;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& s) {
+        uint32_t length;
+        if (!read(length) || size_t(end - p) < length) return false;
+        s.assign(p, length);
+        p += length;
+        return true;
+    }
+};
+
+// Row 0, row size-1, column 0, column size-1
+void copyEdges(const Simulation& shape, const float* field, float* edges) {
+    const int n = shape.size;
+    for (int i = 0; i < n; i++) {
+        edges[i] = field[shape.index(i, 0)];
+        edges[n + i] = field[shape.index(i, n - 1)];
+        edges[2 * n + i] = field[shape.index(0, i)];
+        edges[3 * n + i] = field[shape.index(n - 1, i)];
+    }
+}
+
+struct Payload {
+    SnapshotSectionId id;
+    const void* data;
+    size_t rawBytes;
+    std::vector<char> packed;       // deflated data, when smaller
+};
+
+bool deflateInto(Payload& payload) {
+#ifdef WAVESIM_HAVE_ZLIB
+    uLongf bound = compressBound(static_cast<uLong>(payload.rawBytes));
+    payload.packed.resize(bound);
+    // Level 1: fields are mostly smooth noise, so higher levels buy little for much more time
+    if (compress2(reinterpret_cast<Bytef*>(payload.packed.data()), &bound,
+                  static_cast<const Bytef*>(payload.data), static_cast<uLong>(payload.rawBytes), 1) != Z_OK ||
+        bound >= payload.rawBytes) {
+        payload.packed.clear();
+        return false;
+    }
+    payload.packed.resize(bound);
+    return true;
+#else
+    (void)payload;
+    return false;
+#endif
+}
+
+// Writes the sections of one snapshot. `state` carries geometry, physics and sources;
+// u, uPrev and walls are dense row-major, edges as in SnapshotSectionId::U_PREV2_EDGES.
+bool writeSnapshotFile(const std::string& path, const Simulation& state, const SnapshotInfo& info,
+                       const float* u, const float* uPrev, const float* edges, const uint8_t* walls,
+                       const SnapshotOptions& options, std::string& error) {
+    const size_t cells = size_t(state.size) * state.size;
+
+    std::vector<char> sources;
+    const uint32_t sourceCount = static_cast<uint32_t>(state.sources.size());
+    appendBytes(sources, &sourceCount, sizeof(sourceCount));
+    const SourceStore& s = state.sources;
+    for (size_t i = 0; i < s.size(); i++) {
+        const float values[4] = { s.x(i), s.y(i), s.frequency(i), s.amplitude(i) };
+        const uint32_t active = s.active(i) ? 1 : 0;
+        appendBytes(sources, values, sizeof(values));
+        appendBytes(sources, &active, sizeof(active));
+        appendString(sources, s.name(i));
+    }
+    std::vector<char> infoBytes;
+    appendString(infoBytes, info.owner);
+    appendString(infoBytes, info.status);
+
+    std::vector<Payload> payloads = {
+        { SnapshotSectionId::U, u, cells * sizeof(float), {} },
+        { SnapshotSectionId::U_PREV, uPrev, cells * sizeof(float), {} },
+        { SnapshotSectionId::U_PREV2_EDGES, edges, size_t(4) * state.size * sizeof(float), {} },
+        { SnapshotSectionId::WALLS, walls, cells, {} },
+        { SnapshotSectionId::SOURCES, sources.data(), sources.size(), {} },
+        { SnapshotSectionId::INFO, infoBytes.data(), infoBytes.size(), {} },
+    };
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.sectionCount = static_cast<uint32_t>(payloads.size());
+    header.size = static_cast<uint32_t>(state.size);
+    header.layout = static_cast<uint32_t>(state.layout);
+    header.steps = info.steps;
+    header.stopReference = info.stopReference;
+    header.time = state.time;
+    header.dt = state.dt;
+    header.waveSpeed = state.waveSpeed;
+    header.damping = state.damping;
+    header.wallReflectivity = state.wallReflectivity;
+
+    std::vector<SnapshotSection> table(payloads.size());
+    size_t offset = roundUp(sizeof(header) + table.size() * sizeof(SnapshotSection), SECTION_ALIGNMENT);
+    for (size_t i = 0; i < payloads.size(); i++) {
+        Payload& p = payloads[i];
+        const bool packed = options.compress && deflateInto(p);
+        table[i].id = static_cast<uint32_t>(p.id);
+        table[i].encoding = static_cast<uint32_t>(packed ? SnapshotEncoding::DEFLATE : SnapshotEncoding::RAW);
+        table[i].offset = offset;
+        table[i].rawBytes = p.rawBytes;
+        table[i].storedBytes = packed ? p.packed.size() : p.rawBytes;
+        offset = roundUp(offset + table[i].storedBytes, SECTION_ALIGNMENT);
+    }
+
+    const std::string temporary = path + ".tmp";
+    std::FILE* f = std::fopen(temporary.c_str(), "wb");
+    if (!f) {
+        error = "cannot create " + temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    static const char padding[SECTION_ALIGNMENT] = {};
+    size_t written = 0;
+    auto put = [&](const void* data, size_t bytes) {
+        written += std::fwrite(data, 1, bytes, f);
+    };
+    put(&header, sizeof(header));
+    put(table.data(), table.size() * sizeof(SnapshotSection));
+    for (size_t i = 0; i < payloads.size(); i++) {
+        put(padding, table[i].offset - written);
+        put(payloads[i].packed.empty() ? payloads[i].data : payloads[i].packed.data(), table[i].storedBytes);
+    }
+    bool ok = std::fflush(f) == 0 && written == table.back().offset + table.back().storedBytes;
+#ifdef WAVESIM_HAVE_MMAP
+    // The rename below must not reach the disk before the data does
+    ok = ok && fsync(fileno(f)) == 0;
+#endif
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "failed to write " + path + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Read-only view of a snapshot file: a private mapping where available, else a copy.
+class SnapshotFile {
+public:
+    ~SnapshotFile() {
+#ifdef WAVESIM_HAVE_MMAP
+        if (m_map) munmap(m_map, m_bytes);
+#endif
+    }
+
+    bool open(const std::string& path, std::string& error) {
+#ifdef WAVESIM_HAVE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            error = "cannot open " + path + ": " + std::strerror(errno);
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        m_bytes = size_t(st.st_size);
+        if (m_bytes > 0) {
+            void* p = mmap(nullptr, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_map = p;
+                m_data = static_cast<const char*>(p);
+            }
+        }
+        ::close(fd);
+        if (!m_data && m_bytes > 0) {
+            error = "cannot map " + path + ": " + std::strerror(errno);
+            return false;
+        }
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            error = "cannot open " + path;
+            return false;
+        }
+        m_copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m_data = m_copy.data();
+        m_bytes = m_copy.size();
+#endif
+        return true;
+    }
+
+    const char* data() const { return m_data; }
+    size_t bytes() const { return m_bytes; }
+
+private:
+    void* m_map = nullptr;
+    const char* m_data = nullptr;
+    size_t m_bytes = 0;
+    std::vector<char> m_copy;
+};
+
+// Returns a section's raw bytes, inflating into `scratch` when it is compressed
+const char* sectionData(const SnapshotFile& file, const SnapshotSection& section, std::vector<char>& scratch,
+                        std::string& error) {
+    const char* stored = file.data() + section.offset;
+    if (section.encoding == static_cast<uint32_t>(SnapshotEncoding::RAW)) return stored;
+#ifdef WAVESIM_HAVE_ZLIB
+    if (section.encoding == static_cast<uint32_t>(SnapshotEncoding::DEFLATE)) {
+        scratch.resize(section.rawBytes);
+        uLongf length = static_cast<uLongf>(section.rawBytes);
+        if (uncompress(reinterpret_cast<Bytef*>(scratch.data()), &length, reinterpret_cast<const Bytef*>(stored),
+                       static_cast<uLong>(section.storedBytes)) != Z_OK ||
+            length != section.rawBytes) {
+            error = "corrupt compressed section";
+            return nullptr;
+        }
+        return scratch.data();
+    }
+#else
+    (void)scratch;
+    if (section.encoding == static_cast<uint32_t>(SnapshotEncoding::DEFLATE)) {
+        error = "snapshot is compressed and this build has no zlib";
+        return nullptr;
+    }
+#endif
+    error = "unknown section encoding " + std::to_string(section.encoding);
+    return nullptr;
+}
+
+} // namespace
+
+bool snapshotCompressionAvailable() {
+#ifdef WAVESIM_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool saveSnapshot(const std::string& path, const Simulation& sim, const SnapshotInfo& info,
+                  const SnapshotOptions& options, std::string& error) {
+    const size_t cells = size_t(sim.size) * sim.size;
+    std::vector<float> u(cells), uPrev(cells), edges(size_t(4) * sim.size);
+    std::vector<uint8_t> walls(cells);
+    packRowMajor(sim, sim.u, u.data());
+    packRowMajor(sim, sim.u_prev, uPrev.data());
+    packRowMajor(sim, sim.walls, walls.data());
+    copyEdges(sim, sim.u_prev2.data(), edges.data());
+    return writeSnapshotFile(path, sim, info, u.data(), uPrev.data(), edges.data(), walls.data(), options, error);
+}
+
+bool loadSnapshot(const std::string& path, Simulation& sim, SnapshotInfo& info, std::string& error) {
+    SnapshotFile file;
+    if (!file.open(path, error)) return false;
+
+    SnapshotHeader header;
+    if (file.bytes() < sizeof(header)) {
+        error = path + " is not a snapshot";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a snapshot";
+        return false;
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        error = path + " is snapshot version " + std::to_string(header.version) + ", expected " +
+                std::to_string(SNAPSHOT_VERSION);
+        return false;
+    }
+    const size_t cells = size_t(header.size) * header.size;
+    if (header.size < 3 || sizeof(header) + size_t(header.sectionCount) * sizeof(SnapshotSection) > file.bytes()) {
+        error = path + " is truncated";
+        return false;
+    }
+
+    // Every section this version writes must be present with the expected size
+    const SnapshotSection* sections[7] = {};
+    for (uint32_t i = 0; i < header.sectionCount; i++) {
+        const SnapshotSection* s =
+            reinterpret_cast<const SnapshotSection*>(file.data() + sizeof(header)) + i;
+        if (s->offset > file.bytes() || s->storedBytes > file.bytes() - s->offset) {
+            error = path + " is truncated";
+            return false;
+        }
+        if (s->id >= 1 && s->id <= 6) sections[s->id] = s;
+    }
+    const size_t expected[7] = { 0, cells * sizeof(float), cells * sizeof(float), size_t(4) * header.size * sizeof(float),
+                                 cells, 0, 0 };
+    for (int id = 1; id <= 6; id++) {
+        if (!sections[id] || (expected[id] && sections[id]->rawBytes != expected[id])) {
+            error = path + " is missing section " + std::to_string(id);
+            return false;
+        }
+    }
+
+    std::vector<char> scratch;
+    auto decode = [&](SnapshotSectionId id) {
+        const char* data = sectionData(file, *sections[static_cast<int>(id)], scratch, error);
+        if (!data) error = path + ": " + error;
+        return data;
+    };
+
+    // Parse the small sections before touching `sim`
+    const char* data = decode(SnapshotSectionId::SOURCES);
+    if (!data) return false;
+    Reader sourceReader = { data, data + sections[static_cast<int>(SnapshotSectionId::SOURCES)]->rawBytes };
+    SourceStore sources;
+    uint32_t sourceCount = 0;
+    bool ok = sourceReader.read(sourceCount);
+    for (uint32_t i = 0; ok && i < sourceCount; i++) {
+        float values[4];
+        uint32_t active;
+        std::string name;
+        ok = sourceReader.read(values) && sourceReader.read(active) && sourceReader.readString(name);
+        if (ok) {
+            WaveSource source(values[0], values[1], values[2], values[3], name);
+            source.active = active != 0;
+            sources.add(source);
+        }
+    }
+    data = ok ? decode(SnapshotSectionId::INFO) : nullptr;
+    if (!data) {
+        if (error.empty()) error = path + ": corrupt source table";
+        return false;
+    }
+    Reader infoReader = { data, data + sections[static_cast<int>(SnapshotSectionId::INFO)]->rawBytes };
+    SnapshotInfo loaded;
+    if (!infoReader.readString(loaded.owner) || !infoReader.readString(loaded.status)) {
+        error = path + ": corrupt info section";
+        return false;
+    }
+    loaded.steps = header.steps;
+    loaded.stopReference = header.stopReference;
+
+    // Fresh (untouched) fields in the caller's layout
+    Simulation restored(static_cast<int>(header.size), sim.layout);
+    if (!(data = decode(SnapshotSectionId::U))) return false;
+    unpackRowMajor(restored, reinterpret_cast<const float*>(data), restored.u);
+    if (!(data = decode(SnapshotSectionId::U_PREV))) return false;
+    unpackRowMajor(restored, reinterpret_cast<const float*>(data), restored.u_prev);
+    if (!(data = decode(SnapshotSectionId::WALLS))) return false;
+    unpackRowMajor(restored, reinterpret_cast<const uint8_t*>(data), restored.walls);
+    if (!(data = decode(SnapshotSectionId::U_PREV2_EDGES))) return false;
+    const float* edges = reinterpret_cast<const float*>(data);
+    const int n = restored.size;
+    for (int i = 0; i < n; i++) {
+        restored.u_prev2[restored.index(i, 0)] = edges[i];
+        restored.u_prev2[restored.index(i, n - 1)] = edges[n + i];
+        restored.u_prev2[restored.index(0, i)] = edges[2 * n + i];
+        restored.u_prev2[restored.index(n - 1, i)] = edges[3 * n + i];
+    }
+
+    restored.sources = std::move(sources);
+    restored.time = header.time;
+    restored.dt = header.dt;
+    restored.waveSpeed = header.waveSpeed;
+    restored.damping = header.damping;
+    restored.wallReflectivity = header.wallReflectivity;
+    sim = std::move(restored);
+    info = loaded;
+    return true;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool SnapshotWriter::begin(const std::string& path, const Simulation& sim, const SnapshotInfo& info,
+                           const SnapshotOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_copying || m_writing) return false;
+    }
+    if (m_thread.joinable()) m_thread.join();
+
+    m_path = path;
+    m_u = sim.u.data();
+    m_uPrev = sim.u_prev.data();
+    m_walls = sim.walls.data();
+    m_edges.resize(size_t(4) * sim.size);
+    copyEdges(sim, sim.u_prev2.data(), m_edges.data());
+    m_state.size = sim.size;
+    m_state.layout = sim.layout;
+    m_state.pitch = sim.pitch;
+    m_state.tiles = sim.tiles;
+    m_state.sources = sim.sources;
+    m_state.time = sim.time;
+    m_state.dt = sim.dt;
+    m_state.waveSpeed = sim.waveSpeed;
+    m_state.damping = sim.damping;
+    m_state.wallReflectivity = sim.wallReflectivity;
+    m_info = info;
+    m_options = options;
+    m_error.clear();
+    m_copying = true;
+    m_writing = true;
+    m_thread = std::thread([this] { run(); });
+    return true;
+}
+
+void SnapshotWriter::run() {
+    const size_t cells = size_t(m_state.size) * m_state.size;
+    std::vector<float> u(cells), uPrev(cells);
+    std::vector<uint8_t> walls(cells);
+    // u_prev first: the caller's second step overwrites it, the third overwrites u
+    packRowMajor(m_state, m_uPrev, uPrev.data());
+    packRowMajor(m_state, m_u, u.data());
+    packRowMajor(m_state, m_walls, walls.data());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_copying = false;
+    }
+    m_settled.notify_all();
+
+    std::string error;
+    const bool ok = writeSnapshotFile(m_path, m_state, m_info, u.data(), uPrev.data(), m_edges.data(), walls.data(),
+                                      m_options, error);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!ok) m_error = error;
+    m_writing = false;
+}
+
+void SnapshotWriter::settle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_settled.wait(lock, [this] { return !m_copying; });
+}
+
+bool SnapshotWriter::busy() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_copying || m_writing;
+}
+
+bool SnapshotWriter::finish(std::string& error) {
+    if (m_thread.joinable()) m_thread.join();
+    if (m_error.empty()) return true;
+    error = m_error;
+    m_error.clear();
+    return false;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary snapshots of a running simulation, for resuming after a crash or forking a run
+// from an interesting moment.
+//
+// File layout (little endian): a SnapshotHeader, a table of SnapshotSection entries, then
+// the sections, each 64-byte aligned. Fields and walls are stored dense and row-major
+// whatever the in-memory layout, so a snapshot restores into either layout. Uncompressed
+// sections are read straight out of a read-only mapping of the file; compressed ones
+// (deflate, when built with zlib) are inflated first.
+//
+// u and u_prev are stored whole but u_prev2 only as its edge ring: the next step writes
+// the interior of u_prev2's buffer without reading it, while the edges are never updated by
+// the stencil (only by edits such as ripples) and are read again two steps later. Restoring
+// a snapshot therefore continues the run bit for bit.
+
+const uint32_t SNAPSHOT_VERSION = 1;
+
+// U_PREV2_EDGES holds rows 0 and size-1, then columns 0 and size-1 (size floats each)
+enum class SnapshotSectionId : uint32_t { U = 1, U_PREV = 2, U_PREV2_EDGES = 3, WALLS = 4, SOURCES = 5, INFO = 6 };
+enum class SnapshotEncoding : uint32_t { RAW = 0, DEFLATE = 1 };
+
+struct SnapshotHeader {
+    char magic[8];                  // "WSSNAP\0\0"
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t size;
+    uint32_t layout;                // FieldLayout when saved (informational)
+    uint64_t steps;
+    double stopReference;
+    float time;
+    float dt;
+    float waveSpeed;
+    float damping;
+    float wallReflectivity;
+    uint32_t reserved[5];
+};
+
+struct SnapshotSection {
+    uint32_t id;                    // SnapshotSectionId
+    uint32_t encoding;              // SnapshotEncoding
+    uint64_t offset;                // from the start of the file
+    uint64_t rawBytes;
+    uint64_t storedBytes;
+};
+
+// Run state beyond the Simulation, recorded by whoever owns the run.
+struct SnapshotInfo {
+    uint64_t steps = 0;             // steps taken so far
+    double stopReference = -1.0;    // stop-condition state (batch: energy at the last check)
+    std::string owner;              // e.g. the batch member name
+    std::string status;             // owner-defined; empty while running
+};
+
+struct SnapshotOptions {
+    bool compress = false;          // deflate the sections (ignored without zlib)
+};
+
+bool snapshotCompressionAvailable();
+
+// Writes `sim` to `path` (via a temporary file renamed into place, so a crash never leaves
+// a torn snapshot behind).
+bool saveSnapshot(const std::string& path, const Simulation& sim, const SnapshotInfo& info,
+                  const SnapshotOptions& options, std::string& error);
+
+// Restores `path` into `sim`, which keeps its field layout and takes the snapshot's size.
+bool loadSnapshot(const std::string& path, Simulation& sim, SnapshotInfo& info, std::string& error);
+
+// Saves snapshots without pausing the solver. begin() only copies the sources, physics and
+// u_prev2's edges; the writer thread copies u, u_prev and the walls out of the live buffers
+// and then compresses and writes the file on its own. Until settle() returns, the caller
+// may step once (that step only writes the interior of u_prev2's buffer) but must not step
+// further or edit the scene. settle() rarely waits: the copy runs at memory speed.
+class SnapshotWriter {
+public:
+    SnapshotWriter() = default;
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Returns false (and writes nothing) while a previous snapshot is still being written.
+    bool begin(const std::string& path, const Simulation& sim, const SnapshotInfo& info,
+               const SnapshotOptions& options = SnapshotOptions());
+    // Blocks until the writer no longer reads the caller's fields.
+    void settle();
+    // True while a snapshot is being copied or written.
+    bool busy();
+    // Waits for the current snapshot; returns false with `error` set if it failed.
+    bool finish(std::string& error);
+
+private:
+    void run();
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_settled;
+    bool m_copying = false;
+    bool m_writing = false;
+    std::string m_error;
+
+    // Captured by begin()
+    std::string m_path;
+    const float* m_u = nullptr;
+    const float* m_uPrev = nullptr;
+    const uint8_t* m_walls = nullptr;
+    std::vector<float> m_edges;     // u_prev2's edge ring
+    Simulation m_state{ 0 };        // geometry, physics and sources; no fields
+    SnapshotInfo m_info;
+    SnapshotOptions m_options;
+};
@@ -0,0 +1,382 @@
+#include "Solver.h"
+
+#include "PerfCounters.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* kernelVariantName(KernelVariant variant) {
+    switch (variant) {
+        case KernelVariant::SCALAR: return "scalar";
+        case KernelVariant::SIMD: return "simd";
+        default: return "unknown";
+    }
+}
+
+// Wave equation with Verlet integration for interior rows [y0, y1), columns [x0, x1)
+void updateStencilRows(Simulation& sim, float c2_dt2, int y0, int y1, int x0, int x1) {
+    const int size = sim.size;
+    const int pitch = sim.pitch;
+    y0 = std::max(y0, 1);
+    y1 = std::min(y1, size - 1);
+    x0 = std::max(x0, 1);
+    x1 = std::min(x1, size - 1);
+
+    // Tiled storage goes through the accessor; row-major keeps plain offsets
+    const bool tiled = sim.layout == FieldLayout::TILED;
+
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            int idx = tiled ? sim.index(x, y) : y * pitch + x;
+
+            if (sim.walls[idx]) {
+                // Apply wall reflectivity: mix between absorption and reflection
+                // Perfect reflection (1.0) inverts the wave, full absorption (0.0) zeros it
+                sim.u[idx] = -sim.u_prev[idx] * sim.wallReflectivity;
+                continue;
+            }
+
+            // 5-point Laplacian
+            float laplacian =
+                sim.u_prev[tiled ? sim.index(x, y - 1) : idx - pitch] +
+                sim.u_prev[tiled ? sim.index(x, y + 1) : idx + pitch] +
+                sim.u_prev[tiled ? sim.index(x - 1, y) : idx - 1] +
+                sim.u_prev[tiled ? sim.index(x + 1, y) : idx + 1] -
+                4.0f * sim.u_prev[idx];
+
+            // Verlet with damping
+            sim.u[idx] = 2.0f * sim.u_prev[idx] - sim.u_prev2[idx] + c2_dt2 * laplacian;
+            sim.u[idx] *= sim.damping;
+        }
+    }
+}
+
+namespace {
+
+// How wall cells reflect: PERFECT (reflectivity 1) is a plain negation
+enum class WallMode { NONE, PERFECT, SCALED };
+
+struct RowArgs {
+    const float* up;
+    const float* mid;
+    const float* down;
+    const float* prev2;
+    const uint8_t* wall;
+    float* out;
+    float c2_dt2;
+    float damping;
+    float reflect;      // -wallReflectivity
+};
+
+// One row of the SIMD stencil, specialized at compile time so the inner loop carries no
+// multiply by a damping of 1, no reflectivity multiply for perfect walls and no wall
+// select at all on rows without walls. Every specialization rounds exactly like the
+// general form (x * 1 and -x * 1 are exact), so results stay bit-identical.
+template <WallMode Walls, bool Damped>
+void stencilRow(const RowArgs& a, int x0, int x1) {
+    const float* __restrict up = a.up;
+    const float* __restrict mid = a.mid;
+    const float* __restrict down = a.down;
+    const float* __restrict prev2 = a.prev2;
+    const uint8_t* __restrict wall = a.wall;
+    float* __restrict out = a.out;
+    const float c2_dt2 = a.c2_dt2;
+    const float damping = a.damping;
+    const float reflect = a.reflect;
+
+    for (int x = x0; x < x1; x++) {
+        float laplacian = up[x] + down[x] + mid[x - 1] + mid[x + 1] - 4.0f * mid[x];
+        float wave = 2.0f * mid[x] - prev2[x] + c2_dt2 * laplacian;
+        if constexpr (Damped) wave *= damping;
+        if constexpr (Walls == WallMode::NONE) {
+            out[x] = wave;
+        } else {
+            float reflected = (Walls == WallMode::PERFECT) ? -mid[x] : mid[x] * reflect;
+            out[x] = wall[x] ? reflected : wave;
+        }
+    }
+}
+
+// Single cell of the same specialization with explicit left/right neighbours, for tile
+// edge columns whose horizontal neighbours live in the adjacent tile.
+template <WallMode Walls, bool Damped>
+void stencilCell(const RowArgs& a, int x, float left, float right) {
+    float laplacian = a.up[x] + a.down[x] + left + right - 4.0f * a.mid[x];
+    float wave = 2.0f * a.mid[x] - a.prev2[x] + a.c2_dt2 * laplacian;
+    if constexpr (Damped) wave *= a.damping;
+    if constexpr (Walls == WallMode::NONE) {
+        a.out[x] = wave;
+    } else {
+        float reflected = (Walls == WallMode::PERFECT) ? -a.mid[x] : a.mid[x] * a.reflect;
+        a.out[x] = a.wall[x] ? reflected : wave;
+    }
+}
+
+using RowKernel = void (*)(const RowArgs&, int, int);
+using CellKernel = void (*)(const RowArgs&, int, float, float);
+
+RowKernel selectRowKernel(WallMode walls, bool damped) {
+    static const RowKernel table[3][2] = {
+        { stencilRow<WallMode::NONE, false>, stencilRow<WallMode::NONE, true> },
+        { stencilRow<WallMode::PERFECT, false>, stencilRow<WallMode::PERFECT, true> },
+        { stencilRow<WallMode::SCALED, false>, stencilRow<WallMode::SCALED, true> },
+    };
+    return table[static_cast<int>(walls)][damped ? 1 : 0];
+}
+
+CellKernel selectCellKernel(WallMode walls, bool damped) {
+    static const CellKernel table[3][2] = {
+        { stencilCell<WallMode::NONE, false>, stencilCell<WallMode::NONE, true> },
+        { stencilCell<WallMode::PERFECT, false>, stencilCell<WallMode::PERFECT, true> },
+        { stencilCell<WallMode::SCALED, false>, stencilCell<WallMode::SCALED, true> },
+    };
+    return table[static_cast<int>(walls)][damped ? 1 : 0];
+}
+
+// OR-reduction over the mask; vectorizes and touches bytes the wall kernel reads anyway
+bool anyWalls(const uint8_t* __restrict wall, int x0, int x1) {
+    uint8_t any = 0;
+    for (int x = x0; x < x1; x++) any |= wall[x];
+    return any != 0;
+}
+
+} // namespace
+
+void updateStencilRect(const StencilView& view, float c2_dt2, float damping, float wallReflectivity,
+                       int y0, int y1, int x0, int x1) {
+    if (x1 <= x0) return;
+    const bool damped = damping != 1.0f;
+    const WallMode wallMode = (wallReflectivity == 1.0f) ? WallMode::PERFECT : WallMode::SCALED;
+    const RowKernel openRow = selectRowKernel(WallMode::NONE, damped);
+    const RowKernel wallRow = selectRowKernel(wallMode, damped);
+
+    const int pitch = view.pitch;
+    RowArgs a;
+    a.c2_dt2 = c2_dt2;
+    a.damping = damping;
+    a.reflect = -wallReflectivity;
+    for (int y = y0; y < y1; y++) {
+        a.up = view.u_prev + size_t(y - 1) * pitch;
+        a.mid = view.u_prev + size_t(y) * pitch;
+        a.down = view.u_prev + size_t(y + 1) * pitch;
+        a.prev2 = view.u_prev2 + size_t(y) * pitch;
+        a.wall = view.walls + size_t(y) * pitch;
+        a.out = view.u + size_t(y) * pitch;
+        (anyWalls(a.wall, x0, x1) ? wallRow : openRow)(a, x0, x1);
+    }
+}
+
+// Same update as updateStencilRows, but each row is a straight-line loop over raw
+// pointers with the wall test turned into a select, so the compiler can vectorize it.
+// The row kernel is picked per call from the physics parameters and per row from the
+// wall mask, so edits take effect on the next step. Operation order matches the scalar
+// kernel exactly, keeping results bit-identical.
+void updateStencilRowsSimd(Simulation& sim, float c2_dt2, int y0, int y1, int x0, int x1) {
+    const int size = sim.size;
+    StencilView view;
+    view.u = sim.u.data();
+    view.u_prev = sim.u_prev.data();
+    view.u_prev2 = sim.u_prev2.data();
+    view.walls = sim.walls.data();
+    view.pitch = sim.pitch;
+    updateStencilRect(view, c2_dt2, sim.damping, sim.wallReflectivity, std::max(y0, 1), std::min(y1, size - 1),
+                      std::max(x0, 1), std::min(x1, size - 1));
+}
+
+// SIMD update over tile rows [ty0, ty1) of a TILED simulation. The rows above and below
+// a tile row are contiguous runs in the same or the vertically adjacent tile, so only the
+// two edge columns of each tile need a neighbour from another tile.
+void updateStencilTilesSimd(Simulation& sim, float c2_dt2, int ty0, int ty1) {
+    const int size = sim.size;
+    const int T = FIELD_TILE;
+    const int tileCells = T * T;
+    const int tileRow = sim.tiles * tileCells;
+
+    const bool damped = sim.damping != 1.0f;
+    const WallMode wallMode = (sim.wallReflectivity == 1.0f) ? WallMode::PERFECT : WallMode::SCALED;
+    const RowKernel openRow = selectRowKernel(WallMode::NONE, damped);
+    const RowKernel wallRow = selectRowKernel(wallMode, damped);
+    const CellKernel openCell = selectCellKernel(WallMode::NONE, damped);
+    const CellKernel wallCell = selectCellKernel(wallMode, damped);
+
+    const float* prev = sim.u_prev.data();
+    RowArgs a;
+    a.c2_dt2 = c2_dt2;
+    a.damping = sim.damping;
+    a.reflect = -sim.wallReflectivity;
+    for (int ty = ty0; ty < ty1; ty++) {
+        const int y0 = std::max(1, ty * T);
+        const int y1 = std::min(size - 1, (ty + 1) * T);
+        for (int tx = 0; tx < sim.tiles; tx++) {
+            const int lx0 = std::max(1, tx * T) - tx * T;
+            const int lx1 = std::min(size - 1, (tx + 1) * T) - tx * T;
+            if (lx1 <= lx0) continue;
+            const int base = (ty * sim.tiles + tx) * tileCells;
+
+            for (int y = y0; y < y1; y++) {
+                const int ly = y - ty * T;
+                const int row = base + ly * T;
+                a.up = prev + (ly > 0 ? row - T : row - tileRow + (T - 1) * T);
+                a.mid = prev + row;
+                a.down = prev + (ly < T - 1 ? row + T : row + tileRow - (T - 1) * T);
+                a.prev2 = sim.u_prev2.data() + row;
+                a.wall = sim.walls.data() + row;
+                a.out = sim.u.data() + row;
+
+                const bool walls = anyWalls(a.wall, lx0, lx1);
+                const int in0 = std::max(lx0, 1);
+                const int in1 = std::min(lx1, T - 1);
+                if (in1 > in0) (walls ? wallRow : openRow)(a, in0, in1);
+                if (lx0 == 0) {
+                    (walls ? wallCell : openCell)(a, 0, a.mid[-tileCells + T - 1], a.mid[1]);
+                }
+                if (lx1 == T) {
+                    (walls ? wallCell : openCell)(a, T - 1, a.mid[T - 2], a.mid[tileCells]);
+                }
+            }
+        }
+    }
+}
+
+void updateStencil(Simulation& sim, float c2_dt2, KernelVariant variant, ThreadPool* pool, int tileWidth) {
+    if (sim.layout == FieldLayout::TILED && variant == KernelVariant::SIMD) {
+        // Tiles already bound the working set; tileWidth does not apply
+        auto tileRows = [&](int ty0, int ty1) { updateStencilTilesSimd(sim, c2_dt2, ty0, ty1); };
+        if (pool) {
+            pool->parallelFor(0, sim.tiles, tileRows);
+        } else {
+            tileRows(0, sim.tiles);
+        }
+        return;
+    }
+
+    auto rows = (variant == KernelVariant::SIMD) ? updateStencilRowsSimd : updateStencilRows;
+    // Column strips keep the three u_prev rows of a strip in L1/L2 while walking down a band
+    auto band = [&](int y0, int y1) {
+        if (tileWidth <= 0) {
+            rows(sim, c2_dt2, y0, y1, 1, sim.size - 1);
+            return;
+        }
+        for (int x0 = 1; x0 < sim.size - 1; x0 += tileWidth) {
+            rows(sim, c2_dt2, y0, y1, x0, x0 + tileWidth);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(1, sim.size - 1, band);
+    } else {
+        band(1, sim.size - 1);
+    }
+}
+
+void firstTouchFields(Simulation& sim, ThreadPool* pool) {
+    // Writing one element per page faults it in on the writing thread; the rows (or tile
+    // rows) are split exactly as updateStencil splits them, with the border rows going
+    // to the first and last band.
+    const bool tiled = sim.layout == FieldLayout::TILED;
+    const size_t rowCells = tiled ? size_t(sim.tiles) * FIELD_TILE * FIELD_TILE : size_t(sim.pitch);
+    const int first = tiled ? 0 : 1;
+    const int last = tiled ? sim.tiles : sim.size - 1;
+    auto touch = [&](int y0, int y1) {
+        if (!tiled && y0 == 1) y0 = 0;
+        if (!tiled && y1 == sim.size - 1) y1 = sim.size;
+        const size_t begin = static_cast<size_t>(y0) * rowCells;
+        const size_t end = static_cast<size_t>(y1) * rowCells;
+        const size_t stride = 4096 / sizeof(float);
+        for (auto* field : { &sim.u, &sim.u_prev, &sim.u_prev2 }) {
+            volatile float* data = field->data();
+            for (size_t i = begin; i < end; i += stride) data[i] = data[i];
+        }
+        volatile uint8_t* walls = sim.walls.data();
+        for (size_t i = begin; i < end; i += 4096) walls[i] = walls[i];
+    };
+    if (pool) {
+        pool->parallelFor(first, last, touch);
+    } else {
+        touch(first, last);
+    }
+}
+
+// Apply wave sources
+void injectSources(Simulation& sim) {
+    const int size = sim.size;
+
+    const SourceStore& sources = sim.sources;
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (!sources.active(i)) continue;
+
+        int sx = static_cast<int>(sources.x(i));
+        int sy = static_cast<int>(sources.y(i));
+
+        if (sx >= 5 && sx < size - 5 && sy >= 5 && sy < size - 5) {
+            float value = sources.amplitude(i) * std::sin(2.0f * PI * sources.frequency(i) * sim.time);
+
+            // Gaussian source
+            for (int dy = -4; dy <= 4; dy++) {
+                for (int dx = -4; dx <= 4; dx++) {
+                    float dist = std::sqrt(dx*dx + dy*dy);
+                    if (dist < 5.0f) {
+                        int idx = sim.index(sx + dx, sy + dy);
+                        if (!sim.walls[idx]) {
+                            float falloff = std::exp(-dist * dist / 12.0f);
+                            sim.u[idx] += value * falloff;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void injectSourcesRect(float* u, const uint8_t* walls, int pitch, int originX, int originY,
+                       int x0, int x1, int y0, int y1, int gridSize,
+                       const SourceStore& sources, float time) {
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (!sources.active(i)) continue;
+
+        int sx = static_cast<int>(sources.x(i));
+        int sy = static_cast<int>(sources.y(i));
+        if (sx < 5 || sx >= gridSize - 5 || sy < 5 || sy >= gridSize - 5) continue;
+        if (sx + 4 < x0 || sx - 4 >= x1 || sy + 4 < y0 || sy - 4 >= y1) continue;
+
+        float value = sources.amplitude(i) * std::sin(2.0f * PI * sources.frequency(i) * time);
+        for (int dy = -4; dy <= 4; dy++) {
+            for (int dx = -4; dx <= 4; dx++) {
+                const int x = sx + dx, y = sy + dy;
+                if (x < x0 || x >= x1 || y < y0 || y >= y1) continue;
+                float dist = std::sqrt(dx*dx + dy*dy);
+                if (dist >= 5.0f) continue;
+                const size_t idx = size_t(y - originY) * pitch + (x - originX);
+                if (walls[idx]) continue;
+                float falloff = std::exp(-dist * dist / 12.0f);
+                u[idx] += value * falloff;
+            }
+        }
+    }
+}
+
+void stepSimulation(Simulation& sim, float dt, int steps, const SolverOptions& options) {
+    // The Verlet update uses (c*dt)^2 of the actual substep length.
+    const float c2_dt2 = sim.waveSpeed * sim.waveSpeed * dt * dt;
+    const int interior = sim.size - 2;
+
+    KernelProfiler* profiler = options.profiler;
+    const int stencilKernel = profiler ? profiler->registerKernel("Stencil") : -1;
+    const int sourceKernel = profiler ? profiler->registerKernel("Sources") : -1;
+
+    for (int s = 0; s < steps; ++s) {
+        sim.time += dt;
+
+        // Swap buffers
+        std::swap(sim.u_prev2, sim.u_prev);
+        std::swap(sim.u_prev, sim.u);
+
+        if (profiler) profiler->begin(stencilKernel);
+        updateStencil(sim, c2_dt2, options.variant, options.pool, options.tileWidth);
+        if (profiler) profiler->end(stencilKernel, static_cast<uint64_t>(interior) * interior);
+
+        if (profiler) profiler->begin(sourceKernel);
+        injectSources(sim);
+        if (profiler) profiler->end(sourceKernel, sim.sources.size() * 81);
+    }
+}
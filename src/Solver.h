@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Simulation.h"
+
+#include <climits>
+
+class KernelProfiler;
+class ThreadPool;
+
+// Compulsory memory traffic of one stencil cell update: read u_prev and u_prev2,
+// read the wall mask, write u. Neighbour reads are assumed to hit in cache.
+const double STENCIL_BYTES_PER_CELL = 3.0 * sizeof(float) + sizeof(uint8_t);
+// Floating point operations of one non-wall stencil cell update.
+const double STENCIL_FLOPS_PER_CELL = 10.0;
+
+// Stencil implementations. All variants produce bit-identical results.
+enum class KernelVariant {
+    SCALAR,     // Reference loop with a per-cell wall branch
+    SIMD,       // Branch-free rows written for auto-vectorization
+    COUNT
+};
+
+const char* kernelVariantName(KernelVariant variant);
+
+struct SolverOptions {
+    KernelVariant variant = KernelVariant::SCALAR;
+    ThreadPool* pool = nullptr;          // nullptr = run on the calling thread
+    int tileWidth = 0;                   // column strip width; 0 = whole rows (ROW_MAJOR only)
+    KernelProfiler* profiler = nullptr;  // optional per-kernel timing/counters
+};
+
+// Advance the simulation by `steps` substeps of length dt.
+void stepSimulation(Simulation& sim, float dt, int steps, const SolverOptions& options = SolverOptions());
+
+// Faults the field pages in from the pool threads that will update them, so each
+// band's memory lands on its thread's NUMA node. Call before anything writes the fields.
+void firstTouchFields(Simulation& sim, ThreadPool* pool);
+
+// Row-major field storage owned outside a Simulation (e.g. a subdomain with halo cells).
+struct StencilView {
+    float* u;
+    const float* u_prev;
+    const float* u_prev2;
+    const uint8_t* walls;
+    int pitch;
+};
+
+// SIMD update of cells [x0, x1) x [y0, y1) of `view`; every cell's four neighbours must be
+// readable. Bit-identical to the Simulation kernels for the same physics parameters.
+void updateStencilRect(const StencilView& view, float c2_dt2, float damping, float wallReflectivity,
+                       int y0, int y1, int x0, int x1);
+
+// injectSources() for storage outside a Simulation. Global cell (x, y) of a gridSize^2 grid
+// lives at u[(y - originY) * pitch + (x - originX)]; only cells in [x0, x1) x [y0, y1)
+// receive source energy. Same stamp and operation order as injectSources().
+void injectSourcesRect(float* u, const uint8_t* walls, int pitch, int originX, int originY,
+                       int x0, int x1, int y0, int y1, int gridSize,
+                       const SourceStore& sources, float time);
+
+// Individual kernels (exposed for benchmarks)
+void updateStencilRows(Simulation& sim, float c2_dt2, int y0, int y1, int x0 = 1, int x1 = INT_MAX);
+void updateStencilRowsSimd(Simulation& sim, float c2_dt2, int y0, int y1, int x0 = 1, int x1 = INT_MAX);
+void updateStencilTilesSimd(Simulation& sim, float c2_dt2, int ty0, int ty1);  // TILED layout only
+void updateStencil(Simulation& sim, float c2_dt2, KernelVariant variant, ThreadPool* pool, int tileWidth = 0);
+void injectSources(Simulation& sim);
@@ -0,0 +1,200 @@
+#include "SourceStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+// Revisions are unique across stores, so a copy only matches the store it was copied from
+std::atomic<uint64_t> g_revisions{ 0 };
+
+int cellOf(float v) {
+    float c = std::floor(v / SourceStore::PICK_CELL);
+    if (!(c > -1.0e6f)) c = -1.0e6f;    // also NaN
+    return static_cast<int>(std::min(c, 1.0e6f));
+}
+
+uint32_t hashCell(int cx, int cy) {
+    return static_cast<uint32_t>(cx) * 0x8da6b343u ^ static_cast<uint32_t>(cy) * 0xd8163841u;
+}
+
+} // namespace
+
+void SourceStore::clear() {
+    m_x.clear();
+    m_y.clear();
+    m_frequency.clear();
+    m_amplitude.clear();
+    m_active.clear();
+    m_nameId.clear();
+    m_names.clear();
+    m_nameIds.clear();
+    m_head.clear();
+    m_next.clear();
+    m_revision = ++g_revisions;
+}
+
+void SourceStore::reserve(size_t count) {
+    m_x.reserve(count);
+    m_y.reserve(count);
+    m_frequency.reserve(count);
+    m_amplitude.reserve(count);
+    m_active.reserve(count);
+    m_nameId.reserve(count);
+    m_next.reserve(count);
+}
+
+uint32_t SourceStore::intern(const std::string& name) {
+    auto it = m_nameIds.find(name);
+    if (it != m_nameIds.end()) return it->second;
+    const uint32_t id = static_cast<uint32_t>(m_names.size());
+    m_names.push_back(name);
+    m_nameIds.emplace(name, id);
+    return id;
+}
+
+void SourceStore::add(const WaveSource& source) {
+    m_x.push_back(source.x);
+    m_y.push_back(source.y);
+    m_frequency.push_back(source.frequency);
+    m_amplitude.push_back(source.amplitude);
+    m_active.push_back(source.active ? 1 : 0);
+    m_nameId.push_back(intern(source.name));
+    m_next.push_back(-1);
+    if (size() > m_head.size()) {
+        rehash(2 * size());
+    } else {
+        link(size() - 1);
+    }
+    m_revision = ++g_revisions;
+}
+
+void SourceStore::erase(size_t i) {
+    m_x.erase(m_x.begin() + i);
+    m_y.erase(m_y.begin() + i);
+    m_frequency.erase(m_frequency.begin() + i);
+    m_amplitude.erase(m_amplitude.begin() + i);
+    m_active.erase(m_active.begin() + i);
+    m_nameId.erase(m_nameId.begin() + i);
+    m_next.pop_back();
+    rehash(m_head.size());
+    m_revision = ++g_revisions;
+}
+
+size_t SourceStore::eraseWithin(float x, float y, float radius) {
+    std::vector<uint32_t> doomed;
+    within(x, y, radius, doomed);
+    if (doomed.empty()) return 0;
+    size_t kept = 0, d = 0;
+    for (size_t i = 0; i < size(); i++) {
+        if (d < doomed.size() && doomed[d] == i) {
+            d++;
+            continue;
+        }
+        m_x[kept] = m_x[i];
+        m_y[kept] = m_y[i];
+        m_frequency[kept] = m_frequency[i];
+        m_amplitude[kept] = m_amplitude[i];
+        m_active[kept] = m_active[i];
+        m_nameId[kept] = m_nameId[i];
+        kept++;
+    }
+    m_x.resize(kept);
+    m_y.resize(kept);
+    m_frequency.resize(kept);
+    m_amplitude.resize(kept);
+    m_active.resize(kept);
+    m_nameId.resize(kept);
+    m_next.resize(kept);
+    rehash(m_head.size());
+    m_revision = ++g_revisions;
+    return doomed.size();
+}
+
+WaveSource SourceStore::get(size_t i) const {
+    WaveSource s(m_x[i], m_y[i], m_frequency[i], m_amplitude[i], name(i));
+    s.active = active(i);
+    return s;
+}
+
+void SourceStore::setPosition(size_t i, float x, float y) {
+    unlink(i);
+    m_x[i] = x;
+    m_y[i] = y;
+    link(i);
+}
+
+void SourceStore::setName(size_t i, const std::string& name) {
+    m_nameId[i] = intern(name);
+    m_revision = ++g_revisions;
+}
+
+uint32_t SourceStore::bucket(float x, float y) const {
+    return hashCell(cellOf(x), cellOf(y)) & static_cast<uint32_t>(m_head.size() - 1);
+}
+
+void SourceStore::link(size_t i) {
+    const uint32_t b = bucket(m_x[i], m_y[i]);
+    m_next[i] = m_head[b];
+    m_head[b] = static_cast<int32_t>(i);
+}
+
+void SourceStore::unlink(size_t i) {
+    int32_t* p = &m_head[bucket(m_x[i], m_y[i])];
+    while (*p != static_cast<int32_t>(i)) p = &m_next[*p];
+    *p = m_next[i];
+}
+
+void SourceStore::rehash(size_t buckets) {
+    size_t n = 64;
+    while (n < buckets) n *= 2;
+    m_head.assign(n, -1);
+    for (size_t i = 0; i < size(); i++) link(i);
+}
+
+void SourceStore::within(float x, float y, float radius, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (empty()) return;
+    auto close = [&](size_t j) {
+        const float dx = m_x[j] - x;
+        const float dy = m_y[j] - y;
+        return std::sqrt(dx * dx + dy * dy) < radius;
+    };
+    const int cx0 = cellOf(x - radius), cx1 = cellOf(x + radius);
+    const int cy0 = cellOf(y - radius), cy1 = cellOf(y + radius);
+    if (double(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > double(size())) {
+        // A radius wider than the scene: scanning is cheaper than visiting the cells
+        for (size_t j = 0; j < size(); j++) {
+            if (close(j)) out.push_back(static_cast<uint32_t>(j));
+        }
+        return;
+    }
+    const uint32_t mask = static_cast<uint32_t>(m_head.size() - 1);
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            // A bucket can hold other cells that hash alike; each source is taken from its own cell
+            for (int32_t j = m_head[hashCell(cx, cy) & mask]; j >= 0; j = m_next[j]) {
+                if (cellOf(m_x[j]) == cx && cellOf(m_y[j]) == cy && close(j)) out.push_back(static_cast<uint32_t>(j));
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+int SourceStore::nearest(float x, float y, float radius) const {
+    std::vector<uint32_t> candidates;
+    within(x, y, radius, candidates);
+    int best = -1;
+    float bestDist = radius;
+    for (uint32_t j : candidates) {
+        const float dx = x - m_x[j];
+        const float dy = y - m_y[j];
+        const float dist = std::sqrt(dx * dx + dy * dy);
+        if (dist < bestDist) {
+            best = static_cast<int>(j);
+            bestDist = dist;
+        }
+    }
+    return best;
+}
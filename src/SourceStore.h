@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Wave source
+struct WaveSource {
+    float x, y;
+    float frequency;
+    float amplitude;
+    bool active;
+    std::string name;
+
+    WaveSource(float x, float y, float freq, float amp, const std::string& n = "Source")
+        : x(x), y(y), frequency(freq), amplitude(amp), active(true), name(n) {}
+};
+
+// The sources of a scene as parallel arrays, so the injection loop reads only the columns
+// it needs, with names interned (an array of thousands of elements usually shares a few).
+//
+// Positions are indexed in a uniform grid of PICK_CELL-sized cells hashed into a bucket
+// table, so picking near a point only looks at the sources in the cells the pick radius
+// touches. Positions therefore change only through setPosition(). Erasing keeps the order
+// (injection order is part of the result) and rebuilds the index, which is O(n) like the
+// erase itself.
+class SourceStore {
+public:
+    static constexpr float PICK_CELL = 32.0f;
+
+    size_t size() const { return m_x.size(); }
+    bool empty() const { return m_x.empty(); }
+    void clear();
+    void reserve(size_t count);
+    void add(const WaveSource& source);
+    void erase(size_t i);
+    // Erases every source closer than `radius` to (x, y); returns how many
+    size_t eraseWithin(float x, float y, float radius);
+
+    float x(size_t i) const { return m_x[i]; }
+    float y(size_t i) const { return m_y[i]; }
+    float frequency(size_t i) const { return m_frequency[i]; }
+    float amplitude(size_t i) const { return m_amplitude[i]; }
+    bool active(size_t i) const { return m_active[i] != 0; }
+    const std::string& name(size_t i) const { return m_names[m_nameId[i]]; }
+    uint32_t nameId(size_t i) const { return m_nameId[i]; }
+    const std::vector<std::string>& names() const { return m_names; }
+    WaveSource get(size_t i) const;
+
+    void setPosition(size_t i, float x, float y);
+    void setFrequency(size_t i, float frequency) { m_frequency[i] = frequency; }
+    void setAmplitude(size_t i, float amplitude) { m_amplitude[i] = amplitude; }
+    void setActive(size_t i, bool active) { m_active[i] = active ? 1 : 0; }
+    void setName(size_t i, const std::string& name);
+
+    // Closest source less than `radius` away (the lowest index on a tie), or -1
+    int nearest(float x, float y, float radius) const;
+    // Sources less than `radius` away, in ascending order
+    void within(float x, float y, float radius, std::vector<uint32_t>& out) const;
+
+    // Changes whenever sources are added, erased or renamed (not moved or retuned); copies
+    // share it until either changes
+    uint64_t revision() const { return m_revision; }
+
+private:
+    uint32_t intern(const std::string& name);
+    uint32_t bucket(float x, float y) const;
+    void link(size_t i);
+    void unlink(size_t i);
+    void rehash(size_t buckets);
+
+    std::vector<float> m_x, m_y;
+    std::vector<float> m_frequency, m_amplitude;
+    std::vector<uint8_t> m_active;
+    std::vector<uint32_t> m_nameId;
+
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, uint32_t> m_nameIds;
+
+    // Bucket chains: m_head[bucket] is the newest source in it, m_next[i] the one before i
+    std::vector<int32_t> m_head;
+    std::vector<int32_t> m_next;
+    uint64_t m_revision = 0;
+};
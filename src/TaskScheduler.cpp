@@ -0,0 +1,62 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+TaskScheduler::TaskScheduler(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = threads;
+}
+
+bool TaskScheduler::pop(std::vector<Queue>& queues, int self, const std::function<void(int)>*& task) {
+    {
+        Queue& own = queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    // Steal from the back of the next non-empty queue, starting after our own
+    const int n = static_cast<int>(queues.size());
+    for (int i = 1; i < n; i++) {
+        Queue& victim = queues[(self + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::run(const std::vector<std::function<void(int)>>& tasks) {
+    if (tasks.empty()) return;
+    const int workers = std::min<int>(threadCount, static_cast<int>(tasks.size()));
+
+    // Tasks never spawn tasks, so a worker that finds every queue empty is done
+    std::vector<Queue> queues(workers);
+    for (size_t i = 0; i < tasks.size(); i++) {
+        queues[i % workers].tasks.push_back(&tasks[i]);
+    }
+
+    auto work = [&](int self) {
+        const std::function<void(int)>* task = nullptr;
+        while (pop(queues, self, task)) {
+            (*task)(self);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
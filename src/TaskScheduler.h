@@ -0,0 +1,31 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Work-stealing scheduler for independent coarse tasks (one simulation per task).
+// Tasks are dealt round-robin to per-worker deques; a worker pops from the front of its
+// own deque and, when empty, steals from the back of the others. Unlike ThreadPool,
+// which splits one loop into fixed bands, this balances tasks of very different cost.
+class TaskScheduler {
+public:
+    explicit TaskScheduler(int threadCount = 0);  // 0 = hardware concurrency
+
+    int size() const { return threadCount; }
+
+    // Runs every task to completion across the workers (the caller is worker 0).
+    // fn(workerIndex) lets tasks use per-worker scratch state.
+    void run(const std::vector<std::function<void(int)>>& tasks);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<const std::function<void(int)>*> tasks;
+    };
+
+    int threadCount;
+
+    bool pop(std::vector<Queue>& queues, int self, const std::function<void(int)>*& task);
+};
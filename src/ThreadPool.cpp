@@ -0,0 +1,83 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::band(int begin, int end, int index, int& bandBegin, int& bandEnd) const {
+    const int count = end - begin;
+    const int threads = size();
+    bandBegin = begin + static_cast<int>(static_cast<long long>(count) * index / threads);
+    bandEnd = begin + static_cast<int>(static_cast<long long>(count) * (index + 1) / threads);
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& fn) {
+    if (end <= begin) return;
+    if (workers.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobBegin = begin;
+        jobEnd = end;
+        pending = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    int b, e;
+    band(begin, end, 0, b, e);
+    if (b < e) fn(b, e);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::workerLoop(int index) {
+    unsigned seen = 0;
+    while (true) {
+        const std::function<void(int, int)>* fn;
+        int begin, end;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            fn = job;
+            begin = jobBegin;
+            end = jobEnd;
+        }
+
+        int b, e;
+        band(begin, end, index, b, e);
+        if (b < e) (*fn)(b, e);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool for data-parallel loops. parallelFor() splits a range into one
+// contiguous band per thread; band i always runs on thread i (the caller is thread 0),
+// so repeated loops over the same range touch the same memory from the same thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount = 0);  // 0 = hardware concurrency
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Calls fn(begin, end) for each band of [begin, end). Blocks until all bands finish.
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& fn);
+
+    // Band owned by thread `index` when [begin, end) is split across `size()` threads.
+    void band(int begin, int end, int index, int& bandBegin, int& bandEnd) const;
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int, int)>* job = nullptr;
+    int jobBegin = 0;
+    int jobEnd = 0;
+    unsigned generation = 0;
+    int pending = 0;
+    bool stopping = false;
+
+    void workerLoop(int index);
+};
@@ -8,13 +8,31 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cfloat>
 #include <algorithm>
 #include <random>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
+#include <memory>
+
+#include "AutoTune.h"
+#include "Brush.h"
+#include "FieldStore.h"
+#include "ImageWriter.h"
+#include "InputLatency.h"
+#include "PerfCounters.h"
+#include "Recording.h"
+#include "Rewind.h"
+#include "SceneLoader.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "Solver.h"
+#include "ThreadPool.h"
 
 // Window
 const int UI_WIDTH_LOGICAL = 350;  // Width of the side panel
@@ -35,22 +53,6 @@ static void getSizes(GLFWwindow* window, int& fbW, int& fbH, int& viewportW, int
     viewportH = std::max(1, fbH);
 }
 
-// Grid
-const int GRID_SIZE = 512;
-const float PI = 3.14159265359f;
-
-// Wave source
-struct WaveSource {
-    float x, y;
-    float frequency;
-    float amplitude;
-    bool active;
-    std::string name;
-    
-    WaveSource(float x, float y, float freq, float amp, const std::string& n = "Source") 
-        : x(x), y(y), frequency(freq), amplitude(amp), active(true), name(n) {}
-};
-
 // Tool enum
 enum class Tool {
     ADD_SOURCE,
@@ -59,26 +61,12 @@ enum class Tool {
     ERASE_WALL,
     SNAP_WALL,
     INTERACT,
-    MOVE_SOURCE
+    MOVE_SOURCE,
+    FILL_WALL
 };
 
-// Simulation state
-struct Simulation {
-    std::vector<float> u;           // Current displacement
-    std::vector<float> u_prev;      // Previous displacement
-    std::vector<float> u_prev2;     // Two steps back
-    std::vector<bool> walls;
-    std::vector<WaveSource> sources;
-    
-    float time = 0.0f;
-    // Physics
-    // Note: this wave solver implicitly assumes a grid spacing of 1.
-    // Keeping waveSpeed moderate (and dt stable) dramatically improves visual quality.
-    float waveSpeed = 6.0f;
-    float damping = 0.9995f;
-    float wallReflectivity = 1.0f;  // 1.0 = perfect reflection, 0.0 = full absorption
-    float dt = 1.0f / 60.0f; // base (used as a clamp/target)
-    
+// Application state: the simulation plus interactive tool, input and display settings
+struct AppState : Simulation {
     // Tools and interaction
     Tool currentTool = Tool::INTERACT;
     float newSourceFreq = 3.0f;
@@ -97,6 +85,9 @@ struct Simulation {
     // Move source mode
     int draggedSourceIndex = -1;
     
+    // Brush for Draw, Erase and Snap Wall
+    Brush brush;
+
     // Snap wall mode
     bool snapWallFirstPoint = true;
     int snapWallX1 = -1;
@@ -112,13 +103,6 @@ struct Simulation {
     int visualMode = 0;  // UI selection: 0=Rainbow, 1=Grayscale, 2=Blue-Red, 3=Cyan-Yellow
     float contrast = 1.5f;
     
-    Simulation() {
-        u.resize(GRID_SIZE * GRID_SIZE, 0.0f);
-        u_prev.resize(GRID_SIZE * GRID_SIZE, 0.0f);
-        u_prev2.resize(GRID_SIZE * GRID_SIZE, 0.0f);
-        walls.resize(GRID_SIZE * GRID_SIZE, false);
-    }
-    
     // Screenshot notification system
     bool showScreenshotNotification = false;
     std::chrono::steady_clock::time_point screenshotNotificationTime;
@@ -130,10 +114,106 @@ GLuint g_VAO = 0;
 GLuint g_VBO = 0;
 GLuint g_waveTexture = 0;
 GLuint g_wallTexture = 0;
+// Part of the wall texture that is out of date: what the brushes changed since the last
+// upload, or the whole grid after anything else replaced the walls
+DirtyRect g_wallsDirty = DirtyRect{ 0, 0, GRID_SIZE, GRID_SIZE };
 GLuint g_gridShaderProgram = 0;
 GLuint g_gridVAO = 0;
 GLuint g_gridVBO = 0;
 
+// Profiling and solver threads (the pool is created after the profiler so that
+// inherited hardware counters also cover the worker threads). The variant, tile
+// width and thread count come from the auto-tuner at startup.
+KernelProfiler g_profiler;
+std::unique_ptr<ThreadPool> g_threadPool;
+KernelVariant g_kernelVariant = KernelVariant::SIMD;
+int g_tileWidth = 0;
+TuneResult g_tuned;
+
+// Out-of-core store being watched (--view-store); replaces the solver while set
+std::unique_ptr<FieldStore> g_store;
+
+// Background snapshot writer and the file it is writing
+SnapshotWriter g_snapshotWriter;
+std::string g_snapshotPath;
+bool g_snapshotRequested = false;
+
+// Field recording to recordings/ (every g_recordEvery solver steps) and playback of a
+// recording, which replaces the live field on screen and pauses the solver while open
+std::unique_ptr<FieldRecorder> g_recorder;
+int g_recordEvery = 2;
+uint64_t g_recordedSteps = 0;
+std::unique_ptr<RecordingReader> g_playback;
+std::string g_playbackPath;
+int g_playbackFrame = 0;
+bool g_playbackPlaying = false;
+std::vector<float> g_playbackField;
+std::vector<uint8_t> g_playbackWalls;
+
+// Recent history behind the timeline scrubber
+RewindBuffer g_rewind;
+bool g_rewindEnabled = true;
+
+// Presets are built off the main thread and swapped in before the next frame's steps
+SceneLoader g_sceneLoader;
+// Scene files in scenes/ (listed under Presets), and the probes of the scene on screen
+std::vector<SceneSpec> g_sceneFiles;
+std::vector<SceneProbe> g_probes;
+
+// Screenshots: each captured frame is read into a pixel-pack buffer behind a fence, mapped
+// a frame or two later once the GPU is done, and encoded as PNG on g_imageWriter's threads.
+// WINDOW captures the whole framebuffer, FIELD re-renders the waves at grid resolution.
+enum class CaptureMode { WINDOW, FIELD };
+struct PendingCapture {
+    GLuint buffer;
+    GLsync fence;
+    int width, height;
+    std::string path;
+};
+ImageWriter g_imageWriter;
+CaptureMode g_captureMode = CaptureMode::WINDOW;
+std::vector<PendingCapture> g_pendingCaptures;
+std::vector<GLuint> g_freeCaptureBuffers;
+GLuint g_captureFramebuffer = 0;
+GLuint g_captureTexture = 0;
+int g_captureFramesLeft = 0;        // frames still to read back
+int g_captureBurst = 0;             // frames in the current burst (0: single screenshot)
+int g_captureSaved = 0;
+int g_burstFrames = 30;
+std::string g_captureName;
+
+// Cursor and button events, timestamped in the GLFW callbacks and applied at the solver
+// substep their time falls in (see updateSimulation), so an edit is in the field for the
+// rest of the frame's steps and a fast drag is applied along every point GLFW reported
+struct InputEvent {
+    enum Type { MOVE, PRESS, RELEASE };
+    Type type;
+    double time;                    // glfwGetTime()
+    float x, y;                     // grid coordinates
+    uint64_t latencyId;             // g_latency event, 0 when not measured
+};
+std::vector<InputEvent> g_inputEvents;
+float g_cursorX = -10.0f, g_cursorY = -10.0f;  // latest cursor position, for button events
+bool g_buttonDown = false;          // a PRESS is queued or applied without its RELEASE
+const float RIPPLE_SPACING = 3.0f;  // cells between ripple stamps along a drag
+float g_rippleX = 0.0f, g_rippleY = 0.0f, g_rippleCarry = 0.0f;
+
+// Input-to-photon latency (Profiler panel). After each swap a GL timestamp query (or a
+// fence where the driver has no timestamp bits) marks when the GPU got past that frame;
+// they are polled, never waited on. Query times are moved to glfwGetTime()'s clock with an
+// offset re-measured about once a second.
+struct LatencyFrame {
+    uint64_t frame;
+    GLuint query;
+    GLsync fence;
+};
+LatencyTracker g_latency;
+std::vector<LatencyFrame> g_latencyFrames;
+std::vector<GLuint> g_freeLatencyQueries;
+bool g_latencyQueries = false;      // timestamp queries usable
+double g_gpuClockOffset = 0.0;      // glfwGetTime() - GPU timestamp seconds
+double g_gpuClockCalibrated = -1.0;
+
 // Grid to screen coordinates
 glm::vec2 gridToScreen(float gx, float gy) {
     return glm::vec2((gx / GRID_SIZE) * 2.0f - 1.0f, (gy / GRID_SIZE) * 2.0f - 1.0f);
@@ -146,100 +226,36 @@ glm::vec2 screenToGrid(float sx, float sy) {
     return glm::vec2(gx, gy);
 }
 
-// Add wave source
-void addSource(float x, float y, float freq, float amp) {
-    g_sim.sources.emplace_back(x, y, freq, amp, "Source " + std::to_string(g_sim.sources.size() + 1));
-}
-
-// Remove wave source
-void removeSource(float x, float y) {
-    g_sim.sources.erase(
-        std::remove_if(g_sim.sources.begin(), g_sim.sources.end(),
-            [x, y](const WaveSource& src) {
-                float dx = src.x - x;
-                float dy = src.y - y;
-                return std::sqrt(dx*dx + dy*dy) < 25.0f;
-            }),
-        g_sim.sources.end()
-    );
-}
-
-// Set wall with brush
-void setWall(int x, int y, bool state) {
-    if (x >= 0 && x < GRID_SIZE && y >= 0 && y < GRID_SIZE) {
-        for (int dy = -2; dy <= 2; dy++) {
-            for (int dx = -2; dx <= 2; dx++) {
-                int nx = x + dx;
-                int ny = y + dy;
-                if (nx >= 0 && nx < GRID_SIZE && ny >= 0 && ny < GRID_SIZE) {
-                    g_sim.walls[ny * GRID_SIZE + nx] = state;
-                }
-            }
-        }
-    }
-}
-
-// Bresenham line for wall drawing
-void drawLine(int x0, int y0, int x1, int y1, bool drawWall) {
-    int dx = abs(x1 - x0);
-    int dy = abs(y1 - y0);
-    int sx = x0 < x1 ? 1 : -1;
-    int sy = y0 < y1 ? 1 : -1;
-    int err = dx - dy;
-    
-    while (true) {
-        setWall(x0, y0, drawWall);
-        if (x0 == x1 && y0 == y1) break;
-        
-        int e2 = 2 * err;
-        if (e2 > -dy) {
-            err -= dy;
-            x0 += sx;
-        }
-        if (e2 < dx) {
-            err += dx;
-            y0 += sy;
-        }
-    }
-}
-
-// Clear functions
-void clearWaves() {
-    std::fill(g_sim.u.begin(), g_sim.u.end(), 0.0f);
-    std::fill(g_sim.u_prev.begin(), g_sim.u_prev.end(), 0.0f);
-    std::fill(g_sim.u_prev2.begin(), g_sim.u_prev2.end(), 0.0f);
-    g_sim.time = 0.0f;
-}
-
-void clearWalls() {
-    std::fill(g_sim.walls.begin(), g_sim.walls.end(), false);
-}
-
-void clearSources() {
-    g_sim.sources.clear();
-}
-
-// Screenshot functionality
-void takeScreenshot() {
-    // Create screenshots directory if it doesn't exist
+// Creates (if needed) and returns `name` under the project root, falling back to the
+// working directory
+std::string projectDirectory(const std::string& name) {
     // Get the directory where the executable is located
     std::string executablePath = std::filesystem::current_path().string();
-    std::string screenshotsDir = executablePath + "/screenshots";
+    std::string dir = executablePath + "/" + name;
     
     // Try to find the project root by looking for CMakeLists.txt or src/ directory
     std::filesystem::path currentDir = std::filesystem::current_path();
     while (currentDir.has_parent_path()) {
         if (std::filesystem::exists(currentDir / "CMakeLists.txt") || 
             std::filesystem::exists(currentDir / "src")) {
-            screenshotsDir = currentDir.string() + "/screenshots";
+            dir = currentDir.string() + "/" + name;
             break;
         }
         currentDir = currentDir.parent_path();
     }
     
-    std::filesystem::create_directories(screenshotsDir);
-    
-    // Generate timestamp for filename
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+void rescanScenes() {
+    std::vector<std::string> errors;
+    g_sceneFiles = readSceneDirectory(projectDirectory("scenes"), errors);
+    for (const auto& error : errors) std::cout << "❌ " << error << std::endl;
+}
+
+// wave_sim_<date>_<time>_<ms><extension>
+std::string timestampedName(const std::string& extension) {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
@@ -249,173 +265,340 @@ void takeScreenshot() {
     filename << "wave_sim_" 
              << std::put_time(tm, "%Y%m%d_%H%M%S_") 
              << std::setfill('0') << std::setw(3) << ms.count() 
-             << ".png";
-    
-    std::string fullPath = screenshotsDir + "/" + filename.str();
-    
-    // Use macOS screencapture utility
-    std::string command = "screencapture -x " + fullPath;
-    int result = std::system(command.c_str());
-    
-    if (result == 0) {
-        std::cout << "📸 Screenshot saved: " << filename.str() << std::endl;
-        // Show notification
-        g_sim.showScreenshotNotification = true;
-        g_sim.screenshotNotificationTime = std::chrono::steady_clock::now();
+             << extension;
+    return filename.str();
+}
+
+// Screenshot functionality: `frames` consecutive frames starting with the next one
+void requestCapture(int frames) {
+    if (g_captureFramesLeft > 0) return;
+    g_captureFramesLeft = frames;
+    g_captureBurst = frames > 1 ? frames : 0;
+    g_captureSaved = 0;
+    g_captureName = timestampedName("");
+}
+
+void takeScreenshot() {
+    requestCapture(1);
+}
+
+void invalidateWalls() {
+    g_wallsDirty = wholeGrid(g_sim);
+}
+
+// A brush changed `rect`: upload it, and let the history know the walls changed
+void wallsEdited(const DirtyRect& rect) {
+    if (rect.empty()) return;
+    g_wallsDirty.include(rect);
+    g_rewind.markEdited();
+}
+
+// Resample the watched store into the display grid a few times a second; the run writing
+// it may be in another process
+void refreshFromStore() {
+    static auto lastRefresh = std::chrono::steady_clock::time_point();
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastRefresh < std::chrono::milliseconds(250)) return;
+    lastRefresh = now;
+
+    static std::vector<float> u(GRID_SIZE * GRID_SIZE), walls(GRID_SIZE * GRID_SIZE);
+    g_store->overview(GRID_SIZE, u.data(), walls.data());
+    for (int y = 0; y < GRID_SIZE; y++) {
+        for (int x = 0; x < GRID_SIZE; x++) {
+            const size_t i = size_t(y) * GRID_SIZE + x;
+            g_sim.u[g_sim.index(x, y)] = u[i];
+            g_sim.walls[g_sim.index(x, y)] = walls[i] > 0.5f ? 1 : 0;
+        }
+    }
+    g_sim.time = g_store->header().time;
+    invalidateWalls();
+}
+
+// Snapshots: F5 saves in the background, F9 restores the newest one in snapshots/
+void requestSnapshot() {
+    g_snapshotRequested = true;
+}
+
+// Called between stepping and rendering; the writer copies the fields while the frame
+// renders and settleSnapshot() runs before anything can edit them
+void beginRequestedSnapshot() {
+    if (!g_snapshotRequested) return;
+    g_snapshotRequested = false;
+    g_snapshotPath = projectDirectory("snapshots") + "/" + timestampedName(".wsnap");
+    SnapshotInfo info;
+    info.owner = "gui";
+    if (!g_snapshotWriter.begin(g_snapshotPath, g_sim, info)) {
+        std::cout << "❌ Snapshot skipped: the previous one is still being written" << std::endl;
+        g_snapshotPath.clear();
+    }
+}
+
+void settleSnapshot() {
+    g_snapshotWriter.settle();
+    if (!g_snapshotPath.empty() && !g_snapshotWriter.busy()) {
+        std::string error;
+        if (g_snapshotWriter.finish(error)) {
+            std::cout << "💾 Snapshot saved: " << g_snapshotPath << std::endl;
+        } else {
+            std::cout << "❌ Snapshot failed: " << error << std::endl;
+        }
+        g_snapshotPath.clear();
+    }
+}
+
+bool restoreSnapshot(const std::string& path) {
+    g_snapshotWriter.settle();
+    Simulation restored(GRID_SIZE, g_sim.layout);
+    SnapshotInfo info;
+    std::string error;
+    if (!loadSnapshot(path, restored, info, error)) {
+        std::cout << "❌ " << error << std::endl;
+        return false;
+    }
+    if (restored.size != GRID_SIZE) {
+        std::cout << "❌ " << path << " is " << restored.size << "^2; this build shows " << GRID_SIZE << "^2" << std::endl;
+        return false;
+    }
+    static_cast<Simulation&>(g_sim) = std::move(restored);
+    g_rewind.markEdited();
+    invalidateWalls();
+    std::cout << "Restored snapshot " << path << " (t = " << g_sim.time << " s)" << std::endl;
+    return true;
+}
+
+void restoreLatestSnapshot() {
+    std::filesystem::path latest;
+    std::filesystem::file_time_type latestTime;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(projectDirectory("snapshots"), ec)) {
+        if (entry.path().extension() != ".wsnap") continue;
+        if (latest.empty() || entry.last_write_time() > latestTime) {
+            latest = entry.path();
+            latestTime = entry.last_write_time();
+        }
+    }
+    if (latest.empty()) {
+        std::cout << "No snapshots to restore" << std::endl;
+        return;
+    }
+    restoreSnapshot(latest.string());
+}
+
+// Recordings: the encoder runs on its own threads; the solver only copies the field
+void startRecording() {
+    RecordingOptions options;
+    options.every = g_recordEvery;
+    std::string error;
+    const std::string path = projectDirectory("recordings") + "/" + timestampedName(".wsrec");
+    g_recorder = FieldRecorder::create(path, GRID_SIZE, options, error);
+    if (!g_recorder) {
+        std::cout << "❌ Recording failed: " << error << std::endl;
+        return;
+    }
+    g_recordedSteps = 0;
+    std::cout << "⏺ Recording to " << path << std::endl;
+}
+
+void stopRecording() {
+    std::string error;
+    if (g_recorder->close(error)) {
+        std::cout << "⏹ Recorded " << g_recorder->framesWritten() << " frames (" << g_recorder->framesDropped()
+                  << " dropped) to " << g_recorder->path() << std::endl;
     } else {
-        std::cout << "❌ Screenshot failed" << std::endl;
+        std::cout << "❌ Recording failed: " << error << std::endl;
     }
+    g_recorder.reset();
 }
-// Load presets
-void loadPreset(const std::string& name) {
-    clearWaves();
-    clearWalls();
-    clearSources();
-    
-    if (name == "Double Slit") {
-        // Two sources at top
-        addSource(GRID_SIZE * 0.25f, GRID_SIZE * 0.8f, 5.0f, 2.0f);
-        addSource(GRID_SIZE * 0.75f, GRID_SIZE * 0.8f, 5.0f, 2.0f);
-        
-        // Wall with two slits
-        for (int y = GRID_SIZE * 0.45f; y < GRID_SIZE * 0.55f; y++) {
-            for (int x = GRID_SIZE * 0.1f; x < GRID_SIZE * 0.9f; x++) {
-                if (x < GRID_SIZE * 0.35f || 
-                    (x > GRID_SIZE * 0.42f && x < GRID_SIZE * 0.58f) ||
-                    x > GRID_SIZE * 0.65f) {
-                    setWall(x, y, true);
-                }
-            }
+
+bool showPlaybackFrame(int frame) {
+    std::string error;
+    if (!g_playback->readFrame(frame, g_playbackField.data(), g_playbackWalls.data(), error)) {
+        std::cout << "❌ " << error << std::endl;
+        g_playbackPlaying = false;
+        return false;
+    }
+    g_playbackFrame = frame;
+    return true;
+}
+
+void openLatestRecording() {
+    std::filesystem::path latest;
+    std::filesystem::file_time_type latestTime;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(projectDirectory("recordings"), ec)) {
+        if (entry.path().extension() != ".wsrec") continue;
+        // The one being written is not closed yet
+        if (g_recorder && entry.path() == g_recorder->path()) continue;
+        if (latest.empty() || entry.last_write_time() > latestTime) {
+            latest = entry.path();
+            latestTime = entry.last_write_time();
         }
-    } else if (name == "Ripple Tank") {
-        // Central source
-        addSource(GRID_SIZE * 0.5f, GRID_SIZE * 0.5f, 3.0f, 2.0f);
-    } else if (name == "Interference") {
-        // Two sources creating interference pattern
-        addSource(GRID_SIZE * 0.3f, GRID_SIZE * 0.5f, 4.0f, 1.8f);
-        addSource(GRID_SIZE * 0.7f, GRID_SIZE * 0.5f, 4.0f, 1.8f);
-    } else if (name == "Reflection") {
-        // Source on left, wall on right
-        addSource(GRID_SIZE * 0.2f, GRID_SIZE * 0.5f, 3.0f, 2.0f);
-        
-        for (int y = GRID_SIZE * 0.2f; y < GRID_SIZE * 0.8f; y++) {
-            for (int x = GRID_SIZE * 0.75f; x < GRID_SIZE * 0.78f; x++) {
-                setWall(x, y, true);
-            }
+    }
+    if (latest.empty()) {
+        std::cout << "No recordings to open" << std::endl;
+        return;
+    }
+    std::string error;
+    std::unique_ptr<RecordingReader> reader = RecordingReader::open(latest.string(), error);
+    if (!reader) {
+        std::cout << "❌ " << error << std::endl;
+        return;
+    }
+    if (reader->size() != GRID_SIZE || reader->frameCount() == 0) {
+        std::cout << "❌ " << latest.string() << " has no " << GRID_SIZE << "^2 frames" << std::endl;
+        return;
+    }
+    g_playback = std::move(reader);
+    g_playbackPath = latest.string();
+    g_playbackField.resize(GRID_SIZE * GRID_SIZE);
+    g_playbackWalls.resize(GRID_SIZE * GRID_SIZE);
+    g_playbackPlaying = false;
+    if (!showPlaybackFrame(0)) g_playback.reset();
+}
+
+void exportPlayback() {
+    std::filesystem::path out(g_playbackPath);
+    out.replace_extension(".npy");
+    std::string error;
+    if (exportRecordingNpy(*g_playback, out.string(), 0, g_playback->frameCount() - 1, 1, error)) {
+        std::cout << "Exported " << g_playback->frameCount() << " frames to " << out.string() << std::endl;
+    } else {
+        std::cout << "❌ Export failed: " << error << std::endl;
+    }
+}
+
+// Applies one input event with the current tool
+void applyInputEvent(const InputEvent& event) {
+    if (event.latencyId) g_latency.applied(event.latencyId, glfwGetTime());
+    if (event.type == InputEvent::RELEASE) {
+        g_sim.mousePressed = false;
+        g_sim.draggedSourceIndex = -1; // Release dragged source
+        // Reset drag state for non-snap tools
+        if (g_sim.currentTool != Tool::SNAP_WALL) {
+            g_sim.lastMouseX = -1;
+            g_sim.lastMouseY = -1;
         }
-    } else if (name == "Circular Arena") {
-        // Circular boundary
-        float cx = GRID_SIZE * 0.5f;
-        float cy = GRID_SIZE * 0.5f;
-        float radius = GRID_SIZE * 0.4f;
-        
-        for (int y = 0; y < GRID_SIZE; y++) {
-            for (int x = 0; x < GRID_SIZE; x++) {
-                float dx = x - cx;
-                float dy = y - cy;
-                float dist = std::sqrt(dx*dx + dy*dy);
-                if (dist > radius && dist < radius + 10) {
-                    g_sim.walls[y * GRID_SIZE + x] = true;
-                }
-            }
+        return;
+    }
+    g_sim.mouseX = event.x;
+    g_sim.mouseY = event.y;
+    const bool press = event.type == InputEvent::PRESS;
+    if (press) g_sim.mousePressed = true;
+    if (!g_sim.mousePressed) return;
+
+    int gridX = static_cast<int>(event.x);
+    int gridY = static_cast<int>(event.y);
+
+    // Bounds check
+    if (gridX < 0 || gridX >= GRID_SIZE || gridY < 0 || gridY >= GRID_SIZE) {
+        return;
+    }
+
+    // Handle tools
+    if (g_sim.currentTool == Tool::ADD_SOURCE) {
+        // Single click to add source
+        if (press) {
+            addSource(g_sim, static_cast<float>(gridX), static_cast<float>(gridY), g_sim.newSourceFreq, g_sim.newSourceAmp);
         }
-        
-        // Source in center
-        addSource(cx, cy, 3.0f, 1.8f);
-    } else if (name == "Standing Waves") {
-        // Two opposing sources with same frequency
-        addSource(GRID_SIZE * 0.2f, GRID_SIZE * 0.5f, 4.0f, 2.0f);
-        addSource(GRID_SIZE * 0.8f, GRID_SIZE * 0.5f, 4.0f, 2.0f);
-        
-        // Side walls to create resonance chamber
-        for (int y = GRID_SIZE * 0.3f; y < GRID_SIZE * 0.7f; y++) {
-            setWall(GRID_SIZE * 0.1f, y, true);
-            setWall(GRID_SIZE * 0.9f, y, true);
-        }
-    } else if (name == "Lens Focus") {
-        // Parabolic mirror/lens shape
-        float cx = GRID_SIZE * 0.5f;
-        float focusX = GRID_SIZE * 0.2f;
-        float parabolaWidth = GRID_SIZE * 0.3f;
-        
-        for (int y = 0; y < GRID_SIZE; y++) {
-            for (int x = GRID_SIZE * 0.6f; x < GRID_SIZE * 0.9f; x++) {
-                float dy = y - cx;
-                float parabolaX = GRID_SIZE * 0.75f + (dy * dy) / (4.0f * parabolaWidth);
-                if (std::abs(x - parabolaX) < 3) {
-                    g_sim.walls[y * GRID_SIZE + x] = true;
-                }
-            }
+
+    } else if (g_sim.currentTool == Tool::INTERACT) {
+        // Ripples along the whole drag, evenly spaced, starting with one at the press
+        if (press) {
+            applyRipple(g_sim, gridX, gridY);
+            g_rippleCarry = 0.0f;
+        } else {
+            g_rippleCarry = applyRippleStroke(g_sim, g_rippleX, g_rippleY, event.x, event.y, RIPPLE_SPACING, g_rippleCarry);
         }
-        
-        // Source at focus point
-        addSource(focusX, cx, 3.5f, 2.0f);
-    } else if (name == "Corner Cavity") {
-        // L-shaped cavity
-        // Horizontal wall
-        for (int x = GRID_SIZE * 0.2f; x < GRID_SIZE * 0.8f; x++) {
-            for (int y = GRID_SIZE * 0.48f; y < GRID_SIZE * 0.52f; y++) {
-                if (x < GRID_SIZE * 0.5f) {
-                    setWall(x, y, true);
-                }
-            }
+        g_rippleX = event.x;
+        g_rippleY = event.y;
+        g_rewind.markEdited();
+
+    } else if (g_sim.currentTool == Tool::REMOVE_SOURCE) {
+        // Single click to remove source
+        if (press) {
+            removeSource(g_sim, static_cast<float>(gridX), static_cast<float>(gridY));
         }
-        // Vertical wall
-        for (int y = GRID_SIZE * 0.2f; y < GRID_SIZE * 0.8f; y++) {
-            for (int x = GRID_SIZE * 0.48f; x < GRID_SIZE * 0.52f; x++) {
-                if (y > GRID_SIZE * 0.5f) {
-                    setWall(x, y, true);
-                }
-            }
+
+    } else if (g_sim.currentTool == Tool::MOVE_SOURCE) {
+        if (press) {
+            // Find closest source within range (20 cells)
+            g_sim.draggedSourceIndex = g_sim.sources.nearest(event.x, event.y, 20.0f);
         }
-        
-        // Sources in corners
-        addSource(GRID_SIZE * 0.3f, GRID_SIZE * 0.3f, 3.0f, 1.5f);
-        addSource(GRID_SIZE * 0.7f, GRID_SIZE * 0.7f, 3.0f, 1.5f);
-    } else if (name == "Wave Guide") {
-        // Channel walls
-        for (int x = GRID_SIZE * 0.1f; x < GRID_SIZE * 0.9f; x++) {
-            for (int y = GRID_SIZE * 0.35f; y < GRID_SIZE * 0.4f; y++) {
-                setWall(x, y, true);
-            }
-            for (int y = GRID_SIZE * 0.6f; y < GRID_SIZE * 0.65f; y++) {
-                setWall(x, y, true);
-            }
+        // Drag source to new position - update continuously while dragging
+        if (g_sim.draggedSourceIndex >= 0 && g_sim.draggedSourceIndex < static_cast<int>(g_sim.sources.size())) {
+            g_sim.sources.setPosition(g_sim.draggedSourceIndex,
+                                      std::clamp(static_cast<float>(gridX), 0.0f, static_cast<float>(GRID_SIZE - 1)),
+                                      std::clamp(static_cast<float>(gridY), 0.0f, static_cast<float>(GRID_SIZE - 1)));
         }
-        
-        // Source at entrance
-        addSource(GRID_SIZE * 0.15f, GRID_SIZE * 0.5f, 4.0f, 2.0f);
-    } else if (name == "Multiple Slits") {
-        // Source at top
-        addSource(GRID_SIZE * 0.5f, GRID_SIZE * 0.15f, 4.0f, 2.0f);
-        
-        // Wall with multiple slits (diffraction grating)
-        for (int x = GRID_SIZE * 0.2f; x < GRID_SIZE * 0.8f; x++) {
-            for (int y = GRID_SIZE * 0.45f; y < GRID_SIZE * 0.5f; y++) {
-                // Create 5 slits
-                int slitWidth = GRID_SIZE * 0.02f;
-                int slitSpacing = GRID_SIZE * 0.1f;
-                bool inSlit = false;
-                for (int i = 0; i < 5; i++) {
-                    int slitCenter = GRID_SIZE * 0.3f + i * slitSpacing;
-                    if (std::abs(x - slitCenter) < slitWidth) {
-                        inSlit = true;
-                        break;
-                    }
-                }
-                if (!inSlit) {
-                    setWall(x, y, true);
-                }
-            }
+
+    } else if (g_sim.currentTool == Tool::SNAP_WALL) {
+        // Two-click snap wall mode
+        if (!press) return;
+        if (g_sim.snapWallFirstPoint) {
+            // First click - store position
+            g_sim.snapWallX1 = gridX;
+            g_sim.snapWallY1 = gridY;
+            g_sim.snapWallFirstPoint = false;
+            std::cout << "Snap wall: First point at (" << gridX << ", " << gridY << ")" << std::endl;
+        } else {
+            // Second click - draw line from first to second point
+            std::cout << "Snap wall: Second point at (" << gridX << ", " << gridY << "), drawing line..." << std::endl;
+            wallsEdited(strokeBrush(g_sim, g_sim.snapWallX1, g_sim.snapWallY1, gridX, gridY, g_sim.brush, true));
+            g_sim.snapWallFirstPoint = true;
+            g_sim.snapWallX1 = -1;
+            g_sim.snapWallY1 = -1;
+        }
+        g_sim.mousePressed = false;  // Consume the click
+
+    } else if (g_sim.currentTool == Tool::DRAW_WALL || g_sim.currentTool == Tool::ERASE_WALL) {
+        bool drawWall = (g_sim.currentTool == Tool::DRAW_WALL);
+
+        if (g_sim.lastMouseX >= 0 && g_sim.lastMouseY >= 0) {
+            wallsEdited(strokeBrush(g_sim, g_sim.lastMouseX, g_sim.lastMouseY, gridX, gridY, g_sim.brush, drawWall));
+        } else {
+            wallsEdited(stampBrush(g_sim, gridX, gridY, g_sim.brush, drawWall));
+        }
+
+    } else if (g_sim.currentTool == Tool::FILL_WALL) {
+        // Fills open water with wall, or clears a wall, whichever was clicked
+        if (press) {
+            const bool open = !g_sim.walls[g_sim.index(gridX, gridY)];
+            wallsEdited(floodFillWalls(g_sim, gridX, gridY, open));
         }
     }
-    
-    std::cout << "Loaded preset: " << name << std::endl;
+    g_sim.lastMouseX = gridX;
+    g_sim.lastMouseY = gridY;
 }
 
-// Update wave simulation
-void updateSimulation(float deltaTime) {
+// Applies the queued events that happened at or before `time`
+void applyInputUntil(double time) {
+    size_t n = 0;
+    while (n < g_inputEvents.size() && g_inputEvents[n].time <= time) applyInputEvent(g_inputEvents[n++]);
+    g_inputEvents.erase(g_inputEvents.begin(), g_inputEvents.begin() + n);
+}
+
+// Update wave simulation over the frame that ended at `frameEnd` (glfwGetTime())
+void updateSimulation(float deltaTime, double frameEnd) {
+    // A preset finished loading: it replaces the scene between steps
+    if (g_sceneLoader.adopt(g_sim, &g_probes)) {
+        g_sim.draggedSourceIndex = -1;
+        g_rewind.markEdited();
+        invalidateWalls();
+    }
+    if (g_playback || g_sim.paused || g_store) applyInputUntil(frameEnd);
+    if (g_playback) {
+        // One recorded frame per displayed frame
+        if (g_playbackPlaying) {
+            if (g_playbackFrame + 1 < g_playback->frameCount()) showPlaybackFrame(g_playbackFrame + 1);
+            else g_playbackPlaying = false;
+        }
+        return;
+    }
     if (g_sim.paused) return;
+    if (g_store) {
+        refreshFromStore();
+        return;
+    }
 
     // Use a fixed-ish timestep for stability and consistent visuals.
     // We clamp large frame times and sub-step so waves don't "explode" or get mushy.
@@ -423,69 +606,52 @@ void updateSimulation(float deltaTime) {
     int steps = std::clamp(static_cast<int>(std::ceil(frameDt / g_sim.dt)), 1, 8);
     float dt = (steps > 0) ? (frameDt / steps) : 0.0f;
 
-    // The Verlet update uses (c*dt)^2; this was previously using g_sim.dt regardless
-    // of actual frame time, which makes the simulation feel wrong and can look noisy.
-    float c2_dt2 = g_sim.waveSpeed * g_sim.waveSpeed * dt * dt;
-
-    for (int s = 0; s < steps; ++s) {
-        g_sim.time += dt;
-    
-        // Swap buffers
-        std::swap(g_sim.u_prev2, g_sim.u_prev);
-        std::swap(g_sim.u_prev, g_sim.u);
-
-        // Wave equation with Verlet integration
-        for (int y = 1; y < GRID_SIZE - 1; y++) {
-            for (int x = 1; x < GRID_SIZE - 1; x++) {
-                int idx = y * GRID_SIZE + x;
+    SolverOptions options;
+    options.variant = g_kernelVariant;
+    options.pool = g_threadPool.get();
+    options.tileWidth = g_tileWidth;
+    options.profiler = &g_profiler;
 
-                if (g_sim.walls[idx]) {
-                    // Apply wall reflectivity: mix between absorption and reflection
-                    // Perfect reflection (1.0) inverts the wave, full absorption (0.0) zeros it
-                    g_sim.u[idx] = -g_sim.u_prev[idx] * g_sim.wallReflectivity;
-                    continue;
-                }
-
-                // 5-point Laplacian
-                float laplacian =
-                    g_sim.u_prev[(y-1) * GRID_SIZE + x] +
-                    g_sim.u_prev[(y+1) * GRID_SIZE + x] +
-                    g_sim.u_prev[y * GRID_SIZE + (x-1)] +
-                    g_sim.u_prev[y * GRID_SIZE + (x+1)] -
-                    4.0f * g_sim.u_prev[idx];
-
-                // Verlet with damping
-                g_sim.u[idx] = 2.0f * g_sim.u_prev[idx] - g_sim.u_prev2[idx] + c2_dt2 * laplacian;
-                g_sim.u[idx] *= g_sim.damping;
-            }
-        }
-
-        // Apply wave sources
-        for (const auto& src : g_sim.sources) {
-            if (!src.active) continue;
-
-            int sx = static_cast<int>(src.x);
-            int sy = static_cast<int>(src.y);
-
-            if (sx >= 5 && sx < GRID_SIZE - 5 && sy >= 5 && sy < GRID_SIZE - 5) {
-                float value = src.amplitude * std::sin(2.0f * PI * src.frequency * g_sim.time);
-
-                // Gaussian source
-                for (int dy = -4; dy <= 4; dy++) {
-                    for (int dx = -4; dx <= 4; dx++) {
-                        float dist = std::sqrt(dx*dx + dy*dy);
-                        if (dist < 5.0f) {
-                            int idx = (sy + dy) * GRID_SIZE + (sx + dx);
-                            if (!g_sim.walls[idx]) {
-                                float falloff = std::exp(-dist * dist / 12.0f);
-                                g_sim.u[idx] += value * falloff;
-                            }
-                        }
-                    }
-                }
+    // Substep s covers wall time [frameStart + s * stepTime, frameStart + (s + 1) * stepTime];
+    // events are applied before the first substep that starts after them
+    const double stepTime = static_cast<double>(deltaTime) / steps;
+    const double frameStart = frameEnd - deltaTime;
+    for (int s = 0; s < steps;) {
+        applyInputUntil(frameStart + s * stepTime);
+        if (!g_recorder && !g_rewindEnabled) {
+            // Nothing needs single steps: run up to the substep of the next event in one call
+            int n = steps - s;
+            if (!g_inputEvents.empty() && stepTime > 0.0) {
+                const int next = static_cast<int>(std::ceil((g_inputEvents.front().time - frameStart) / stepTime));
+                n = std::clamp(next - s, 1, n);
             }
+            stepSimulation(g_sim, dt, n, options);
+            g_latency.reached(LATENCY_STEPPED, glfwGetTime());
+            s += n;
+            continue;
         }
+        // Step by step so the history sees every dt and the recorder every g_recordEvery-th field
+        if (g_rewindEnabled) g_rewind.beforeStep(g_sim, dt);
+        stepSimulation(g_sim, dt, 1, options);
+        g_latency.reached(LATENCY_STEPPED, glfwGetTime());
+        if (g_recorder && ++g_recordedSteps % g_recordEvery == 0) g_recorder->capture(g_sim, g_recordedSteps);
+        s++;
     }
+    // The rest happened during the last substep; apply it before the frame is drawn
+    applyInputUntil(frameEnd);
+}
+
+// Moves the live simulation to a step in its history (pauses it; resuming discards the
+// steps after it)
+void scrubHistory(uint64_t step) {
+    SolverOptions options;
+    options.variant = g_kernelVariant;
+    options.pool = g_threadPool.get();
+    options.tileWidth = g_tileWidth;
+    std::string error;
+    g_sim.paused = true;
+    if (!g_rewind.seek(step, g_sim, options, error)) std::cout << "❌ " << error << std::endl;
+    invalidateWalls();
 }
 
 // OpenGL shader
@@ -699,27 +865,61 @@ bool initOpenGL() {
     
     glGenVertexArrays(1, &g_gridVAO);
     glGenBuffers(1, &g_gridVBO);
+
+    // Some drivers expose the query with no counter bits
+    GLint timestampBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+    g_latencyQueries = timestampBits > 0;
     
     return true;
 }
 
+void drawWaves();
+
 // Render wave field
 void renderWaves() {
     // Update textures
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, g_waveTexture);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, g_sim.u.data());
-    
-    std::vector<float> wallData(GRID_SIZE * GRID_SIZE);
-    for (size_t i = 0; i < g_sim.walls.size(); i++) {
-        wallData[i] = g_sim.walls[i] ? 1.0f : 0.0f;
+    if (g_playback) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, g_playbackField.data());
+    } else if (g_sim.layout == FieldLayout::ROW_MAJOR) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, g_sim.pitch);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, g_sim.u.data());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    } else {
+        static std::vector<float> waveData(GRID_SIZE * GRID_SIZE);
+        packRowMajor(g_sim, g_sim.u, waveData.data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, waveData.data());
     }
     
+    // Walls: only the part that changed since the last frame. Playback shows the recording's
+    // walls, so the live ones are uploaded again once it closes.
+    static std::vector<float> wallData;
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, g_wallTexture);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, wallData.data());
-    
-    // Render
+    if (g_playback) {
+        wallData.assign(g_playbackWalls.begin(), g_playbackWalls.end());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, wallData.data());
+        invalidateWalls();
+    } else if (!g_wallsDirty.empty()) {
+        const DirtyRect& r = g_wallsDirty;
+        wallsToTexture(g_sim, r, wallData);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, GL_RED, GL_FLOAT, wallData.data());
+        g_wallsDirty = DirtyRect();
+    }
+    g_latency.reached(LATENCY_UPLOADED, glfwGetTime());
+
+    drawWaves();
+}
+
+// Draws the uploaded wave and wall textures into the current viewport
+void drawWaves() {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, g_waveTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, g_wallTexture);
+
     glUseProgram(g_shaderProgram);
     glUniform1i(glGetUniformLocation(g_shaderProgram, "waveTex"), 0);
     glUniform1i(glGetUniformLocation(g_shaderProgram, "wallTex"), 1);
@@ -727,11 +927,11 @@ void renderWaves() {
     // UI uses visualMode, shader uses colorMode.
     // Map the UI selection to the active ColorMode enum used by the shader.
     switch (g_sim.visualMode) {
-        case 0: g_sim.colorMode = Simulation::RAINBOW; break;
-        case 1: g_sim.colorMode = Simulation::GRAYSCALE; break;
-        case 2: g_sim.colorMode = Simulation::BLUE_RED; break;
-        case 3: g_sim.colorMode = Simulation::CYAN_YELLOW; break;
-        default: g_sim.colorMode = Simulation::BLUE_RED; break;
+        case 0: g_sim.colorMode = AppState::RAINBOW; break;
+        case 1: g_sim.colorMode = AppState::GRAYSCALE; break;
+        case 2: g_sim.colorMode = AppState::BLUE_RED; break;
+        case 3: g_sim.colorMode = AppState::CYAN_YELLOW; break;
+        default: g_sim.colorMode = AppState::BLUE_RED; break;
     }
 
     glUniform1i(glGetUniformLocation(g_shaderProgram, "colorMode"), (int)g_sim.colorMode);
@@ -741,6 +941,162 @@ void renderWaves() {
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
 
+// Reads back the frame just rendered (or, in FIELD mode, the waves drawn at grid
+// resolution) without waiting for the GPU; collectCaptures() picks the pixels up later
+void captureFrame(int fbW, int fbH) {
+    if (g_captureFramesLeft == 0) return;
+    int width = fbW, height = fbH;
+    if (g_captureMode == CaptureMode::FIELD) {
+        if (!g_captureFramebuffer) {
+            glGenTextures(1, &g_captureTexture);
+            glBindTexture(GL_TEXTURE_2D, g_captureTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GRID_SIZE, GRID_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glGenFramebuffers(1, &g_captureFramebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, g_captureFramebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_captureTexture, 0);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, g_captureFramebuffer);
+        glViewport(0, 0, GRID_SIZE, GRID_SIZE);
+        drawWaves();
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        width = height = GRID_SIZE;
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glReadBuffer(GL_BACK);
+    }
+
+    GLuint buffer = 0;
+    if (g_freeCaptureBuffers.empty()) {
+        glGenBuffers(1, &buffer);
+    } else {
+        buffer = g_freeCaptureBuffers.back();
+        g_freeCaptureBuffers.pop_back();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(width) * height * 3, nullptr, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    const GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, fbW, fbH);
+
+    std::string name = g_captureName;
+    if (g_captureBurst) {
+        char index[16];
+        std::snprintf(index, sizeof(index), "_%04d", g_captureBurst - g_captureFramesLeft + 1);
+        name += index;
+    }
+    g_pendingCaptures.push_back({ buffer, fence, width, height, projectDirectory("screenshots") + "/" + name + ".png" });
+    g_captureFramesLeft--;
+}
+
+// Hands finished readbacks to the encoder (in order; `wait` blocks on the GPU, for shutdown)
+// and reports the files it has written
+void collectCaptures(bool wait = false) {
+    size_t done = 0;
+    for (; done < g_pendingCaptures.size(); done++) {
+        PendingCapture& c = g_pendingCaptures[done];
+        const GLenum status = glClientWaitSync(c.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(c.fence);
+
+        Image image;
+        image.path = c.path;
+        image.width = c.width;
+        image.height = c.height;
+        image.channels = 3;
+        image.bottomUp = true;
+        image.pixels.resize(size_t(c.width) * c.height * 3);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, c.buffer);
+        if (const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image.pixels.size(), GL_MAP_READ_BIT)) {
+            std::memcpy(image.pixels.data(), pixels, image.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            g_imageWriter.submit(std::move(image));
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        g_freeCaptureBuffers.push_back(c.buffer);
+    }
+    g_pendingCaptures.erase(g_pendingCaptures.begin(), g_pendingCaptures.begin() + done);
+
+    for (const ImageResult& r : g_imageWriter.finished()) {
+        if (!r.ok) {
+            std::cout << "❌ Screenshot failed: " << r.path << std::endl;
+            continue;
+        }
+        g_captureSaved++;
+        if (!g_captureBurst) {
+            std::cout << "📸 Screenshot saved: " << r.path << std::endl;
+        } else if (g_captureSaved == g_captureBurst) {
+            std::cout << "📸 Burst of " << g_captureBurst << " frames saved: " << g_captureName << "_*.png" << std::endl;
+        }
+        g_sim.showScreenshotNotification = true;
+        g_sim.screenshotNotificationTime = std::chrono::steady_clock::now();
+    }
+}
+
+// Ends the latency frame that was just swapped and marks it in the GPU command stream
+void markLatencyFrame() {
+    if (!g_latency.enabled) return;
+    const double now = glfwGetTime();
+    LatencyFrame f = { g_latency.endFrame(now), 0, nullptr };
+    if (g_latencyQueries) {
+        if (g_gpuClockCalibrated < 0.0 || now - g_gpuClockCalibrated > 1.0) {
+            GLint64 gpu = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpu);
+            g_gpuClockOffset = 0.5 * (now + glfwGetTime()) - gpu * 1e-9;
+            g_gpuClockCalibrated = now;
+        }
+        if (g_freeLatencyQueries.empty()) {
+            glGenQueries(1, &f.query);
+        } else {
+            f.query = g_freeLatencyQueries.back();
+            g_freeLatencyQueries.pop_back();
+        }
+        glQueryCounter(f.query, GL_TIMESTAMP);
+    } else {
+        f.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    g_latencyFrames.push_back(f);
+}
+
+// Completes the frames the GPU has finished (in order, without waiting). A fence only says
+// that it passed, so its frame is timed when this polls it: up to a frame late.
+void collectLatencyFrames() {
+    size_t done = 0;
+    for (; done < g_latencyFrames.size(); done++) {
+        LatencyFrame& f = g_latencyFrames[done];
+        double time = 0.0;
+        if (f.query) {
+            GLint available = 0;
+            glGetQueryObjectiv(f.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            GLuint64 gpu = 0;
+            glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &gpu);
+            time = gpu * 1e-9 + g_gpuClockOffset;
+            g_freeLatencyQueries.push_back(f.query);
+        } else {
+            const GLenum status = glClientWaitSync(f.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            glDeleteSync(f.fence);
+            time = glfwGetTime();
+        }
+        g_latency.frameDisplayed(f.frame, time);
+    }
+    g_latencyFrames.erase(g_latencyFrames.begin(), g_latencyFrames.begin() + done);
+}
+
+// Writes the measured events to traces/ for chrome://tracing or Perfetto
+void exportLatencyTrace() {
+    const std::string path = projectDirectory("traces") + "/" + timestampedName(".json");
+    std::string error;
+    if (g_latency.writeTrace(path, error)) {
+        std::cout << "Latency trace saved: " << path << std::endl;
+    } else {
+        std::cout << "❌ Trace export failed: " << error << std::endl;
+    }
+}
+
 // Render grid overlay
 void renderGrid() {
     if (!g_sim.showGrid) return;
@@ -785,6 +1141,29 @@ void renderGrid() {
     
     glDisable(GL_BLEND);
 }
+
+// Indices of the sources listed under WAVE SOURCES. The filter is matched once per interned
+// name, and the list is only rebuilt when the sources or the filter text change.
+ImGuiTextFilter g_sourceFilter;
+
+const std::vector<int>& filteredSources() {
+    static std::vector<int> rows;
+    static uint64_t revision = 0;
+    static std::string filter;
+    const SourceStore& sources = g_sim.sources;
+    if (revision == sources.revision() && filter == g_sourceFilter.InputBuf) return rows;
+    revision = sources.revision();
+    filter = g_sourceFilter.InputBuf;
+
+    std::vector<char> match(sources.names().size());
+    for (size_t n = 0; n < match.size(); n++) match[n] = g_sourceFilter.PassFilter(sources.names()[n].c_str());
+    rows.clear();
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (match[sources.nameId(i)]) rows.push_back(static_cast<int>(i));
+    }
+    return rows;
+}
+
 void renderGUI() {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -808,50 +1187,46 @@ void renderGUI() {
         // Menu bar with quick actions - Particle Life style
         if (ImGui::BeginMenuBar()) {
             if (ImGui::BeginMenu("Presets")) {
-                if (ImGui::MenuItem("Double Slit")) {
-                    loadPreset("Double Slit");
-                }
-                if (ImGui::MenuItem("Multiple Slits")) {
-                    loadPreset("Multiple Slits");
-                }
-                if (ImGui::MenuItem("Ripple Tank")) {
-                    loadPreset("Ripple Tank");
-                }
-                if (ImGui::MenuItem("Wave Interference")) {
-                    loadPreset("Wave Interference");
-                }
-                if (ImGui::MenuItem("Standing Waves")) {
-                    loadPreset("Standing Waves");
-                }
-                if (ImGui::MenuItem("Reflection Demo")) {
-                    loadPreset("Reflection Demo");
-                }
-                if (ImGui::MenuItem("Lens Focus")) {
-                    loadPreset("Lens Focus");
-                }
-                if (ImGui::MenuItem("Wave Guide")) {
-                    loadPreset("Wave Guide");
+                for (const std::string& name : presetNames()) {
+                    if (ImGui::MenuItem(name.c_str())) {
+                        g_sceneLoader.load(name, g_sim);
+                    }
                 }
-                if (ImGui::MenuItem("Corner Cavity")) {
-                    loadPreset("Corner Cavity");
+                // Scene files from scenes/
+                ImGui::Separator();
+                for (const SceneSpec& scene : g_sceneFiles) {
+                    if (ImGui::MenuItem(scene.name.c_str())) {
+                        g_sceneLoader.load(scene.path, g_sim);
+                    }
                 }
-                if (ImGui::MenuItem("Circular Arena")) {
-                    loadPreset("Circular Arena");
+                if (ImGui::MenuItem("Rescan Scene Files")) {
+                    rescanScenes();
                 }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Actions")) {
                 if (ImGui::MenuItem("Clear All", "R")) {
-                    clearWaves();
-                    clearWalls();
-                    clearSources();
+                    clearWaves(g_sim);
+                    g_rewind.markEdited();
+                    clearWalls(g_sim);
+                    invalidateWalls();
+                    clearSources(g_sim);
+                    g_sceneLoader.cancel();
+                    g_probes.clear();
                 }
                 if (ImGui::MenuItem("Clear Waves", "C")) {
-                    clearWaves();
+                    clearWaves(g_sim);
+                    g_rewind.markEdited();
                 }
                 if (ImGui::MenuItem("Take Screenshot", "P")) {
                     takeScreenshot();
                 }
+                if (ImGui::MenuItem("Save Snapshot", "F5")) {
+                    requestSnapshot();
+                }
+                if (ImGui::MenuItem("Restore Latest Snapshot", "F9")) {
+                    restoreLatestSnapshot();
+                }
                 ImGui::EndMenu();
             }
             ImGui::EndMenuBar();
@@ -866,6 +1241,10 @@ void renderGUI() {
         // Status with colored indicators
         ImGui::Text("Wave Sources: %zu", g_sim.sources.size());
         ImGui::Text("Simulation Time: %.2f s", g_sim.time);
+        if (g_store) {
+            ImGui::Text("Viewing store: %d^2, step %llu", g_store->size(),
+                        static_cast<unsigned long long>(g_store->header().step));
+        }
         
         // FPS with color coding
         float fps = ImGui::GetIO().Framerate;
@@ -912,13 +1291,24 @@ void renderGUI() {
         if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip("Save screenshot (P)");
         }
+        ImGui::Combo("Capture", reinterpret_cast<int*>(&g_captureMode), "Window\0Field (grid resolution)\0");
+        ImGui::SliderInt("##burstFrames", &g_burstFrames, 2, 300, "%d frames");
+        ImGui::SameLine();
+        if (ImGui::Button("Burst")) requestCapture(g_burstFrames);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Capture consecutive frames as numbered PNGs");
+        }
+        if (g_captureFramesLeft > 0 || g_imageWriter.pending() > 0) {
+            ImGui::Text("Capturing: %d frames to go, %d encoding", g_captureFramesLeft, g_imageWriter.pending());
+        }
         
         // Clear waves button
         ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f * 0.3f, 0.6f * 0.3f, 0.8f * 0.3f, 1.0f));
         ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.2f * 0.5f, 0.6f * 0.5f, 0.8f * 0.5f, 1.0f));
         ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.2f * 0.7f, 0.6f * 0.7f, 0.8f * 0.7f, 1.0f));
         if (ImGui::Button("Clear Waves", ImVec2(-1, 30))) {
-            clearWaves();
+            clearWaves(g_sim);
+            g_rewind.markEdited();
         }
         ImGui::PopStyleColor(3);
         if (ImGui::IsItemHovered()) {
@@ -931,23 +1321,29 @@ void renderGUI() {
         ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.6f * 0.7f, 0.2f * 0.7f, 0.2f * 0.7f, 1.0f));
         
         if (ImGui::Button("Clear Walls", ImVec2(-1, 30))) {
-            clearWalls();
+            clearWalls(g_sim);
+            invalidateWalls();
+            g_rewind.markEdited();
         }
         if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip("Remove all wall barriers");
         }
         
         if (ImGui::Button("Clear Sources", ImVec2(-1, 30))) {
-            clearSources();
+            clearSources(g_sim);
         }
         if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip("Remove all wave sources");
         }
         
         if (ImGui::Button("Reset All", ImVec2(-1, 30))) {
-            clearWaves();
-            clearWalls();
-            clearSources();
+            clearWaves(g_sim);
+            g_rewind.markEdited();
+            clearWalls(g_sim);
+            invalidateWalls();
+            clearSources(g_sim);
+            g_sceneLoader.cancel();
+            g_probes.clear();
         }
         ImGui::PopStyleColor(3);
         if (ImGui::IsItemHovered()) {
@@ -959,6 +1355,84 @@ void renderGUI() {
             ImGui::SetTooltip("Adjust simulation speed");
         }
         ImGui::Spacing();
+
+        // Recording and playback section
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.9f, 1.0f, 1.0f));
+        ImGui::Text("RECORDING");
+        ImGui::PopStyleColor();
+        ImGui::Separator();
+
+        if (!g_recorder) {
+            ImGui::SliderInt("Record Every", &g_recordEvery, 1, 16, "%d steps");
+            if (ImGui::Button("Record", ImVec2(-1, 0))) startRecording();
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Record the field to recordings/ (compressed on background threads)");
+            }
+        } else {
+            ImGui::Text("Recording: %d frames, %.1f MB", g_recorder->framesWritten(),
+                        g_recorder->bytesWritten() / 1e6);
+            if (g_recorder->framesDropped()) {
+                ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "%d frames dropped (encoder behind)",
+                                   g_recorder->framesDropped());
+            }
+            if (ImGui::Button("Stop Recording", ImVec2(-1, 0))) stopRecording();
+        }
+
+        if (!g_playback) {
+            if (ImGui::Button("Open Latest Recording", ImVec2(-1, 0))) openLatestRecording();
+        } else {
+            const RecordingFrameInfo& info = g_playback->frame(g_playbackFrame);
+            ImGui::Text("Playback: step %llu, t = %.2f s", static_cast<unsigned long long>(info.step), info.time);
+            int frame = g_playbackFrame;
+            if (ImGui::SliderInt("Frame", &frame, 0, g_playback->frameCount() - 1) && frame != g_playbackFrame) {
+                showPlaybackFrame(frame);
+            }
+            if (ImGui::Button(g_playbackPlaying ? "Pause Playback" : "Play", ImVec2(-1, 0))) {
+                if (!g_playbackPlaying && g_playbackFrame + 1 >= g_playback->frameCount()) showPlaybackFrame(0);
+                g_playbackPlaying = !g_playbackPlaying;
+            }
+            if (ImGui::Button("Export .npy", ImVec2(-1, 0))) exportPlayback();
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Write every frame as a float32 stack next to the recording");
+            }
+            if (ImGui::Button("Close Playback", ImVec2(-1, 0))) g_playback.reset();
+        }
+        ImGui::Spacing();
+
+        // History section: scrub back through recent steps
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.9f, 1.0f, 1.0f));
+        ImGui::Text("HISTORY");
+        ImGui::PopStyleColor();
+        ImGui::Separator();
+
+        if (ImGui::Checkbox("Keep History", &g_rewindEnabled) && !g_rewindEnabled) g_rewind.clear();
+        if (g_rewindEnabled && !g_rewind.empty()) {
+            const uint64_t first = g_rewind.firstStep();
+            const float newest = g_rewind.timeAt(g_rewind.lastStep());
+            ImGui::Text("%.1f s kept, %d checkpoints, %.0f MB", newest - g_rewind.timeAt(first),
+                        g_rewind.checkpointCount(), g_rewind.bytes() / 1e6);
+            int position = static_cast<int>(g_rewind.position() - first);
+            const int last = static_cast<int>(g_rewind.lastStep() - first);
+            char label[32];
+            std::snprintf(label, sizeof(label), "%.2f s back", newest - g_sim.time);
+            if (ImGui::SliderInt("Timeline", &position, 0, last, label)) scrubHistory(first + position);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Drag to rewind; resuming continues from here and drops the later history");
+            }
+
+            RewindOptions options = g_rewind.options();
+            int budgetMB = static_cast<int>(options.budgetBytes >> 20);
+            bool changed = ImGui::SliderInt("Memory", &budgetMB, 32, 2048, "%d MB");
+            changed |= ImGui::SliderInt("Checkpoints", &options.checkpointInterval, 10, 600, "every %d steps");
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Fewer checkpoints keep more history in the same memory but seek slower");
+            }
+            if (changed) {
+                options.budgetBytes = size_t(budgetMB) << 20;
+                g_rewind.setOptions(options);
+            }
+        }
+        ImGui::Spacing();
         
         // Interaction tools section
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.9f, 1.0f, 1.0f));
@@ -1001,8 +1475,25 @@ void renderGUI() {
         if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip("Two-click mode for straight walls");
         }
+
+        ImGui::RadioButton("Fill Wall", (int*)&g_sim.currentTool, (int)Tool::FILL_WALL);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Click to fill an enclosed area with wall, or to clear a wall");
+        }
         
         // Tool-specific controls
+        if (g_sim.currentTool == Tool::DRAW_WALL || g_sim.currentTool == Tool::ERASE_WALL ||
+            g_sim.currentTool == Tool::SNAP_WALL) {
+            ImGui::Indent();
+            int shape = static_cast<int>(g_sim.brush.shape);
+            if (ImGui::Combo("Brush", &shape, "Square\0Round\0")) g_sim.brush.shape = static_cast<BrushShape>(shape);
+            ImGui::SliderInt("Radius", &g_sim.brush.radius, 0, 24, "%d cells");
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Cells from the centre of the brush to its edge");
+            }
+            ImGui::Unindent();
+        }
+
         if (g_sim.currentTool == Tool::SNAP_WALL) {
             ImGui::Indent();
             if (g_sim.snapWallFirstPoint) {
@@ -1113,64 +1604,195 @@ void renderGUI() {
         }
         ImGui::Spacing();
         
-        // Wave sources management
+        // Wave sources management (only the rows in view are built, so long lists stay cheap)
         if (g_sim.sources.size() > 0) {
+            SourceStore& sources = g_sim.sources;
             ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.9f, 1.0f, 1.0f));
-            ImGui::Text("WAVE SOURCES (%zu)", g_sim.sources.size());
+            ImGui::Text("WAVE SOURCES (%zu)", sources.size());
             ImGui::PopStyleColor();
             ImGui::Separator();
+
+            g_sourceFilter.Draw("Filter##sources");
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Show sources whose name matches (\"a,b\" for either, \"-a\" to exclude)");
+            }
+            const std::vector<int>& rows = filteredSources();
+            if (g_sourceFilter.IsActive()) {
+                ImGui::Text("%zu of %zu shown", rows.size(), sources.size());
+            }
             
             ImGui::BeginChild("SourcesList", ImVec2(0, 200), true);
-            for (size_t i = 0; i < g_sim.sources.size(); i++) {
-                auto& source = g_sim.sources[i];
-                
-                ImGui::PushID((int)i);
-                
-                // Source header with status
-                ImGui::Text("%s", source.name.c_str());
-                ImGui::SameLine();
-                
-                // Status toggle button
-                ImVec4 statusColor = source.active ? ImVec4(0.2f, 1.0f, 0.3f, 1.0f) : ImVec4(0.6f, 0.2f, 0.2f, 1.0f);
-                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(statusColor.x * 0.3f, statusColor.y * 0.3f, statusColor.z * 0.3f, 1.0f));
-                ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(statusColor.x * 0.5f, statusColor.y * 0.5f, statusColor.z * 0.5f, 1.0f));
-                ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(statusColor.x * 0.7f, statusColor.y * 0.7f, statusColor.z * 0.7f, 1.0f));
-                if (ImGui::SmallButton(source.active ? "ON" : "OFF")) {
-                    source.active = !source.active;
-                }
-                ImGui::PopStyleColor(3);
-                
-                ImGui::SameLine();
-                
-                // Delete button
-                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.6f * 0.3f, 0.2f * 0.3f, 0.2f * 0.3f, 1.0f));
-                ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.6f * 0.5f, 0.2f * 0.5f, 0.2f * 0.5f, 1.0f));
-                ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.6f * 0.7f, 0.2f * 0.7f, 0.2f * 0.7f, 1.0f));
-                if (ImGui::SmallButton("Delete")) {
-                    g_sim.sources.erase(g_sim.sources.begin() + i);
+            int removed = -1;
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(rows.size()));
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                    const int i = rows[row];
+                    
+                    ImGui::PushID(i);
+                    
+                    // Source header with status
+                    ImGui::Text("%s", sources.name(i).c_str());
+                    ImGui::SameLine();
+                    
+                    // Status toggle button
+                    const bool active = sources.active(i);
+                    ImVec4 statusColor = active ? ImVec4(0.2f, 1.0f, 0.3f, 1.0f) : ImVec4(0.6f, 0.2f, 0.2f, 1.0f);
+                    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(statusColor.x * 0.3f, statusColor.y * 0.3f, statusColor.z * 0.3f, 1.0f));
+                    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(statusColor.x * 0.5f, statusColor.y * 0.5f, statusColor.z * 0.5f, 1.0f));
+                    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(statusColor.x * 0.7f, statusColor.y * 0.7f, statusColor.z * 0.7f, 1.0f));
+                    if (ImGui::SmallButton(active ? "ON" : "OFF")) {
+                        sources.setActive(i, !active);
+                    }
+                    ImGui::PopStyleColor(3);
+                    
+                    ImGui::SameLine();
+                    
+                    // Delete button (erased after the list is drawn)
+                    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.6f * 0.3f, 0.2f * 0.3f, 0.2f * 0.3f, 1.0f));
+                    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.6f * 0.5f, 0.2f * 0.5f, 0.2f * 0.5f, 1.0f));
+                    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.6f * 0.7f, 0.2f * 0.7f, 0.2f * 0.7f, 1.0f));
+                    if (ImGui::SmallButton("Delete")) {
+                        removed = i;
+                    }
                     ImGui::PopStyleColor(3);
+                    
+                    // Source parameters
+                    ImGui::Text("Position: (%.0f, %.0f)", sources.x(i), sources.y(i));
+                    float frequency = sources.frequency(i);
+                    if (ImGui::SliderFloat("Freq##freq", &frequency, 0.5f, 10.0f, "%.1f Hz")) {
+                        sources.setFrequency(i, frequency);
+                    }
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Oscillation frequency");
+                    }
+                    float amplitude = sources.amplitude(i);
+                    if (ImGui::SliderFloat("Amp##amp", &amplitude, 0.1f, 5.0f, "%.2f")) {
+                        sources.setAmplitude(i, amplitude);
+                    }
+                    if (ImGui::IsItemHovered()) {
+                        ImGui::SetTooltip("Wave amplitude");
+                    }
+                    
+                    ImGui::Separator();
                     ImGui::PopID();
-                    break;
-                }
-                ImGui::PopStyleColor(3);
-                
-                // Source parameters
-                ImGui::Text("Position: (%.0f, %.0f)", source.x, source.y);
-                ImGui::SliderFloat("Freq##freq", &source.frequency, 0.5f, 10.0f, "%.1f Hz");
-                if (ImGui::IsItemHovered()) {
-                    ImGui::SetTooltip("Oscillation frequency");
-                }
-                ImGui::SliderFloat("Amp##amp", &source.amplitude, 0.1f, 5.0f, "%.2f");
-                if (ImGui::IsItemHovered()) {
-                    ImGui::SetTooltip("Wave amplitude");
                 }
-                
-                ImGui::Separator();
-                ImGui::PopID();
             }
             ImGui::EndChild();
+            if (removed >= 0) {
+                sources.erase(removed);
+                g_sim.draggedSourceIndex = -1;
+            }
+        }
+
+        // Probes of the loaded scene file
+        if (!g_probes.empty()) {
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.9f, 1.0f, 1.0f));
+            ImGui::Text("PROBES (%zu)", g_probes.size());
+            ImGui::PopStyleColor();
+            ImGui::Separator();
+            for (const SceneProbe& probe : g_probes) {
+                const int x = std::clamp(static_cast<int>(probe.x), 0, g_sim.size - 1);
+                const int y = std::clamp(static_cast<int>(probe.y), 0, g_sim.size - 1);
+                ImGui::Text("%s (%d, %d): %+.3f", probe.name.c_str(), x, y, g_sim.u[g_sim.index(x, y)]);
+            }
+            ImGui::Spacing();
         }
         
+        // Profiler section
+        if (ImGui::CollapsingHeader("Profiler")) {
+            ImGui::Checkbox("Enable Profiling", &g_profiler.enabled);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Reset")) {
+                g_profiler.reset();
+            }
+            const char* kernelNames[] = { kernelVariantName(KernelVariant::SCALAR), kernelVariantName(KernelVariant::SIMD) };
+            ImGui::Combo("Stencil Kernel", (int*)&g_kernelVariant, kernelNames, IM_ARRAYSIZE(kernelNames));
+            const char* layoutNames[] = { fieldLayoutName(FieldLayout::ROW_MAJOR), fieldLayoutName(FieldLayout::TILED) };
+            int layout = static_cast<int>(g_sim.layout);
+            if (ImGui::Combo("Field Layout", &layout, layoutNames, IM_ARRAYSIZE(layoutNames))) {
+                setFieldLayout(g_sim, static_cast<FieldLayout>(layout));
+            }
+            ImGui::SliderInt("Tile Width", &g_tileWidth, 0, GRID_SIZE, g_tileWidth ? "%d columns" : "whole rows");
+            ImGui::Text("Solver threads: %d", g_threadPool ? g_threadPool->size() : 1);
+            ImGui::Text("Tuned: %s, tile %d, %d threads (%.2f ns/cell%s)", kernelVariantName(g_tuned.variant),
+                        g_tuned.tileWidth, g_tuned.threads, g_tuned.nsPerCell, g_tuned.cached ? ", cached" : "");
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Run with --tune to re-measure. Cache: %s", tuningFilePath().c_str());
+            }
+            ImGui::Checkbox("Hardware Counters", &g_profiler.useCounters);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", g_profiler.countersStatus().c_str());
+            }
+            if (!g_profiler.countersAvailable()) {
+                ImGui::TextWrapped("%s", g_profiler.countersStatus().c_str());
+            }
+
+            for (const auto& k : g_profiler.kernels()) {
+                if (k.invocations == 0) continue;
+                ImGui::Separator();
+                ImGui::Text("%s (%llu calls)", k.name.c_str(), (unsigned long long)k.invocations);
+                ImGui::Text("  %.3f ms/call, %.2f ns/cell", k.total.seconds * 1e3 / k.invocations, k.nsPerCell());
+                if (g_profiler.countersAvailable() && k.total.cycles > 0) {
+                    ImGui::Text("  IPC %.2f, stalled %.0f%%", k.ipc(), k.stalledFraction() * 100.0);
+                    ImGui::Text("  DRAM %.2f B/cell", k.bytesPerCell());
+                    ImGui::Text("  L1D %.1f MPKI, LLC %.2f MPKI", k.l1Mpki(), k.llcMpki());
+                }
+            }
+
+            ImGui::Separator();
+            if (ImGui::Checkbox("Measure Input Latency", &g_latency.enabled)) {
+                g_gpuClockCalibrated = -1.0;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Mouse event to GPU completion of the frame showing it. GPU time from %s",
+                                  g_latencyQueries ? "timestamp queries" : "fences (polled, up to a frame late)");
+            }
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Reset##latency")) {
+                g_latency.reset();
+            }
+            ImGui::SameLine();
+            ImGui::BeginDisabled(g_latency.samples().empty());
+            if (ImGui::SmallButton("Export Trace")) {
+                exportLatencyTrace();
+            }
+            ImGui::EndDisabled();
+            if (!g_latency.samples().empty()) {
+                const LatencySummary total = g_latency.summary(LATENCY_STAGES);
+                if (ImGui::BeginTable("latency", 5, ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_RowBg)) {
+                    ImGui::TableSetupColumn("stage (ms)");
+                    ImGui::TableSetupColumn("p50");
+                    ImGui::TableSetupColumn("p95");
+                    ImGui::TableSetupColumn("p99");
+                    ImGui::TableSetupColumn("max");
+                    ImGui::TableHeadersRow();
+                    for (int stage = 0; stage <= LATENCY_STAGES; stage++) {
+                        const LatencySummary l = stage == LATENCY_STAGES ? total : g_latency.summary(stage);
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(latencyStageName(stage));
+                        for (double v : { l.p50, l.p95, l.p99, l.max }) {
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.2f", v * 1e3);
+                        }
+                    }
+                    ImGui::EndTable();
+                }
+                // Totals of the most recent events
+                static std::vector<float> recent;
+                recent.clear();
+                const auto& samples = g_latency.samples();
+                for (size_t i = samples.size() > 240 ? samples.size() - 240 : 0; i < samples.size(); i++) {
+                    recent.push_back(static_cast<float>((samples[i].at[LATENCY_DISPLAYED] - samples[i].input) * 1e3));
+                }
+                char overlay[48];
+                std::snprintf(overlay, sizeof(overlay), "%d events, mean %.1f ms", total.count, total.mean * 1e3);
+                ImGui::PlotLines("##latency", recent.data(), static_cast<int>(recent.size()), 0, overlay, 0.0f, FLT_MAX,
+                                 ImVec2(0, 60));
+            }
+        }
+
         // Keyboard shortcuts section  
         if (ImGui::CollapsingHeader("Keyboard Shortcuts")) {
             ImGui::BulletText("SPACE - Pause/Resume simulation");
@@ -1200,10 +1822,28 @@ void renderGUI() {
         }
     }
     
+    // Loading indicator; the current scene keeps running meanwhile
+    if (g_sceneLoader.loading()) {
+        const char spinner[] = "|/-\\";
+        ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Always);
+        ImGui::Begin("Loading Notification", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs);
+        ImGui::Text("%c Loading %s...", spinner[static_cast<int>(ImGui::GetTime() * 8.0) & 3], g_sceneLoader.loadingName().c_str());
+        ImGui::End();
+    }
+    
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+// Queues an event at the latest cursor position, stamped now
+// Synthetic events (not caused by the user at that moment) are not latency samples
+void pushInputEvent(InputEvent::Type type, bool measured = true) {
+    const double now = glfwGetTime();
+    g_inputEvents.push_back({ type, now, g_cursorX, g_cursorY, measured ? g_latency.input(now) : 0 });
+    if (type == InputEvent::PRESS) g_buttonDown = true;
+    if (type == InputEvent::RELEASE) g_buttonDown = false;
+}
+
 // Mouse callback
 void mouseCallback(GLFWwindow* window, double x, double y) {
     // Important: GLFW cursor positions are in *window* coordinates (points), not framebuffer pixels.
@@ -1241,7 +1881,8 @@ void mouseCallback(GLFWwindow* window, double x, double y) {
     const float viewportWWindow = std::max(1.0f, static_cast<float>(winW) - uiWidthLogical - uiGapLogical);
 
     if (static_cast<float>(x) >= viewportWWindow) {
-        g_sim.mousePressed = false; // Disable interaction in side panel area
+        // Disable interaction in side panel area: a drag that crosses into it ends there
+        if (g_buttonDown) pushInputEvent(InputEvent::RELEASE, false);
         return;
     }
 
@@ -1250,39 +1891,19 @@ void mouseCallback(GLFWwindow* window, double x, double y) {
     const float nx = (static_cast<float>(x) * fbScaleX) / viewportW; // 0..1
     const float ny = (static_cast<float>(y) * fbScaleY) / viewportH; // 0..1 (top->bottom)
 
-    g_sim.mouseX = nx * static_cast<float>(GRID_SIZE);
-    g_sim.mouseY = (1.0f - ny) * static_cast<float>(GRID_SIZE); // flip so 0 is bottom
+    g_cursorX = nx * static_cast<float>(GRID_SIZE);
+    g_cursorY = (1.0f - ny) * static_cast<float>(GRID_SIZE); // flip so 0 is bottom
+    pushInputEvent(InputEvent::MOVE);
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    if (button == GLFW_MOUSE_BUTTON_LEFT) {
-        if (action == GLFW_PRESS) {
-            g_sim.mousePressed = true;
-            
-            // Check if we're starting to drag a source
-            if (g_sim.currentTool == Tool::MOVE_SOURCE) {
-                g_sim.draggedSourceIndex = -1;
-                // Find closest source within range
-                float minDist = 20.0f; // Maximum distance to grab a source
-                for (size_t i = 0; i < g_sim.sources.size(); i++) {
-                    float dx = g_sim.mouseX - g_sim.sources[i].x;
-                    float dy = g_sim.mouseY - g_sim.sources[i].y;
-                    float dist = std::sqrt(dx*dx + dy*dy);
-                    if (dist < minDist) {
-                        g_sim.draggedSourceIndex = static_cast<int>(i);
-                        minDist = dist;
-                    }
-                }
-            }
-        } else {
-            g_sim.mousePressed = false;
-            g_sim.draggedSourceIndex = -1; // Release dragged source
-            // Reset drag state for non-snap tools
-            if (g_sim.currentTool != Tool::SNAP_WALL) {
-                g_sim.lastMouseX = -1;
-                g_sim.lastMouseY = -1;
-            }
-        }
+    if (button != GLFW_MOUSE_BUTTON_LEFT) return;
+    if (action == GLFW_PRESS) {
+        // Clicks on the UI are its own
+        if (ImGui::GetIO().WantCaptureMouse) return;
+        pushInputEvent(InputEvent::PRESS);
+    } else {
+        pushInputEvent(InputEvent::RELEASE);
     }
 }
 
@@ -1291,15 +1912,24 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         if (key == GLFW_KEY_SPACE) {
             g_sim.paused = !g_sim.paused;
         } else if (key == GLFW_KEY_R) {
-            clearWaves();
-            clearWalls();
-            clearSources();
+            clearWaves(g_sim);
+            g_rewind.markEdited();
+            clearWalls(g_sim);
+            invalidateWalls();
+            clearSources(g_sim);
+            g_sceneLoader.cancel();
+            g_probes.clear();
         } else if (key == GLFW_KEY_C) {
-            clearWaves();
+            clearWaves(g_sim);
+            g_rewind.markEdited();
         } else if (key == GLFW_KEY_G) {
             g_sim.showGrid = !g_sim.showGrid;
         } else if (key == GLFW_KEY_P) {
             takeScreenshot();
+        } else if (key == GLFW_KEY_F5) {
+            requestSnapshot();
+        } else if (key == GLFW_KEY_F9) {
+            restoreLatestSnapshot();
         } else if (key == GLFW_KEY_ESCAPE) {
             // Cancel snap wall mode
             if (g_sim.currentTool == Tool::SNAP_WALL && !g_sim.snapWallFirstPoint) {
@@ -1311,104 +1941,35 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     }
 }
 
-// Handle mouse interaction
-void handleMouseInput(GLFWwindow* window) {
-    ImGuiIO& io = ImGui::GetIO();
-    if (io.WantCaptureMouse) return;
-    
-    if (!g_sim.mousePressed) return;
-    
-    // Mouse is already stored in grid coordinates (see mouseCallback).
-    int gridX = static_cast<int>(g_sim.mouseX);
-    int gridY = static_cast<int>(g_sim.mouseY);
-    
-    // Bounds check
-    if (gridX < 0 || gridX >= GRID_SIZE || gridY < 0 || gridY >= GRID_SIZE) {
-        return;
-    }
-    
-    // Handle tools
-    if (g_sim.currentTool == Tool::ADD_SOURCE) {
-        // Single click to add source
-        if (g_sim.lastMouseX == -1) {
-            addSource(static_cast<float>(gridX), static_cast<float>(gridY), g_sim.newSourceFreq, g_sim.newSourceAmp);
-        }
-        g_sim.lastMouseX = gridX;
-        g_sim.lastMouseY = gridY;
-        
-    } else if (g_sim.currentTool == Tool::INTERACT) {
-        // Create ripple effect at mouse position (continuous while dragging)
-        // Only create ripple if mouse has moved to avoid repeated application at same spot
-        if (g_sim.lastMouseX != gridX || g_sim.lastMouseY != gridY) {
-            // Create a ripple effect
-            int radius = 15;
-            float amplitude = 1.5f;  // Reduced for continuous application
-            
-            for (int dy = -radius; dy <= radius; dy++) {
-                for (int dx = -radius; dx <= radius; dx++) {
-                    int nx = gridX + dx;
-                    int ny = gridY + dy;
-                    if (nx >= 0 && nx < GRID_SIZE && ny >= 0 && ny < GRID_SIZE) {
-                        float dist = std::sqrt(dx*dx + dy*dy);
-                        if (dist <= radius && !g_sim.walls[ny * GRID_SIZE + nx]) {
-                            float falloff = 1.0f - (dist / radius);
-                            g_sim.u[ny * GRID_SIZE + nx] += amplitude * falloff * falloff;
-                        }
-                    }
-                }
+// Main
+int main(int argc, char** argv) {
+    bool retune = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--tune") {
+            retune = true;
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            // Start (or fork a run) from a saved moment
+            if (!restoreSnapshot(argv[++i])) return 1;
+        } else if (arg == "--view-store" && i + 1 < argc) {
+            std::string error;
+            g_store = FieldStore::open(argv[++i], false, error);
+            if (!g_store) {
+                std::cerr << error << std::endl;
+                return 1;
             }
         }
-        g_sim.lastMouseX = gridX;
-        g_sim.lastMouseY = gridY;
-    } else if (g_sim.currentTool == Tool::REMOVE_SOURCE) {
-        // Single click to remove source
-        if (g_sim.lastMouseX == -1) {
-            removeSource(static_cast<float>(gridX), static_cast<float>(gridY));
-        }
-        g_sim.lastMouseX = gridX;
-        g_sim.lastMouseY = gridY;
-    
-    } else if (g_sim.currentTool == Tool::MOVE_SOURCE) {
-        // Drag source to new position - update continuously while dragging
-        if (g_sim.draggedSourceIndex >= 0 && g_sim.draggedSourceIndex < static_cast<int>(g_sim.sources.size())) {
-            g_sim.sources[g_sim.draggedSourceIndex].x = std::clamp(static_cast<float>(gridX), 0.0f, static_cast<float>(GRID_SIZE - 1));
-            g_sim.sources[g_sim.draggedSourceIndex].y = std::clamp(static_cast<float>(gridY), 0.0f, static_cast<float>(GRID_SIZE - 1));
-        }
-        
-    } else if (g_sim.currentTool == Tool::SNAP_WALL) {
-        // Two-click snap wall mode
-        if (g_sim.snapWallFirstPoint) {
-            // First click - store position
-            g_sim.snapWallX1 = gridX;
-            g_sim.snapWallY1 = gridY;
-            g_sim.snapWallFirstPoint = false;
-            std::cout << "Snap wall: First point at (" << gridX << ", " << gridY << ")" << std::endl;
-        } else {
-            // Second click - draw line from first to second point
-            std::cout << "Snap wall: Second point at (" << gridX << ", " << gridY << "), drawing line..." << std::endl;
-            drawLine(g_sim.snapWallX1, g_sim.snapWallY1, gridX, gridY, true);
-            g_sim.snapWallFirstPoint = true;
-            g_sim.snapWallX1 = -1;
-            g_sim.snapWallY1 = -1;
-        }
-        g_sim.mousePressed = false;  // Consume the click
-        
-    } else if (g_sim.currentTool == Tool::DRAW_WALL || g_sim.currentTool == Tool::ERASE_WALL) {
-        bool drawWall = (g_sim.currentTool == Tool::DRAW_WALL);
-        
-        if (g_sim.lastMouseX >= 0 && g_sim.lastMouseY >= 0) {
-            drawLine(g_sim.lastMouseX, g_sim.lastMouseY, gridX, gridY, drawWall);
-        } else {
-            setWall(gridX, gridY, drawWall);
-        }
-        
-        g_sim.lastMouseX = gridX;
-        g_sim.lastMouseY = gridY;
     }
-}
 
-// Main
-int main() {
+    // Pick the stencil configuration before any window exists so the timing is undisturbed
+    g_tuned = tunedConfiguration(GRID_SIZE, retune, &std::cout);
+    g_kernelVariant = g_tuned.variant;
+    g_tileWidth = g_tuned.tileWidth;
+    g_threadPool.reset(new ThreadPool(g_tuned.threads));
+    firstTouchFields(g_sim, g_threadPool.get());
+    std::cout << "Stencil: " << kernelVariantName(g_kernelVariant) << ", tile " << g_tileWidth
+              << ", " << g_tuned.threads << " threads" << (g_tuned.cached ? " (cached)" : "") << std::endl;
+
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
@@ -1446,6 +2007,10 @@ int main() {
         std::cerr << "Failed to initialize OpenGL" << std::endl;
         return -1;
     }
+
+    // Scene files and their compiled cache live in scenes/
+    g_sceneLoader.setCacheDirectory(projectDirectory("scenes") + "/.cache");
+    rescanScenes();
     
     // ImGui setup
     IMGUI_CHECKVERSION();
@@ -1554,9 +2119,9 @@ int main() {
         float deltaTime = static_cast<float>(currentTime - lastTime);
         lastTime = currentTime;
         
-        // Update
-        updateSimulation(deltaTime);
-        handleMouseInput(window);
+        // Update (applies the input polled since the last frame at its substeps)
+        updateSimulation(deltaTime, currentTime);
+        beginRequestedSnapshot();
         
         // Render
         // Full window clear with simulation background
@@ -1580,13 +2145,21 @@ int main() {
         
         // Reset viewport for ImGui rendering
         glViewport(0, 0, fbW, fbH);
+        settleSnapshot();
         renderGUI();
+        captureFrame(fbW, fbH);
+        collectCaptures();
         
         glfwSwapBuffers(window);
+        markLatencyFrame();
+        collectLatencyFrames();
         glfwPollEvents();
     }
     
     // Cleanup
+    if (g_recorder) stopRecording();
+    collectCaptures(true);
+    g_imageWriter.wait();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -1597,6 +2170,14 @@ int main() {
     glDeleteBuffers(1, &g_gridVBO);
     glDeleteTextures(1, &g_waveTexture);
     glDeleteTextures(1, &g_wallTexture);
+    glDeleteTextures(1, &g_captureTexture);
+    glDeleteFramebuffers(1, &g_captureFramebuffer);
+    glDeleteBuffers(static_cast<GLsizei>(g_freeCaptureBuffers.size()), g_freeCaptureBuffers.data());
+    for (const LatencyFrame& f : g_latencyFrames) {
+        if (f.query) g_freeLatencyQueries.push_back(f.query);
+        else glDeleteSync(f.fence);
+    }
+    glDeleteQueries(static_cast<GLsizei>(g_freeLatencyQueries.size()), g_freeLatencyQueries.data());
     glDeleteProgram(g_shaderProgram);
     glDeleteProgram(g_gridShaderProgram);
     